@@ -0,0 +1,136 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#include <SDL_image.h>
+
+#include <utils.h>
+#include <Texture2D.h>
+
+#include "Assets.h"
+
+namespace assets {
+
+// network thread (prefetch) and render thread (take)
+static std::mutex mtx_assets;
+// meshes being decoded or decoded, not taken yet
+static std::map<ObjectType, std::future<std::unique_ptr<Mesh>>> meshes;
+static std::map<ObjectType, std::shared_future<std::shared_ptr<const Files>>> type_files;
+
+
+Files::~Files() {
+    if (image != nullptr) SDL_FreeSurface(image);
+}
+
+/**
+ * Config of an object type
+ */
+static ObjectConfigType config(ObjectType type) {
+    std::map<ObjectType, ObjectConfigType>::const_iterator it = objects_config.find(type);
+    if (it == objects_config.end()) {
+        std::cerr << "Unable to find this object type..." << std::endl;
+        throw std::runtime_error("Unknown object type");
+    }
+    return it->second;
+}
+
+/**
+ * Load the mesh of an object type (any thread)
+ */
+static std::unique_ptr<Mesh> decodeMesh(ObjectConfigType conf) {
+    std::unique_ptr<Mesh> mesh(new Mesh("Object"));
+    mesh->loadObj("data/"+conf.obj_file);
+
+    // mise à l'échelle et rotation de l'objet (si son .obj est mal orienté et trop grand/petit)
+    mat4 correction = mat4::create();
+    mat4::identity(correction);
+    mat4::scale(correction, correction, vec3::fromValues(conf.ratio, conf.ratio, conf.ratio));
+    mat4::rotateX(correction, correction, Utils::radians(conf.rotation_x));
+    mat4::rotateY(correction, correction, Utils::radians(conf.rotation_y));
+    mat4::rotateZ(correction, correction, Utils::radians(conf.rotation_z));
+    mesh->transform(correction);
+
+    // recalcul des normales
+    mesh->computeNormals();
+    return mesh;
+}
+
+/**
+ * Load the image and the sound of an object type (any thread)
+ */
+static std::shared_ptr<const Files> decodeFiles(ObjectConfigType conf) {
+    std::shared_ptr<Files> files = std::make_shared<Files>();
+    files->image = Texture2D::loadImage(("data/"+conf.diffuse_img).c_str());
+
+    std::ifstream sound("data/"+conf.sound_file, std::ios::binary);
+    files->sound.assign(std::istreambuf_iterator<char>(sound), std::istreambuf_iterator<char>());
+    return files;
+}
+
+/**
+ * Files of a type, their decoding started if needed (mtx_assets locked)
+ */
+static std::shared_future<std::shared_ptr<const Files>> typeFiles(ObjectType type, const ObjectConfigType &conf) {
+    std::map<ObjectType, std::shared_future<std::shared_ptr<const Files>>>::iterator it = type_files.find(type);
+    if (it == type_files.end()) {
+        it = type_files.insert(std::make_pair(type, std::async(std::launch::async, decodeFiles, conf).share())).first;
+    }
+    return it->second;
+}
+
+
+/**
+ * An object of this type is coming: decode the mesh and the files of its type in the background (once)
+ *
+ * @param type object type
+ */
+void prefetch(ObjectType type) {
+    ObjectConfigType conf = config(type);
+    mtx_assets.lock();
+    if (type_files.find(type) == type_files.end()) {
+        typeFiles(type, conf);
+        meshes[type] = std::async(std::launch::async, decodeMesh, conf);
+    }
+    mtx_assets.unlock();
+}
+
+/**
+ * Mesh of an object type (render thread, once per model), waits for its decoding if it is not done yet
+ * (decoded now if it was not prefetched, or already taken)
+ *
+ * @param type object type
+ * @return the mesh, with no VBO yet
+ */
+std::unique_ptr<Mesh> takeMesh(ObjectType type) {
+    std::future<std::unique_ptr<Mesh>> pending;
+    mtx_assets.lock();
+    std::map<ObjectType, std::future<std::unique_ptr<Mesh>>>::iterator it = meshes.find(type);
+    if (it != meshes.end()) {
+        pending = std::move(it->second);
+        meshes.erase(it);
+    }
+    mtx_assets.unlock();
+
+    if (pending.valid()) return pending.get();
+    return decodeMesh(config(type));
+}
+
+/**
+ * Files of an object type (render thread), waits for their decoding if it is not done yet
+ *
+ * @param type object type
+ * @return the files, shared by the objects of this type
+ */
+std::shared_ptr<const Files> files(ObjectType type) {
+    ObjectConfigType conf = config(type);
+    mtx_assets.lock();
+    std::shared_future<std::shared_ptr<const Files>> pending = typeFiles(type, conf);
+    mtx_assets.unlock();
+    return pending.get();
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+// Assets of the objects, decoded on background threads while the game is WAITING
+//
+// The first OBJECT message of a type starts the decoding of its mesh (OBJ parsed, corrected, normals computed), of
+// its image and of its sound. Nothing here calls OpenGL nor OpenAL: once the window exists, the model of the type
+// (see ObjectModel) only has to upload them.
+
+#include <memory>
+#include <string>
+
+#include <Mesh.h>
+#include "commons.h"
+
+struct SDL_Surface;
+
+namespace assets {
+
+/**
+ * Image and sound of an object type
+ */
+struct Files {
+    SDL_Surface *image; // texture, flipped (see Texture2D::loadImage), nullptr if it can not be loaded
+    std::string sound; // content of the WAV file
+
+    Files(): image(nullptr), sound() {}
+    ~Files();
+    Files(const Files&) = delete;
+    Files& operator=(const Files&) = delete;
+};
+
+/**
+ * An object of this type is coming: decode the mesh and the files of its type in the background (once)
+ *
+ * @param type object type
+ */
+void prefetch(ObjectType type);
+
+/**
+ * Mesh of an object type (render thread, once per model), waits for its decoding if it is not done yet
+ * (decoded now if it was not prefetched, or already taken)
+ *
+ * @param type object type
+ * @return the mesh, with no VBO yet
+ */
+std::unique_ptr<Mesh> takeMesh(ObjectType type);
+
+/**
+ * Files of an object type (render thread), waits for their decoding if it is not done yet
+ *
+ * @param type object type
+ * @return the files, shared by the objects of this type
+ */
+std::shared_ptr<const Files> files(ObjectType type);
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include <math.h>
+#include <algorithm>
+
+#include <utils.h>
+
+#include "Avatars.h"
+
+// time between two updates assumed for a new player, until his updates tell
+static const double FIRST_INTERVAL = 0.1;
+
+
+Avatars::Avatars() {}
+
+
+/**
+ * To take into account a change of another player
+ *
+ * @param event the change, from the network thread
+ */
+void Avatars::onPlayerEvent(const PlayerEvent &event) {
+    if (event.type != PlayerEvent::MOVED) {
+        m_Avatars.erase(event.id);
+        return;
+    }
+    Sample sample = {event.time, {event.pos[0], event.pos[1], event.pos[2]}, event.azimut};
+
+    std::map<unsigned int, Avatar>::iterator it = m_Avatars.find(event.id);
+    if (it == m_Avatars.end()) {
+        m_Avatars[event.id] = {{sample}, FIRST_INTERVAL, 0};
+        return;
+    }
+    Avatar &avatar = it->second;
+
+    double elapsed = sample.time - avatar.samples.back().time;
+    if (elapsed > MAX_INTERPOLATION_DELAY) {
+        // he stood still since his last update (nothing sent) : he starts moving just before this one
+        Sample still = avatar.samples.back();
+        still.time = sample.time - avatar.interval;
+        avatar.samples.push_back(still);
+        elapsed = avatar.interval;
+    }
+    avatar.deviation += (fabs(elapsed - avatar.interval) - avatar.deviation) / 4;
+    avatar.interval += (elapsed - avatar.interval) / 8;
+
+    avatar.samples.push_back(sample);
+    while (avatar.samples.size() > JITTER_SAMPLES) avatar.samples.pop_front();
+}
+
+
+/**
+ * Interpolate every avatar
+ *
+ * @param now current time, see monotonic_time()
+ * @return model matrix of each avatar (16 floats per avatar, column-major)
+ */
+const std::vector<GLfloat>& Avatars::update(double now) {
+    m_Matrices.clear();
+
+    for (std::map<unsigned int, Avatar>::iterator it = m_Avatars.begin() ; it != m_Avatars.end() ; ++it) {
+        Avatar &avatar = it->second;
+        double delay = std::min(std::max(avatar.interval + 2 * avatar.deviation, MIN_INTERPOLATION_DELAY), MAX_INTERPOLATION_DELAY);
+        double t = now - delay;
+
+        // positions already passed (the last one before t is kept)
+        while (avatar.samples.size() > 1 && avatar.samples[1].time <= t) avatar.samples.pop_front();
+
+        const Sample &from = avatar.samples.front();
+        float pos[3] = {from.pos[0], from.pos[1], from.pos[2]};
+        float azimut = from.azimut;
+        if (avatar.samples.size() > 1 && t > from.time) {
+            const Sample &to = avatar.samples[1];
+            float k = (float) ((t - from.time) / (to.time - from.time));
+            for (int i = 0 ; i < 3 ; i++) pos[i] += k * (to.pos[i] - from.pos[i]);
+            // the shortest way round
+            float turn = fmodf(to.azimut - from.azimut, 360.0f);
+            if (turn > 180.0f) turn -= 360.0f;
+            else if (turn < -180.0f) turn += 360.0f;
+            azimut += k * turn;
+        }
+
+        // translation, then rotation around y (as the third-person avatar)
+        float a = -Utils::radians(azimut);
+        GLfloat c = cosf(a), s = sinf(a);
+        GLfloat matrix[16] = {
+            c, 0, -s, 0,
+            0, 1, 0, 0,
+            s, 0, c, 0,
+            pos[0], pos[1], pos[2], 1
+        };
+        m_Matrices.insert(m_Matrices.end(), matrix, matrix + 16);
+    }
+    return m_Matrices;
+}
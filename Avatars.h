@@ -0,0 +1,67 @@
+#ifndef AVATARS_H
+#define AVATARS_H
+
+// Avatars of the other players in my area of interest, drawn a little in the past (render thread)
+//
+// Each player has a jitter buffer of the positions received for him, timestamped on reception. He is drawn at
+// now - delay, between the two positions around this time: the delay follows the mean interval between his updates
+// and its deviation, so that there is almost always a next position to go to, even at a low server tick rate.
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "commons.h"
+
+// positions kept per player
+#define JITTER_SAMPLES 32U
+// bounds of the interpolation delay (seconds)
+#define MIN_INTERPOLATION_DELAY 0.05
+#define MAX_INTERPOLATION_DELAY 0.5
+
+
+class Avatars
+{
+private:
+
+    /** position of a player, as received */
+    struct Sample {
+        double time;
+        float pos[3];
+        float azimut; // degrees
+    };
+
+    struct Avatar {
+        std::deque<Sample> samples; // oldest first
+        double interval; // mean time between two updates
+        double deviation; // mean deviation of this time
+    };
+
+    std::map<unsigned int, Avatar> m_Avatars;
+
+    // model matrix of each avatar, rebuilt at each frame
+    std::vector<GLfloat> m_Matrices;
+
+public:
+
+    Avatars();
+
+    /**
+     * To take into account a change of another player
+     *
+     * @param event the change, from the network thread
+     */
+    void onPlayerEvent(const PlayerEvent &event);
+
+    /**
+     * Interpolate every avatar
+     *
+     * @param now current time, see monotonic_time()
+     * @return model matrix of each avatar (16 floats per avatar, column-major)
+     */
+    const std::vector<GLfloat>& update(double now);
+};
+
+#endif
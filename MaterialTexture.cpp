@@ -17,8 +17,54 @@
  * @param filename : nom du fichier contenant l'image à charger
  * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
  * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
+ * @param instanced : variante instanciée, matVM est alors la matrice de la caméra et chaque instance a sa matrice (setInstances)
  */
-MaterialTexture::MaterialTexture(std::string filename, GLenum filtering, GLenum repetition) : Material("MaterialTexture")
+MaterialTexture::MaterialTexture(std::string filename, GLenum filtering, GLenum repetition, bool instanced) : Material(instanced ? "MaterialTextureInstanced" : "MaterialTexture")
+{
+    createShaders(instanced);
+
+    /** charger la texture */
+    m_Texture = new Texture2D(filename, filtering, repetition);
+    m_OwnsTexture = true;
+}
+
+
+/**
+ * constructeur, avec une image déjà chargée (voir Texture2D::loadImage)
+ * @param image : image retournée verticalement, elle n'est pas libérée
+ * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
+ * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
+ * @param instanced : variante instanciée, matVM est alors la matrice de la caméra et chaque instance a sa matrice (setInstances)
+ */
+MaterialTexture::MaterialTexture(SDL_Surface* image, GLenum filtering, GLenum repetition, bool instanced) : Material(instanced ? "MaterialTextureInstanced" : "MaterialTexture")
+{
+    createShaders(instanced);
+
+    /** envoyer la texture */
+    m_Texture = new Texture2D(image, filtering, repetition);
+    m_OwnsTexture = true;
+}
+
+
+/**
+ * constructeur, avec une texture partagée entre plusieurs matériaux
+ * @param texture : texture déjà envoyée, elle n'est pas libérée (elle doit survivre au matériau)
+ * @param instanced : variante instanciée, matVM est alors la matrice de la caméra et chaque instance a sa matrice (setInstances)
+ */
+MaterialTexture::MaterialTexture(Texture2D* texture, bool instanced) : Material(instanced ? "MaterialTextureInstanced" : "MaterialTexture")
+{
+    createShaders(instanced);
+
+    m_Texture = texture;
+    m_OwnsTexture = false;
+}
+
+
+/**
+ * compile le shader et trouve ses variables
+ * @param instanced : variante instanciée
+ */
+void MaterialTexture::createShaders(bool instanced)
 {
     /** définir le shader */
 
@@ -48,6 +94,37 @@ MaterialTexture::MaterialTexture(std::string filename, GLenum filtering, GLenum
         "    frgTexCoords = glTexCoords;\n"
         "}";
 
+    // variante instanciée : matVM = caméra, la matrice de l'objet vient de l'instance (rotation et translation seulement)
+    if (instanced) {
+        srcVertexShader =
+            "#version 300 es\n"
+            "// matrices de transformation\n"
+            "uniform mat4 matP;\n"
+            "uniform mat4 matVM;\n"
+            "\n"
+            "// informations des sommets (VBO)\n"
+            "in vec3 glVertex;\n"
+            "in vec3 glNormal;\n"
+            "in vec2 glTexCoords;\n"
+            "\n"
+            "// matrice de l'instance (VBO, une par instance)\n"
+            "in mat4 glInstance;\n"
+            "\n"
+            "// calculs allant vers le fragment shader\n"
+            "out vec3 frgN;              // normale du fragment en coordonnées caméra\n"
+            "out vec4 frgPosition;       // position du fragment en coordonnées caméra\n"
+            "out vec2 frgTexCoords;\n"
+            "\n"
+            "void main()\n"
+            "{\n"
+            "    mat4 matInstance = matVM * glInstance;\n"
+            "    frgPosition = matInstance * vec4(glVertex, 1.0);\n"
+            "    gl_Position = matP * frgPosition;\n"
+            "    frgN = mat3(matInstance) * glNormal;\n"
+            "    frgTexCoords = glTexCoords;\n"
+            "}";
+    }
+
     // fragment shader
     std::string srcFragmentShader =
         "#version 300 es\n"
@@ -109,9 +186,12 @@ MaterialTexture::MaterialTexture(std::string filename, GLenum filtering, GLenum
     m_CosMaxAngleLoc    = glGetUniformLocation(m_ShaderId, "cosmaxangle");
     m_CosMinAngleLoc    = glGetUniformLocation(m_ShaderId, "cosminangle");
 
-    /** charger la texture */
+    /** texture */
     m_TextureLoc = glGetUniformLocation(m_ShaderId, "txColor");
-    m_Texture = new Texture2D(filename, filtering, repetition);
+
+    /** matrices des instances */
+    m_InstanceLoc = instanced ? glGetAttribLocation(m_ShaderId, "glInstance") : -1;
+    m_InstanceBufferId = 0;
 }
 
 
@@ -133,6 +213,16 @@ void MaterialTexture::setLight(Light* light)
 }
 
 
+/**
+ * définit les matrices des instances (variante instanciée)
+ * @param instancebufferid : VBO contenant une mat4 par instance
+ */
+void MaterialTexture::setInstances(GLuint instancebufferid)
+{
+    m_InstanceBufferId = instancebufferid;
+}
+
+
 void MaterialTexture::select(Mesh* mesh, const mat4& matP, const mat4& matVM)
 {
     // méthode de la superclasse (active le shader)
@@ -140,6 +230,16 @@ void MaterialTexture::select(Mesh* mesh, const mat4& matP, const mat4& matVM)
 
     // activer la texture sur l'unité 0
     m_Texture->setTextureUnit(GL_TEXTURE0, m_TextureLoc);
+
+    // une mat4 par instance : 4 colonnes vec4, l'attribut avance d'une instance à l'autre
+    if (m_InstanceLoc >= 0 && m_InstanceBufferId != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBufferId);
+        for (int i = 0; i < 4; i++) {
+            glEnableVertexAttribArray(m_InstanceLoc + i);
+            glVertexAttribPointer(m_InstanceLoc + i, Utils::VEC4, GL_FLOAT, GL_FALSE, 16 * sizeof(GLfloat), (const GLvoid*) (i * 4 * sizeof(GLfloat)));
+            glVertexAttribDivisor(m_InstanceLoc + i, 1);
+        }
+    }
 }
 
 
@@ -148,6 +248,14 @@ void MaterialTexture::deselect()
     // libérer le sampler
     m_Texture->setTextureUnit(GL_TEXTURE0);
 
+    // désactiver les matrices des instances
+    if (m_InstanceLoc >= 0) {
+        for (int i = 0; i < 4; i++) {
+            glVertexAttribDivisor(m_InstanceLoc + i, 0);
+            glDisableVertexAttribArray(m_InstanceLoc + i);
+        }
+    }
+
     // méthode de la superclasse (désactive le shader)
     Material::deselect();
 }
@@ -155,6 +263,6 @@ void MaterialTexture::deselect()
 
 MaterialTexture::~MaterialTexture()
 {
-    delete m_Texture;
+    if (m_OwnsTexture) delete m_Texture;
 }
 
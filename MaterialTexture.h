@@ -13,9 +13,10 @@ class MaterialTexture: public Material
 {
 private:
 
-    // texture
+    // texture, libérée avec le matériau sauf si elle est partagée
     GLint m_TextureLoc;
     Texture2D* m_Texture;
+    bool m_OwnsTexture;
 
     // variables uniform du shader
     int m_LightColorLoc;
@@ -24,6 +25,16 @@ private:
     int m_CosMaxAngleLoc;
     int m_CosMinAngleLoc;
 
+    // variante instanciée : matrice de chaque instance (4 attributs vec4 consécutifs) et leur VBO
+    GLint m_InstanceLoc;
+    GLuint m_InstanceBufferId;
+
+    /**
+     * compile le shader et trouve ses variables
+     * @param instanced : variante instanciée
+     */
+    void createShaders(bool instanced);
+
 
 public:
 
@@ -32,8 +43,25 @@ public:
      * @param filename : nom du fichier contenant l'image à charger
      * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
      * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
+     * @param instanced : variante instanciée, matVM est alors la matrice de la caméra et chaque instance a sa matrice (setInstances)
      */
-    MaterialTexture(std::string filename, GLenum filtering=GL_LINEAR, GLenum repetition=GL_CLAMP_TO_EDGE);
+    MaterialTexture(std::string filename, GLenum filtering=GL_LINEAR, GLenum repetition=GL_CLAMP_TO_EDGE, bool instanced=false);
+
+    /**
+     * constructeur, avec une image déjà chargée (voir Texture2D::loadImage)
+     * @param image : image retournée verticalement, elle n'est pas libérée
+     * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
+     * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
+     * @param instanced : variante instanciée, matVM est alors la matrice de la caméra et chaque instance a sa matrice (setInstances)
+     */
+    MaterialTexture(SDL_Surface* image, GLenum filtering=GL_LINEAR, GLenum repetition=GL_CLAMP_TO_EDGE, bool instanced=false);
+
+    /**
+     * constructeur, avec une texture partagée entre plusieurs matériaux
+     * @param texture : texture déjà envoyée, elle n'est pas libérée (elle doit survivre au matériau)
+     * @param instanced : variante instanciée, matVM est alors la matrice de la caméra et chaque instance a sa matrice (setInstances)
+     */
+    MaterialTexture(Texture2D* texture, bool instanced=false);
 
 
     /**
@@ -42,6 +70,12 @@ public:
      */
     virtual void setLight(Light* light);
 
+    /**
+     * définit les matrices des instances (variante instanciée)
+     * @param instancebufferid : VBO contenant une mat4 par instance
+     */
+    void setInstances(GLuint instancebufferid);
+
 
     virtual void select(Mesh* mesh, const mat4& matP, const mat4& matVM);
 
@@ -53,11 +53,11 @@ std::map<ObjectType, ObjectConfigType> objects_config = {
 
 
 /**
- * constructeur, crée le maillage
+ * constructeur, utilise le modèle du type (chargé par le premier objet de ce type)
  *
  * @param type object type
  */
-Object::Object(ObjectType type): Mesh("Object") {
+Object::Object(ObjectType type) {
     std::map<ObjectType, ObjectConfigType>::iterator it = objects_config.find(type);
     if (it == objects_config.end()) {
         std::cerr << "Unable to find this object type..." << std::endl;
@@ -66,39 +66,14 @@ Object::Object(ObjectType type): Mesh("Object") {
     }
     ObjectConfigType conf = it->second;
 
-    // matériaux
-    m_Material = new MaterialTexture("data/"+conf.diffuse_img);
-    setMaterials(m_Material);
+    // maillage, texture et buffer audio partagés
+    m_Model = ObjectModel::get(type);
     m_Draw = false;
     m_Sound = false;
 
-    // charger le fichier obj
-    loadObj("data/"+conf.obj_file);
-
-    // mise à l'échelle et rotation de l'objet (si son .obj est mal orienté et trop grand/petit)
-    mat4 correction = mat4::create();
-    mat4::identity(correction);
-    mat4::scale(correction, correction, vec3::fromValues(conf.ratio, conf.ratio, conf.ratio));
-    mat4::rotateX(correction, correction, Utils::radians(conf.rotation_x));
-    mat4::rotateY(correction, correction, Utils::radians(conf.rotation_y));
-    mat4::rotateZ(correction, correction, Utils::radians(conf.rotation_z));
-    transform(correction);
-
-    // recalcul des normales
-    computeNormals();
-
-    // ouverture du flux audio à placer dans le buffer
-    std::string soundpathname = "data/"+conf.sound_file;
-    buffer = alutCreateBufferFromFile(soundpathname.c_str());
-    if (buffer == AL_NONE) {
-        std::cerr << "unable to open file " << soundpathname << std::endl;
-        alGetError();
-        throw std::runtime_error("file not found or not readable");
-    }
-
     // lien buffer -> source
     alGenSources(1, &source);
-    alSourcei(source, AL_BUFFER, buffer);
+    alSourcei(source, AL_BUFFER, m_Model->getBuffer());
 
     // propriétés de la source à l'origine
     alSource3f(source, AL_POSITION, 0, 0, 0); // on positionne la source à (0,0,0) par défaut
@@ -123,7 +98,7 @@ Object::Object(ObjectType type): Mesh("Object") {
  */
 void Object::setLight(Light* light)
 {
-    m_Material->setLight(light);
+    m_Model->setLight(light);
 }
 
 void Object::setDraw(bool b)
@@ -138,6 +113,40 @@ void Object::setSound(bool b)
 	m_Sound = b;
 }
 
+/**
+ * place et oriente l'objet
+ * @param mat : matrice résultat
+ * @param base : matrice à laquelle appliquer la position de l'objet
+ */
+void Object::transform(mat4& mat, const mat4& base)
+{
+   	mat4::translate(mat, base, m_Position);
+   	mat4::rotateX(mat, mat, m_Orientation[0]);
+   	mat4::rotateY(mat, mat, m_Orientation[1]);//-Utils::Time * 0.8);
+   	mat4::rotateZ(mat, mat, m_Orientation[2]);
+}
+
+
+/**
+ * positionne la source sonore par rapport à la caméra
+ * @param matVM : matrice view*model de l'objet
+ */
+void Object::placeSound(const mat4& matVM)
+{
+    // obtenir la position relative à la caméra
+    vec4 pos = vec4::fromValues(0,0,0,1);   // point en (0,0,0)
+    vec4::transformMat4(pos, pos, matVM);
+    //std::cout << "Position = " << vec4::str(pos);
+    alSource3f(source, AL_POSITION, pos[0], pos[1], pos[2]);
+
+    // obtenir la direction relative à la caméra
+    vec4 dir = vec4::fromValues(0,0,1,0);   // vecteur +z
+    vec4::transformMat4(dir, dir, matVM);
+    //std::cout << "    Direction = " << vec4::str(dir) << std::endl;
+    alSource3f(source, AL_DIRECTION, dir[0], dir[1], dir[2]);
+}
+
+
 /**
      * dessiner le cube
      * @param matP : matrice de projection
@@ -147,35 +156,66 @@ void Object::onRender(const mat4& matP, const mat4& matVM)
 {
    	/** dessin OpenGL **/
    	mat4 local_vm;
-  	mat4::translate(local_vm, matVM, m_Position);
-   	mat4::rotateX(local_vm, local_vm, m_Orientation[0]);
-   	mat4::rotateY(local_vm, local_vm, m_Orientation[1]);//-Utils::Time * 0.8);
-   	mat4::rotateZ(local_vm, local_vm, m_Orientation[2]);
+   	transform(local_vm, matVM);
 
     if (m_Draw)
     {
-	    onDraw(matP, local_vm);
+	    m_Model->onDraw(matP, local_vm);
 	}
 
     /** sonorisation OpenAL **/
 
     if (m_Sound)
     {
-	    // obtenir la position relative à la caméra
-	    vec4 pos = vec4::fromValues(0,0,0,1);   // point en (0,0,0)
-	    vec4::transformMat4(pos, pos, local_vm);
-	    //std::cout << "Position = " << vec4::str(pos);
-	    alSource3f(source, AL_POSITION, pos[0], pos[1], pos[2]);
-
-	    // obtenir la direction relative à la caméra
-	    vec4 dir = vec4::fromValues(0,0,1,0);   // vecteur +z
-	    vec4::transformMat4(dir, dir, local_vm);
-	    //std::cout << "    Direction = " << vec4::str(dir) << std::endl;
-	    alSource3f(source, AL_DIRECTION, dir[0], dir[1], dir[2]);
+	    placeSound(local_vm);
 	}
 }
 
 
+/**
+ * ajoute l'objet, s'il est affiché, aux exemplaires de son modèle à dessiner en un seul appel
+ * (voir ObjectModel::onRenderInstances) et positionne sa source sonore
+ * @param matV : matrice de la caméra
+ * @param matrices : matrices des exemplaires du modèle (16 flottants par exemplaire, par colonnes)
+ */
+void Object::onRenderInstance(const mat4& matV, std::vector<GLfloat>& matrices)
+{
+    if (m_Draw)
+    {
+        mat4 local_m = mat4::create();
+        mat4::identity(local_m);
+        transform(local_m, local_m);
+        for (int i = 0 ; i < 16 ; i++) matrices.push_back(local_m[i]);
+    }
+
+    if (m_Sound)
+    {
+        mat4 local_vm;
+        transform(local_vm, matV);
+        placeSound(local_vm);
+    }
+}
+
+
+/**
+ * dessiner plusieurs exemplaires du modèle de l'objet en un seul appel (sans son)
+ * @param matP : matrice de projection
+ * @param matV : matrice de la caméra
+ * @param matrices : matrice de chaque exemplaire dans la scène (16 flottants par exemplaire, par colonnes)
+ */
+void Object::onRenderInstances(const mat4& matP, const mat4& matV, const std::vector<GLfloat>& matrices)
+{
+    m_Model->onRenderInstances(matP, matV, matrices);
+}
+
+
+
+ObjectModel* Object::getModel()
+{
+    return m_Model.get();
+}
+
+
 
 vec3& Object::getPosition()
 {
@@ -203,10 +243,6 @@ void Object::setOrientation(vec3 ori)
 /** destructeur */
 Object::~Object()
 {
-    // libération du matériau
-    delete m_Material;
-
-    // libération des ressources openal
+    // libération de la source, le buffer est libéré avec le modèle
     alDeleteSources(1, &source);
-    alDeleteBuffers(1, &buffer);
 }
@@ -3,22 +3,23 @@
 
 // Définition de la classe Duck
 
-#include <Mesh.h>
 #include <Light.h>
-#include <MaterialTexture.h>
 #include <gl-matrix.h>
 #include "commons.h"
+#include "ObjectModel.h"
 
-class Object: public Mesh
+/**
+ * Un objet de la scène : sa position et sa source sonore, le reste est partagé avec les objets du même type
+ */
+class Object
 {
 private:
 
-    /** matériau */
-    MaterialTexture* m_Material;
+    /** maillage, texture et buffer audio du type */
+    std::shared_ptr<ObjectModel> m_Model;
 
-
-    /** buffers pour la gestion du son */
-    ALuint buffer, source;
+    /** source sonore de cet objet */
+    ALuint source;
 
     /** position 3D du cube */
     vec3 m_Position;
@@ -28,18 +29,34 @@ private:
 
     bool m_Draw, m_Sound;
 
+    /**
+     * place et oriente l'objet
+     * @param mat : matrice résultat
+     * @param base : matrice à laquelle appliquer la position de l'objet
+     */
+    void transform(mat4& mat, const mat4& base);
+
+    /**
+     * positionne la source sonore par rapport à la caméra
+     * @param matVM : matrice view*model de l'objet
+     */
+    void placeSound(const mat4& matVM);
+
 public:
 
     /**
-     * constructeur, crée le maillage
+     * constructeur, utilise le modèle du type (chargé par le premier objet de ce type)
      *
      * @param type object type
      */
     Object(ObjectType type);
 
-    /** destructeur, libère le maillage et l'audio */
+    /** destructeur, libère la source sonore (et le modèle avec le dernier objet du type) */
     ~Object();
 
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+
     /**
      * dessiner le canard
      * @param matP : matrice de projection
@@ -47,6 +64,28 @@ public:
      */
     void onRender(const mat4& matP, const mat4& matMV);
 
+    /**
+     * dessiner plusieurs exemplaires du modèle de l'objet en un seul appel (sans son)
+     * @param matP : matrice de projection
+     * @param matV : matrice de la caméra
+     * @param matrices : matrice de chaque exemplaire dans la scène (16 flottants par exemplaire, par colonnes)
+     */
+    void onRenderInstances(const mat4& matP, const mat4& matV, const std::vector<GLfloat>& matrices);
+
+    /**
+     * ajoute l'objet, s'il est affiché, aux exemplaires de son modèle à dessiner en un seul appel
+     * (voir ObjectModel::onRenderInstances) et positionne sa source sonore
+     * @param matV : matrice de la caméra
+     * @param matrices : matrices des exemplaires du modèle (16 flottants par exemplaire, par colonnes)
+     */
+    void onRenderInstance(const mat4& matV, std::vector<GLfloat>& matrices);
+
+    /**
+     * modèle partagé par les objets du même type
+     * @return le modèle
+     */
+    ObjectModel* getModel();
+
     /**
      * retourne la position % scèce du cube
      * @return vec3 position
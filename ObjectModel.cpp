@@ -0,0 +1,134 @@
+// Définition de la classe ObjectModel
+
+#include <iostream>
+#include <map>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <AL/al.h>
+#include <AL/alut.h>
+
+#include <utils.h>
+
+#include <ObjectModel.h>
+
+
+/** modèles chargés, libérés avec le dernier objet qui les utilise (thread de rendu) */
+static std::map<ObjectType, std::weak_ptr<ObjectModel>> models;
+
+
+/**
+ * modèle d'un type, chargé s'il n'est plus utilisé par aucun objet
+ *
+ * @param type object type
+ * @return le modèle, partagé
+ */
+std::shared_ptr<ObjectModel> ObjectModel::get(ObjectType type)
+{
+    std::shared_ptr<ObjectModel> model = models[type].lock();
+    if (model == nullptr) {
+        model = std::shared_ptr<ObjectModel>(new ObjectModel(type));
+        models[type] = model;
+    }
+    return model;
+}
+
+
+/**
+ * constructeur, charge le type (voir get)
+ *
+ * @param type object type
+ */
+ObjectModel::ObjectModel(ObjectType type): Mesh("Object")
+{
+    std::map<ObjectType, ObjectConfigType>::iterator it = objects_config.find(type);
+    if (it == objects_config.end()) {
+        std::cerr << "Unable to find this object type..." << std::endl;
+        alGetError();
+        throw std::runtime_error("Unknown object type");
+    }
+    ObjectConfigType conf = it->second;
+
+    // image et son, décodés en arrière-plan depuis l'annonce des objets (voir assets::prefetch)
+    m_Files = assets::files(type);
+    if (m_Files->image == nullptr) exit(EXIT_FAILURE);
+
+    // texture, partagée par les matériaux
+    m_Texture = new Texture2D(m_Files->image, GL_LINEAR, GL_CLAMP_TO_EDGE);
+
+    // matériaux
+    m_Material = new MaterialTexture(m_Texture);
+    setMaterials(m_Material);
+    m_InstancesMaterial = nullptr;
+    m_InstanceBufferId = 0;
+    m_Light = nullptr;
+
+    // maillage décodé en arrière-plan : fichier obj chargé, mis à l'échelle, tourné, normales recalculées
+    takeGeometry(assets::takeMesh(type).get());
+
+    // flux audio lu en arrière-plan, à placer dans le buffer
+    std::string soundpathname = "data/"+conf.sound_file;
+    m_Buffer = alutCreateBufferFromFileImage(m_Files->sound.data(), (ALsizei) m_Files->sound.size());
+    if (m_Buffer == AL_NONE) {
+        std::cerr << "unable to open file " << soundpathname << std::endl;
+        alGetError();
+        delete m_Material;
+        delete m_Texture;
+        throw std::runtime_error("file not found or not readable");
+    }
+}
+
+
+/**
+ * définit la lampe
+ * @param light : instance de Light spécifiant les caractéristiques de la lampe
+ */
+void ObjectModel::setLight(Light* light)
+{
+    m_Material->setLight(light);
+    if (m_InstancesMaterial != nullptr) m_InstancesMaterial->setLight(light);
+    m_Light = light;
+}
+
+
+/**
+ * dessiner plusieurs exemplaires du modèle en un seul appel
+ * @param matP : matrice de projection
+ * @param matV : matrice de la caméra
+ * @param matrices : matrice de chaque exemplaire dans la scène (16 flottants par exemplaire, par colonnes)
+ */
+void ObjectModel::onRenderInstances(const mat4& matP, const mat4& matV, const std::vector<GLfloat>& matrices)
+{
+    if (matrices.empty()) return;
+
+    if (m_InstancesMaterial == nullptr) {
+        m_InstancesMaterial = new MaterialTexture(m_Texture, true);
+        if (m_Light != nullptr) m_InstancesMaterial->setLight(m_Light);
+        glGenBuffers(1, &m_InstanceBufferId);
+        m_InstancesMaterial->setInstances(m_InstanceBufferId);
+    }
+
+    // nouvelles matrices à chaque image : le buffer précédent est abandonné au pilote
+    glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBufferId);
+    glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(GLfloat), matrices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    onDrawInstanced(m_InstancesMaterial, matP, matV, (GLsizei) (matrices.size() / 16));
+}
+
+
+/** destructeur */
+ObjectModel::~ObjectModel()
+{
+    // libération des matériaux, puis de leur texture
+    delete m_Material;
+    if (m_InstancesMaterial != nullptr) {
+        delete m_InstancesMaterial;
+        glDeleteBuffers(1, &m_InstanceBufferId);
+    }
+    delete m_Texture;
+
+    // libération du buffer audio (les sources des objets sont déjà supprimées)
+    alDeleteBuffers(1, &m_Buffer);
+}
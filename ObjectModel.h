@@ -0,0 +1,84 @@
+#ifndef OBJECTMODEL_H
+#define OBJECTMODEL_H
+
+// Définition de la classe ObjectModel : ce que partagent les objets d'un même type
+
+#include <memory>
+#include <vector>
+
+#include <AL/al.h>
+
+#include <Mesh.h>
+#include <Light.h>
+#include <MaterialTexture.h>
+#include <gl-matrix.h>
+#include "commons.h"
+#include "Assets.h"
+
+/**
+ * Maillage (et ses VBOs), texture et buffer audio d'un type d'objet, chargés une seule fois
+ * et partagés par tous les objets de ce type : il est libéré avec le dernier d'entre eux.
+ */
+class ObjectModel: public Mesh
+{
+private:
+
+    /** texture du type, envoyée une seule fois et partagée par ses deux matériaux */
+    Texture2D* m_Texture;
+
+    /** matériau */
+    MaterialTexture* m_Material;
+
+    /** image et son du type, décodés en arrière-plan */
+    std::shared_ptr<const assets::Files> m_Files;
+
+    /** variante instanciée du matériau et VBO des matrices des instances (créés au premier dessin d'instances) */
+    MaterialTexture* m_InstancesMaterial;
+    GLuint m_InstanceBufferId;
+    Light* m_Light;
+
+    /** buffer audio, joué par la source de chaque objet */
+    ALuint m_Buffer;
+
+    /**
+     * constructeur, charge le type (voir get)
+     *
+     * @param type object type
+     */
+    ObjectModel(ObjectType type);
+
+public:
+
+    /**
+     * modèle d'un type, chargé s'il n'est plus utilisé par aucun objet
+     *
+     * @param type object type
+     * @return le modèle, partagé
+     */
+    static std::shared_ptr<ObjectModel> get(ObjectType type);
+
+    /** destructeur, libère le maillage, la texture et le buffer audio */
+    ~ObjectModel();
+
+    ObjectModel(const ObjectModel&) = delete;
+    ObjectModel& operator=(const ObjectModel&) = delete;
+
+    /**
+     * définit la lampe
+     * @param light : instance de Light spécifiant les caractéristiques de la lampe
+     */
+    void setLight(Light* light);
+
+    /**
+     * dessiner plusieurs exemplaires du modèle en un seul appel
+     * @param matP : matrice de projection
+     * @param matV : matrice de la caméra
+     * @param matrices : matrice de chaque exemplaire dans la scène (16 flottants par exemplaire, par colonnes)
+     */
+    void onRenderInstances(const mat4& matP, const mat4& matV, const std::vector<GLfloat>& matrices);
+
+    /** buffer audio du type */
+    ALuint getBuffer() const { return m_Buffer; }
+};
+
+#endif
@@ -0,0 +1,606 @@
+// Wire protocol shared by the client and the server
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <charconv>
+#include <cassert>
+#include <arpa/inet.h>
+
+#include "Protocol.h"
+
+namespace protocol {
+
+/**
+ * Object type code from its name
+ *
+ * @param name lower case type name
+ * @return the code, NB_OBJECT_TYPES if unknown
+ */
+uint8_t objectTypeCode(std::string_view name) {
+    for (uint8_t i = 0 ; i < NB_OBJECT_TYPES ; i++) {
+        if (name == OBJECT_TYPE_NAMES[i]) return i;
+    }
+    return NB_OBJECT_TYPES;
+}
+
+/**
+ * Is this a valid player name ?
+ *
+ * @param name the name
+ * @return true if it has 1 to MAX_NAME letters or digits
+ */
+bool isName(std::string_view name) {
+    if (name.empty() || name.size() > MAX_NAME) return false;
+    for (char c : name) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) return false;
+    }
+    return true;
+}
+
+/**
+ * Is a position sent by a client inside the world ? (false if not finite)
+ */
+static bool inWorld(const float pos[3]) {
+    return fabsf(pos[0]) <= MAX_COORDINATE && fabsf(pos[1]) <= MAX_COORDINATE && fabsf(pos[2]) <= MAX_COORDINATE;
+}
+
+/**
+ * Length of the first message of a stream
+ *
+ * @param data stream
+ * @param size number of bytes available
+ * @param consumed number of bytes to drop from the stream with this message (delimiter included)
+ * @return length of the message (frame header included, text delimiter excluded), or 0 if it is incomplete
+ */
+size_t nextMessage(const char *data, size_t size, size_t &consumed) {
+    consumed = 0;
+    if (size == 0) return 0;
+
+    if (isBinary(data)) {
+        if (size < HEADER_SIZE) return 0;
+        size_t length = HEADER_SIZE + (((size_t) (uint8_t) data[1] << 8) | (uint8_t) data[2]);
+        if (size < length) return 0;
+        consumed = length;
+        return length;
+    }
+
+    const char *end = (const char *) memchr(data, TEXT_DELIMITER, size);
+    if (end == nullptr) return 0;
+    consumed = (size_t) (end - data) + 1;
+    return (size_t) (end - data);
+}
+
+
+/*******************************
+ * Text encoding
+*******************************/
+
+/**
+ * Append a real number without exponent and useless zeros
+ */
+static void putNumber(std::string &out, float v) {
+    char buffer[64];
+    int n = snprintf(buffer, sizeof(buffer), "%.6f", (double) v);
+    if (n <= 0) return;
+    // remove trailing zeros (and the dot)
+    while (n > 1 && buffer[n-1] == '0') n--;
+    if (buffer[n-1] == '.') n--;
+    out.append(buffer, (size_t) n);
+}
+
+/**
+ * Encode a message with the text protocol (delimiter included)
+ *
+ * @param msg message
+ * @param out string to append to
+ */
+void encodeText(const Message &msg, std::string &out) {
+    switch (msg.type) {
+    case MSG_ID:
+        out += "ID=" + std::to_string(msg.id);
+        if (msg.value != 0) out += ":" + std::to_string(msg.value);
+        if (msg.token != 0 || msg.session != 0) out += ":" + std::to_string(msg.token);
+        if (msg.session != 0) out += ":" + std::to_string(msg.session);
+        break;
+    case MSG_OBJECT:
+        out += "OBJECT=" + std::to_string(msg.id) + ":";
+        out += msg.object_type < NB_OBJECT_TYPES ? OBJECT_TYPE_NAMES[msg.object_type] : "unknown";
+        for (int i = 0 ; i < 3 ; i++) {
+            out += ":";
+            putNumber(out, msg.pos[i]);
+        }
+        for (int i = 0 ; i < 3 ; i++) {
+            out += ":";
+            putNumber(out, msg.dir[i]);
+        }
+        break;
+    case MSG_PLAYER:
+        out += "PLAYER=" + std::to_string(msg.id) + ":" + msg.text + ":" + std::to_string(msg.value);
+        break;
+    case MSG_PLAYERLEFT:
+        out += "PLAYERLEFT=" + std::to_string(msg.id);
+        break;
+    case MSG_START:
+        out += "START";
+        break;
+    case MSG_PLAYERFIND:
+        out += "PLAYERFIND=" + std::to_string(msg.id) + ":" + std::to_string(msg.value);
+        break;
+    case MSG_WIN:
+        out += "WIN=" + std::to_string(msg.id);
+        break;
+    case MSG_TEXT:
+        out += msg.text;
+        break;
+    case MSG_USERNAME:
+        out += "USERNAME=" + msg.text;
+        if (msg.value != 0) out += ":" + std::to_string(msg.value);
+        break;
+    case MSG_POSITION:
+        out += "POSITION=";
+        putNumber(out, msg.pos[0]);
+        out += ":";
+        putNumber(out, msg.pos[1]);
+        out += ":";
+        putNumber(out, msg.pos[2]);
+        break;
+    case MSG_ASKSTART:
+        out += "ASKSTART";
+        break;
+    case MSG_FOUND:
+        out += "FOUND=" + std::to_string(msg.id);
+        break;
+    case MSG_PLAYERENTER:
+    case MSG_PLAYERMOVE:
+        out += (msg.type == MSG_PLAYERENTER ? "PLAYERENTER=" : "PLAYERMOVE=") + std::to_string(msg.id);
+        for (int i = 0 ; i < 3 ; i++) {
+            out += ":";
+            putNumber(out, msg.pos[i]);
+        }
+        break;
+    case MSG_PLAYEREXIT:
+        out += "PLAYEREXIT=" + std::to_string(msg.id);
+        break;
+    case MSG_RESUME:
+        out += "RESUME=" + std::to_string(msg.id) + ":" + std::to_string(msg.value) + ":" + std::to_string(msg.session);
+        break;
+    default:
+        return;
+    }
+    out += TEXT_DELIMITER;
+}
+
+
+/*******************************
+ * Text decoding
+*******************************/
+
+/**
+ * Read cursor over a text message
+ */
+struct TextCursor {
+    std::string_view s;
+
+    bool literal(std::string_view lit) {
+        if (s.substr(0, lit.size()) != lit) return false;
+        s.remove_prefix(lit.size());
+        return true;
+    }
+
+    bool u32(uint32_t &v) {
+        std::from_chars_result r = std::from_chars(s.data(), s.data() + s.size(), v);
+        if (r.ec != std::errc() || r.ptr == s.data()) return false;
+        s.remove_prefix((size_t) (r.ptr - s.data()));
+        return true;
+    }
+
+    bool u64(uint64_t &v) {
+        std::from_chars_result r = std::from_chars(s.data(), s.data() + s.size(), v);
+        if (r.ec != std::errc() || r.ptr == s.data()) return false;
+        s.remove_prefix((size_t) (r.ptr - s.data()));
+        return true;
+    }
+
+    bool f32(float &v) {
+        std::from_chars_result r = std::from_chars(s.data(), s.data() + s.size(), v, std::chars_format::fixed);
+        if (r.ec != std::errc() || r.ptr == s.data() || !isfinite(v)) return false;
+        s.remove_prefix((size_t) (r.ptr - s.data()));
+        return true;
+    }
+
+    bool word(std::string_view &w, bool lower_only) {
+        size_t n = 0;
+        while (n < s.size() && ((s[n] >= 'a' && s[n] <= 'z') ||
+               (!lower_only && ((s[n] >= 'A' && s[n] <= 'Z') || (s[n] >= '0' && s[n] <= '9'))))) n++;
+        if (n == 0) return false;
+        w = s.substr(0, n);
+        s.remove_prefix(n);
+        return true;
+    }
+
+    bool end() const {
+        return s.empty();
+    }
+};
+
+/**
+ * Decode a text message, without regex nor allocation (except for long names)
+ *
+ * @param data message, without delimiter
+ * @param msg decoded message
+ * @return false if the message is malformed or of an unknown command (msg.type is then MSG_UNKNOWN)
+ */
+bool decodeText(std::string_view data, Message &msg) {
+    TextCursor c = {data};
+    std::string_view w;
+    bool ok = false;
+
+    msg.type = MSG_UNKNOWN;
+    msg.id = 0;
+    msg.value = 0;
+    msg.object_type = 0;
+    msg.text.clear();
+    msg.token = 0;
+    msg.session = 0;
+
+    if (data.empty()) return false;
+
+    switch (data[0]) {
+    case 'A':
+        ok = c.literal("ASKSTART") && c.end();
+        msg.type = MSG_ASKSTART;
+        break;
+    case 'F':
+        ok = c.literal("FOUND=") && c.u32(msg.id) && c.end();
+        msg.type = MSG_FOUND;
+        break;
+    case 'I':
+        ok = c.literal("ID=") && c.u32(msg.id) &&
+             (c.end() || (c.literal(":") && c.u32(msg.value) && (c.end() || (c.literal(":") && c.u64(msg.token) &&
+             (c.end() || (c.literal(":") && c.u64(msg.session) && c.end()))))));
+        msg.type = MSG_ID;
+        break;
+    case 'O':
+        ok = c.literal("OBJECT=") && c.u32(msg.id) && c.literal(":") && c.word(w, true) &&
+             c.literal(":") && c.f32(msg.pos[0]) && c.literal(":") && c.f32(msg.pos[1]) && c.literal(":") && c.f32(msg.pos[2]) &&
+             c.literal(":") && c.f32(msg.dir[0]) && c.literal(":") && c.f32(msg.dir[1]) && c.literal(":") && c.f32(msg.dir[2]) && c.end();
+        if (ok) msg.object_type = objectTypeCode(w);
+        msg.type = MSG_OBJECT;
+        break;
+    case 'P':
+        if (c.literal("POSITION=")) {
+            ok = c.f32(msg.pos[0]) && c.literal(":") && c.f32(msg.pos[1]) && c.literal(":") && c.f32(msg.pos[2]) && c.end() && inWorld(msg.pos);
+            msg.dir[0] = 0;
+            msg.type = MSG_POSITION;
+        } else if (c.literal("PLAYERLEFT=")) {
+            ok = c.u32(msg.id) && c.end();
+            msg.type = MSG_PLAYERLEFT;
+        } else if (c.literal("PLAYERENTER=") || c.literal("PLAYERMOVE=")) {
+            msg.type = data[6] == 'E' ? MSG_PLAYERENTER : MSG_PLAYERMOVE;
+            ok = c.u32(msg.id) && c.literal(":") && c.f32(msg.pos[0]) && c.literal(":") && c.f32(msg.pos[1]) && c.literal(":") && c.f32(msg.pos[2]) && c.end();
+        } else if (c.literal("PLAYEREXIT=")) {
+            ok = c.u32(msg.id) && c.end();
+            msg.type = MSG_PLAYEREXIT;
+        } else if (c.literal("PLAYERFIND=")) {
+            ok = c.u32(msg.id) && c.literal(":") && c.u32(msg.value) && c.end();
+            msg.type = MSG_PLAYERFIND;
+        } else if (c.literal("PLAYER=")) {
+            ok = c.u32(msg.id) && c.literal(":") && c.word(w, false) && isName(w) && c.literal(":") && c.u32(msg.value) && c.end();
+            if (ok) msg.text.assign(w.data(), w.size());
+            msg.type = MSG_PLAYER;
+        }
+        break;
+    case 'R':
+        ok = c.literal("RESUME=") && c.u32(msg.id) && c.literal(":") && c.u32(msg.value) && c.literal(":") && c.u64(msg.session) && c.end();
+        msg.type = MSG_RESUME;
+        break;
+    case 'S':
+        ok = c.literal("START") && c.end();
+        msg.type = MSG_START;
+        break;
+    case 'U':
+        ok = c.literal("USERNAME=") && c.word(w, false) && isName(w) && (c.end() || (c.literal(":") && c.u32(msg.value) && c.end()));
+        if (ok) msg.text.assign(w.data(), w.size());
+        msg.type = MSG_USERNAME;
+        break;
+    case 'W':
+        ok = c.literal("WIN=") && c.u32(msg.id) && c.end();
+        msg.type = MSG_WIN;
+        break;
+    default:
+        break;
+    }
+
+    if (!ok) msg.type = MSG_UNKNOWN;
+    return ok;
+}
+
+
+/*******************************
+ * Binary encoding
+*******************************/
+
+static void putU8(std::string &out, uint8_t v) {
+    out += (char) v;
+}
+
+static void putU32(std::string &out, uint32_t v) {
+    v = htonl(v);
+    out.append((const char *) &v, sizeof(v));
+}
+
+static void putF32(std::string &out, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    putU32(out, bits);
+}
+
+static void putU64(std::string &out, uint64_t v) {
+    putU32(out, (uint32_t) (v >> 32));
+    putU32(out, (uint32_t) v);
+}
+
+static uint32_t getU32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return ntohl(v);
+}
+
+static uint64_t getU64(const char *p) {
+    return ((uint64_t) getU32(p) << 32) | getU32(p + 4);
+}
+
+static float getF32(const char *p) {
+    uint32_t bits = getU32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+/**
+ * Encode a message as a binary frame
+ *
+ * @param msg message
+ * @param out string to append to
+ */
+void encodeBinary(const Message &msg, std::string &out) {
+    size_t start = out.size();
+    putU8(out, (uint8_t) msg.type);
+    out.append(2, '\0'); // length, set at the end
+
+    switch (msg.type) {
+    case MSG_ID:
+        putU32(out, msg.id);
+        putU8(out, (uint8_t) msg.value);
+        if (msg.token != 0 || msg.session != 0) putU64(out, msg.token);
+        if (msg.session != 0) putU64(out, msg.session);
+        break;
+    case MSG_OBJECT:
+        putU32(out, msg.id);
+        putU8(out, msg.object_type);
+        for (int i = 0 ; i < 3 ; i++) putF32(out, msg.pos[i]);
+        for (int i = 0 ; i < 3 ; i++) putF32(out, msg.dir[i]);
+        break;
+    case MSG_PLAYER:
+        putU32(out, msg.id);
+        putU32(out, msg.value);
+        out += msg.text;
+        break;
+    case MSG_PLAYERLEFT:
+    case MSG_WIN:
+    case MSG_FOUND:
+    case MSG_PLAYEREXIT:
+    case MSG_SNAPSHOTACK:
+        putU32(out, msg.id);
+        break;
+    case MSG_SNAPSHOT:
+        putU32(out, msg.id);
+        putU32(out, msg.value);
+        assert(msg.text.size() <= MAX_PAYLOAD - 8); // a truncated delta can not be decoded (see snapshot::MAX_ENTITIES)
+        out += msg.text;
+        break;
+    case MSG_PLAYERENTER:
+    case MSG_PLAYERMOVE:
+        putU32(out, msg.id);
+        for (int i = 0 ; i < 3 ; i++) putF32(out, msg.pos[i]);
+        break;
+    case MSG_PLAYERFIND:
+        putU32(out, msg.id);
+        putU32(out, msg.value);
+        break;
+    case MSG_RESUME:
+        putU32(out, msg.id);
+        putU32(out, msg.value);
+        putU64(out, msg.session);
+        break;
+    case MSG_TEXT:
+        out += msg.text.substr(0, MAX_PAYLOAD);
+        break;
+    case MSG_USERNAME:
+        putU8(out, (uint8_t) msg.value);
+        out += msg.text;
+        break;
+    case MSG_POSITION:
+        for (int i = 0 ; i < 3 ; i++) putF32(out, msg.pos[i]);
+        putF32(out, msg.dir[0]);
+        break;
+    case MSG_START:
+    case MSG_ASKSTART:
+        break;
+    default:
+        out.resize(start);
+        return;
+    }
+
+    size_t length = out.size() - start - HEADER_SIZE;
+    out[start + 1] = (char) ((length >> 8) & 0xFF);
+    out[start + 2] = (char) (length & 0xFF);
+}
+
+/**
+ * Encode a message with the given protocol version
+ *
+ * @param msg message
+ * @param version 0 for text, binary otherwise
+ * @return the encoded message
+ */
+std::string encode(const Message &msg, uint8_t version) {
+    std::string out;
+    if (version == 0) {
+        encodeText(msg, out);
+    } else {
+        encodeBinary(msg, out);
+    }
+    return out;
+}
+
+/**
+ * Decode the payload of a binary frame (msg.type is already set)
+ */
+static bool decodePayload(const char *p, size_t length, Message &msg) {
+    msg.id = 0;
+    msg.value = 0;
+    msg.object_type = 0;
+    msg.text.clear();
+    msg.token = 0;
+    msg.session = 0;
+
+    switch (msg.type) {
+    case MSG_ID:
+        if (length != 5 && length != 13 && length != 21) return false;
+        msg.id = getU32(p);
+        msg.value = (uint8_t) p[4];
+        if (length >= 13) msg.token = getU64(p + 5);
+        if (length == 21) msg.session = getU64(p + 13);
+        return true;
+    case MSG_OBJECT:
+        if (length != 29) return false;
+        msg.id = getU32(p);
+        msg.object_type = (uint8_t) p[4];
+        for (int i = 0 ; i < 3 ; i++) msg.pos[i] = getF32(p + 5 + 4 * i);
+        for (int i = 0 ; i < 3 ; i++) msg.dir[i] = getF32(p + 17 + 4 * i);
+        return true;
+    case MSG_PLAYER:
+        if (length < 8) return false;
+        msg.id = getU32(p);
+        msg.value = getU32(p + 4);
+        msg.text.assign(p + 8, length - 8);
+        return isName(msg.text); // sent again to the text clients
+    case MSG_PLAYERLEFT:
+    case MSG_WIN:
+    case MSG_FOUND:
+    case MSG_PLAYEREXIT:
+    case MSG_SNAPSHOTACK:
+        if (length != 4) return false;
+        msg.id = getU32(p);
+        return true;
+    case MSG_SNAPSHOT:
+        if (length < 8) return false;
+        msg.id = getU32(p);
+        msg.value = getU32(p + 4);
+        msg.text.assign(p + 8, length - 8);
+        return true;
+    case MSG_PLAYERENTER:
+    case MSG_PLAYERMOVE:
+        if (length != 16) return false;
+        msg.id = getU32(p);
+        for (int i = 0 ; i < 3 ; i++) msg.pos[i] = getF32(p + 4 + 4 * i);
+        return true;
+    case MSG_PLAYERFIND:
+        if (length != 8) return false;
+        msg.id = getU32(p);
+        msg.value = getU32(p + 4);
+        return true;
+    case MSG_RESUME:
+        if (length != 16) return false;
+        msg.id = getU32(p);
+        msg.value = getU32(p + 4);
+        msg.session = getU64(p + 8);
+        return true;
+    case MSG_TEXT:
+        msg.text.assign(p, length);
+        return true;
+    case MSG_USERNAME:
+        if (length < 1) return false;
+        msg.value = (uint8_t) p[0];
+        msg.text.assign(p + 1, length - 1);
+        return isName(msg.text); // sent again inside PLAYER to the text clients
+    case MSG_POSITION:
+        if (length != 12 && length != 16) return false; // without azimut before SNAPSHOT_VERSION
+        for (int i = 0 ; i < 3 ; i++) msg.pos[i] = getF32(p + 4 * i);
+        msg.dir[0] = length == 16 ? getF32(p + 12) : 0;
+        return inWorld(msg.pos);
+    case MSG_START:
+    case MSG_ASKSTART:
+        return length == 0;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Decode a binary frame
+ *
+ * @param data frame (header included)
+ * @param size frame size
+ * @param msg decoded message
+ * @return false if the frame is malformed or of an unknown type (msg.type is then MSG_UNKNOWN)
+ */
+bool decodeBinary(const char *data, size_t size, Message &msg) {
+    bool ok = false;
+    msg.type = MSG_UNKNOWN;
+    if (size >= HEADER_SIZE) {
+        msg.type = (MessageType) (uint8_t) data[0];
+        ok = decodePayload(data + HEADER_SIZE, size - HEADER_SIZE, msg);
+    }
+    if (!ok) msg.type = MSG_UNKNOWN;
+    return ok;
+}
+
+
+/*******************************
+ * UDP channel
+*******************************/
+
+/**
+ * Encode a message as a datagram of the UDP channel
+ *
+ * @param token session token
+ * @param seq sequence number of the datagram
+ * @param msg message
+ * @return the datagram
+ */
+std::string encodeDatagram(uint64_t token, uint32_t seq, const Message &msg) {
+    std::string out;
+    putU64(out, token);
+    putU32(out, seq);
+    encodeBinary(msg, out);
+    return out;
+}
+
+/**
+ * Decode a datagram of the UDP channel
+ *
+ * @param data datagram
+ * @param size datagram size
+ * @param token session token
+ * @param seq sequence number of the datagram
+ * @param msg decoded message
+ * @return false if the datagram is malformed (or does not hold exactly one frame)
+ */
+bool decodeDatagram(const char *data, size_t size, uint64_t &token, uint32_t &seq, Message &msg) {
+    size_t consumed;
+    msg.type = MSG_UNKNOWN;
+    if (size <= DATAGRAM_HEADER_SIZE) return false;
+
+    token = getU64(data);
+    seq = getU32(data + 8);
+    data += DATAGRAM_HEADER_SIZE;
+    size -= DATAGRAM_HEADER_SIZE;
+
+    if (!isBinary(data) || nextMessage(data, size, consumed) != size) return false;
+    return decodeBinary(data, size, msg);
+}
+
+}
@@ -0,0 +1,215 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+// Wire protocol shared by the client and the server
+//
+// Text protocol (version 0): "COMMAND=arg:arg...$"
+// Binary protocol (version >= 1), negotiated with "USERNAME=<name>:<version>$" / "ID=<id>:<version>$" :
+//     u8 type | u16 payload length (big endian) | payload (big endian fixed-width fields)
+// Binary types are control characters, so a stream can mix both kinds of messages.
+//
+// UDP channel (version >= UDP_VERSION), on the same port as TCP, bound to the session by the token given in ID :
+//     u64 token | u32 sequence (per sender, older datagrams are dropped) | binary frame
+// It carries POSITION, SNAPSHOT and SNAPSHOTACK only, every other message stays on TCP.
+//
+// Sessions (version >= RESUME_VERSION) : ID also gives a resume token. After a lost connection, the client connects again
+// and sends "RESUME=<id>:<received>:<token>$" (received: messages read on TCP, SNAPSHOT and RESUME excluded); the server
+// answers RESUME and sends again the messages after <received>, or closes the connection if the session is gone.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+namespace protocol {
+
+// Version of the binary protocol (0 is the text protocol)
+const uint8_t VERSION = 4;
+
+// First version replicating the players with snapshots (see Snapshot.h) instead of PLAYER, PLAYERLEFT, PLAYERFIND and PLAYERENTER/MOVE/EXIT
+const uint8_t SNAPSHOT_VERSION = 2;
+
+// First version with the UDP channel
+const uint8_t UDP_VERSION = 3;
+
+// First version with resumable sessions
+const uint8_t RESUME_VERSION = 4;
+
+// To delimite each text msgs
+const char TEXT_DELIMITER = '$';
+
+// Binary frame header : type (1 byte) + payload length (2 bytes)
+const size_t HEADER_SIZE = 3;
+const size_t MAX_PAYLOAD = 0xFFFF;
+
+// Coordinates of a position sent by a client, farther ones are malformed (snapshots quantize them on 32 bits)
+const float MAX_COORDINATE = 1.0e6f;
+
+// Player names : 1 to MAX_NAME letters or digits, whatever the encoding (they are sent again inside text messages)
+const size_t MAX_NAME = 32;
+
+// Datagram header : token (8 bytes) + sequence (4 bytes)
+const size_t DATAGRAM_HEADER_SIZE = 12;
+// Larger messages are sent on TCP (no IP fragmentation)
+const size_t MAX_DATAGRAM = 1200;
+
+// Message types
+enum MessageType {
+    MSG_UNKNOWN = 0,
+    // server -> client
+    MSG_ID,         // id, value = protocol version, token = UDP channel token (0: none), session = resume token (0: none)
+    MSG_OBJECT,     // id, object_type, pos, dir
+    MSG_PLAYER,     // id, value = nb_objects_found, text = name
+    MSG_PLAYERLEFT, // id
+    MSG_START,
+    MSG_PLAYERFIND, // id = player, value = object index
+    MSG_WIN,        // id
+    MSG_TEXT,       // text = information for the player
+    // client -> server
+    MSG_USERNAME,   // text = name, value = protocol version (text only)
+    MSG_POSITION,   // pos, dir[0] = azimut in degrees (binary protocol only)
+    MSG_ASKSTART,
+    MSG_FOUND,      // id = object id
+    // server -> client, players inside the area of interest (binary protocol only)
+    MSG_PLAYERENTER, // id, pos
+    MSG_PLAYERMOVE,  // id, pos
+    MSG_PLAYEREXIT,  // id
+    // players state (binary protocol >= SNAPSHOT_VERSION only)
+    MSG_SNAPSHOT,    // server -> client : id = sequence, value = baseline sequence (0: none), text = delta
+    MSG_SNAPSHOTACK, // client -> server : id = sequence of the last snapshot applied
+    // session (protocol >= RESUME_VERSION only)
+    MSG_RESUME,      // client -> server : id = player id, value = messages received, session = resume token
+                     // server -> client : accepted, id = player id, value = messages sent (the missed ones follow)
+    _MSG_COUNT
+};
+
+// Message type names, in the MessageType order (logs, metrics)
+const char* const MESSAGE_TYPE_NAMES[_MSG_COUNT] = {
+    "UNKNOWN", "ID", "OBJECT", "PLAYER", "PLAYERLEFT", "START", "PLAYERFIND", "WIN", "TEXT",
+    "USERNAME", "POSITION", "ASKSTART", "FOUND", "PLAYERENTER", "PLAYERMOVE", "PLAYEREXIT",
+    "SNAPSHOT", "SNAPSHOTACK", "RESUME"
+};
+
+/**
+ * Typed message, the same for both encodings
+ */
+struct Message {
+    MessageType type;
+    uint32_t id;
+    uint32_t value;
+    uint8_t object_type; // index in OBJECT_TYPE_NAMES
+    float pos[3];
+    float dir[3];
+    std::string text;
+    uint64_t token = 0;
+    uint64_t session = 0;
+};
+
+// Object type names, in the ObjectType order
+const char* const OBJECT_TYPE_NAMES[] = {"duck", "cat", "horse", "lion", "penguin", "monkey"};
+const uint8_t NB_OBJECT_TYPES = 6;
+
+/**
+ * Object type code from its name
+ *
+ * @param name lower case type name
+ * @return the code, NB_OBJECT_TYPES if unknown
+ */
+uint8_t objectTypeCode(std::string_view name);
+
+/**
+ * Is this a valid player name ?
+ *
+ * @param name the name
+ * @return true if it has 1 to MAX_NAME letters or digits
+ */
+bool isName(std::string_view name);
+
+/**
+ * Is this message (or stream) starting with a binary frame ?
+ *
+ * @param data first byte of the message
+ */
+inline bool isBinary(const char *data) {
+    return (uint8_t) data[0] < ' ';
+}
+
+/**
+ * Length of the first message of a stream
+ *
+ * @param data stream
+ * @param size number of bytes available
+ * @param consumed number of bytes to drop from the stream with this message (delimiter included)
+ * @return length of the message (frame header included, text delimiter excluded), or 0 if it is incomplete
+ */
+size_t nextMessage(const char *data, size_t size, size_t &consumed);
+
+/**
+ * Encode a message with the text protocol (delimiter included)
+ *
+ * @param msg message
+ * @param out string to append to
+ */
+void encodeText(const Message &msg, std::string &out);
+
+/**
+ * Encode a message as a binary frame
+ *
+ * @param msg message
+ * @param out string to append to
+ */
+void encodeBinary(const Message &msg, std::string &out);
+
+/**
+ * Encode a message with the given protocol version
+ *
+ * @param msg message
+ * @param version 0 for text, binary otherwise
+ * @return the encoded message
+ */
+std::string encode(const Message &msg, uint8_t version);
+
+/**
+ * Encode a message as a datagram of the UDP channel
+ *
+ * @param token session token
+ * @param seq sequence number of the datagram
+ * @param msg message
+ * @return the datagram
+ */
+std::string encodeDatagram(uint64_t token, uint32_t seq, const Message &msg);
+
+/**
+ * Decode a datagram of the UDP channel
+ *
+ * @param data datagram
+ * @param size datagram size
+ * @param token session token
+ * @param seq sequence number of the datagram
+ * @param msg decoded message
+ * @return false if the datagram is malformed (or does not hold exactly one frame)
+ */
+bool decodeDatagram(const char *data, size_t size, uint64_t &token, uint32_t &seq, Message &msg);
+
+/**
+ * Decode a text message, without regex nor allocation (except for long names)
+ *
+ * @param data message, without delimiter
+ * @param msg decoded message
+ * @return false if the message is malformed or of an unknown command (msg.type is then MSG_UNKNOWN)
+ */
+bool decodeText(std::string_view data, Message &msg);
+
+/**
+ * Decode a binary frame
+ *
+ * @param data frame (header included)
+ * @param size frame size
+ * @param msg decoded message
+ * @return false if the frame is malformed or of an unknown type (msg.type is then MSG_UNKNOWN)
+ */
+bool decodeBinary(const char *data, size_t size, Message &msg);
+
+}
+
+#endif
@@ -54,11 +54,14 @@ Scene::Scene() {
     lego->setDraw(false);
     lego->setSound(false);
 
+    m_Avatars = new Avatars();
+
     // init mouse position
     m_MousePrecX = 0.0;
     m_MousePrecY = 0.0;
 
     m_lastPlayerPosition = vec3::fromValues(0, 0, 0);
+    m_lastPlayerAzimut = m_Azimut;
 }
 
 
@@ -196,6 +199,17 @@ void Scene::onDrawFrame()
     vec3 player_pos, object_pos;
     vec3::multiply(player_pos, m_Center, vec3::fromValues(-1, -1, -1));
 
+    if (!vec3::equals(player_pos, m_lastPlayerPosition) || m_Azimut != m_lastPlayerAzimut) {
+        // Position and facing for the server, sampled and sent by the uplink thread
+        float pos[3] = {player_pos[0], player_pos[1], player_pos[2]};
+        update_position(pos, m_Azimut);
+
+        m_lastPlayerPosition = player_pos; // update last position
+        m_lastPlayerAzimut = m_Azimut;
+
+        lego->setPosition(m_lastPlayerPosition);
+    }
+
     for (auto &object : m_Objects) {
         object_pos = std::get<1>(object).first->getPosition();
         double distance = std::sqrt(
@@ -204,35 +218,16 @@ void Scene::onDrawFrame()
             std::pow(object_pos[2] - player_pos[2], 2.0)
         );
         if (distance < 5) {
-            if (!std::get<1>(object).second) {
+            // sent by the uplink thread with this position (tried again at the next frame if it is late)
+            FoundEvent found = {std::get<0>(object), {player_pos[0], player_pos[1], player_pos[2]}, m_Azimut};
+            if (!std::get<1>(object).second && found_events.push(found)) {
                 std::get<1>(object).first->setDraw(true);
                 std::get<1>(object).first->setSound(false);
-
-                // send msg to server
-                std::string msg = "FOUND=";
-                msg += std::to_string( std::get<0>(object) );
-                msg += MSG_DELIMITER;
-                send(client_socket, msg.c_str(), msg.length(), 0);
                 std::get<1>(object).second = true;
             }
         }
     }
 
-    if (!vec3::equals(player_pos, m_lastPlayerPosition)) {
-        // Send position to server
-        std::string msg = "POSITION=";
-        msg += std::to_string( player_pos[0] ) + ":"; // x
-        msg += std::to_string( player_pos[1] ) + ":"; // y
-        msg += std::to_string( player_pos[2] );       // z
-        msg += MSG_DELIMITER;
-        // std::cout << msg << std::endl; // TODO remove me
-        send(client_socket, msg.c_str(), msg.length(), 0);
-
-        m_lastPlayerPosition = player_pos; // update last position
-
-        lego->setPosition(m_lastPlayerPosition);
-    }
-
     // set third-person orientation (TODO take care of Elevation ?)
     lego->setOrientation(vec3::fromValues(0, -Utils::radians( m_Azimut ), 0));
 
@@ -243,9 +238,6 @@ void Scene::onDrawFrame()
 
     // fournir position et direction en coordonnées caméra aux objets éclairés
     m_Ground->setLight(m_Light);
-    for (auto &object : m_Objects) {
-        std::get<1>(object).first->setLight(m_Light);
-    }
 
     // enlighten lego
     lego->setLight(m_Light);
@@ -258,14 +250,24 @@ void Scene::onDrawFrame()
     // dessiner le sol
     m_Ground->onDraw(m_MatP, m_MatV);
 
-    // dessiner le canard en mouvement
+    // dessiner les objets trouvés, regroupés par type
     for (auto &object : m_Objects) {
-        std::get<1>(object).first->onRender(m_MatP, m_MatV);
+        Object *tmp = std::get<1>(object).first;
+        tmp->onRenderInstance(m_MatV, m_Instances[tmp->getModel()]);
+    }
+    for (std::map<ObjectModel*, std::vector<GLfloat> >::iterator it = m_Instances.begin() ; it != m_Instances.end() ; ++it) {
+        if (it->second.empty()) continue;
+        it->first->setLight(m_Light);
+        it->first->onRenderInstances(m_MatP, m_MatV, it->second);
+        it->second.clear(); // capacité gardée pour l'image suivante
     }
 
     // Third person
     lego->onRender(m_MatP, m_MatV);
 
+    // other players, all at once whatever their number
+    lego->onRenderInstances(m_MatP, m_MatV, m_Avatars->update(monotonic_time()));
+
     // Draw compass
     glDisable(GL_DEPTH_TEST); // to allow superposition
     glBlendEquation(GL_FUNC_ADD);
@@ -288,8 +290,11 @@ Scene::~Scene() {
         delete std::get<1>(object).first;
     }
     m_Objects.clear();
+    m_Instances.clear();
+    delete lego;
     delete m_Ground;
     delete m_Compass;
+    delete m_Avatars;
 }
 
 /**
@@ -312,3 +317,12 @@ void Scene::addObject(unsigned int id, ObjectType type, double pos_x, double pos
     tmp->setSound(true);
     m_Objects[id] = std::make_pair(tmp, false);
 }
+
+/**
+ * To take into account a change of another player (render thread)
+ *
+ * @param event the change, from the network thread
+ */
+void Scene::onPlayerEvent(const PlayerEvent &event) {
+    m_Avatars->onPlayerEvent(event);
+}
@@ -11,6 +11,7 @@
 #include "Ground.h"
 #include "Compass.h"
 #include "CompassNeedle.h"
+#include "Avatars.h"
 #include "commons.h"
 
 
@@ -24,6 +25,9 @@ private:
     Compass* m_Compass;
     CompassNeedle* m_CompassNeedle;
 
+    // matrices des objets affichés, par modèle : un seul appel de dessin par type d'objet
+    std::map<ObjectModel*, std::vector<GLfloat> > m_Instances;
+
     // lampes
     Light* m_Light;
 
@@ -48,6 +52,10 @@ private:
     double m_MousePrecY;
 
     vec3 m_lastPlayerPosition;
+    float m_lastPlayerAzimut;
+
+    // other players in my area of interest, drawn with the lego mesh
+    Avatars* m_Avatars;
 
 
 public:
@@ -113,6 +121,13 @@ public:
      * @param dir_z Z direction coordinate
      */
     void addObject(unsigned int id, ObjectType type, double pos_x, double pos_y, double pos_z, double dir_x, double dir_y, double dir_z);
+
+    /**
+     * To take into account a change of another player (render thread)
+     *
+     * @param event the change, from the network thread
+     */
+    void onPlayerEvent(const PlayerEvent &event);
 };
 
 #endif
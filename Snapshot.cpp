@@ -0,0 +1,265 @@
+// Delta compression of the players state, shared by the client and the server
+
+#include <math.h>
+
+#include "Snapshot.h"
+
+namespace snapshot {
+
+/**
+ * Same state (the name included)
+ */
+bool Entity::operator==(const Entity &other) const {
+    return id == other.id && visible == other.visible &&
+           pos[0] == other.pos[0] && pos[1] == other.pos[1] && pos[2] == other.pos[2] &&
+           azimut == other.azimut && found == other.found && name == other.name;
+}
+
+/**
+ * Same state
+ */
+bool State::operator==(const State &other) const {
+    return id == other.id && pos[0] == other.pos[0] && pos[1] == other.pos[1] && pos[2] == other.pos[2] &&
+           azimut == other.azimut && found == other.found;
+}
+
+/**
+ * World coordinate to fixed-point (saturated, 0 if not finite)
+ */
+int32_t quantizePosition(float v) {
+    if (!isfinite(v)) return 0;
+    double q = round((double) v * POSITION_SCALE);
+    if (q > INT32_MAX) return INT32_MAX;
+    if (q < INT32_MIN) return INT32_MIN;
+    return (int32_t) q;
+}
+
+/**
+ * Fixed-point to world coordinate
+ */
+float position(int32_t q) {
+    return (float) q / POSITION_SCALE;
+}
+
+/**
+ * Azimut in degrees (any turn) to a fraction of a turn
+ */
+uint16_t quantizeAzimut(float degrees) {
+    if (!isfinite(degrees)) return 0;
+    double turn = fmod((double) degrees, 360.0);
+    if (turn < 0) turn += 360.0;
+    return (uint16_t) ((long) round(turn * 65536.0 / 360.0) & 0xFFFF);
+}
+
+/**
+ * Fraction of a turn to degrees in [0, 360[
+ */
+float azimut(uint16_t q) {
+    return (float) q * 360.0f / 65536.0f;
+}
+
+
+/*******************************
+ * Variable length integers
+*******************************/
+
+static void putVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out += (char) ((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += (char) v;
+}
+
+static void putSigned(std::string &out, int64_t v) {
+    putVarint(out, ((uint64_t) v << 1) ^ (uint64_t) (v >> 63)); // zigzag : small magnitudes use one byte
+}
+
+/**
+ * Read cursor over a delta
+ */
+struct Reader {
+    std::string_view s;
+
+    bool varint(uint64_t &v) {
+        v = 0;
+        for (unsigned int shift = 0 ; shift < 64 ; shift += 7) {
+            if (s.empty()) return false;
+            uint8_t b = (uint8_t) s[0];
+            s.remove_prefix(1);
+            v |= (uint64_t) (b & 0x7F) << shift;
+            if ((b & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    bool signedVarint(int64_t &v) {
+        uint64_t u;
+        if (!varint(u)) return false;
+        v = (int64_t) (u >> 1) ^ -(int64_t) (u & 1);
+        return true;
+    }
+};
+
+
+/*******************************
+ * Delta
+*******************************/
+
+// a player who is not in the baseline is compared to this one
+static const Entity EMPTY_ENTITY = {0, false, {0, 0, 0}, 0, 0, ""};
+static const State EMPTY_STATE = {0, {0, 0, 0}, 0, 0};
+
+/**
+ * State of a player as seen by the peer (no position nor azimut outside his area of interest)
+ */
+static State seen(const State &state, bool visible) {
+    State s = state;
+    if (!visible) {
+        s.pos[0] = s.pos[1] = s.pos[2] = 0;
+        s.azimut = 0;
+    }
+    return s;
+}
+
+/**
+ * Append the changed fields of a player
+ *
+ * @param name name of a new player (nullptr : known by the peer)
+ */
+static void putChanges(std::string &out, const State &from, const State &to, bool visible, const std::string *name) {
+    uint8_t mask = visible ? FIELD_VISIBLE : 0;
+    if (to.pos[0] != from.pos[0]) mask |= FIELD_X;
+    if (to.pos[1] != from.pos[1]) mask |= FIELD_Y;
+    if (to.pos[2] != from.pos[2]) mask |= FIELD_Z;
+    if (to.azimut != from.azimut) mask |= FIELD_AZIMUT;
+    if (to.found != from.found) mask |= FIELD_FOUND;
+    if (name != nullptr && !name->empty()) mask |= FIELD_NAME;
+
+    putVarint(out, to.id);
+    out += (char) mask;
+    for (int i = 0 ; i < 3 ; i++) {
+        if (mask & (FIELD_X << i)) putSigned(out, (int64_t) to.pos[i] - from.pos[i]);
+    }
+    if (mask & FIELD_AZIMUT) putSigned(out, (int16_t) (uint16_t) (to.azimut - from.azimut)); // shortest way around
+    if (mask & FIELD_FOUND) putSigned(out, (int64_t) to.found - from.found);
+    if (mask & FIELD_NAME) {
+        putVarint(out, name->size());
+        out += *name;
+    }
+}
+
+/**
+ * Encode the changes between two snapshots sent to a player, as he sees them
+ *
+ * @param baseline view the peer already has (empty : everything is sent)
+ * @param current view to send
+ * @param names names of the players of the current frame
+ * @param out string to append to
+ * @return number of changed players (0 : the peer already has the current view)
+ */
+size_t encodeDelta(const View &baseline, const View &current, const Names &names, std::string &out) {
+    static const std::vector<State> none;
+    const std::vector<State> &from = baseline.frame ? *baseline.frame : none;
+    const std::vector<State> &to = current.frame ? *current.frame : none;
+
+    // same frame seen the same way : nothing changed
+    if (baseline.frame == current.frame && baseline.visible == current.visible) {
+        putVarint(out, 0);
+        return 0;
+    }
+
+    std::string records;
+    size_t count = 0, b = 0, c = 0;
+
+    // both frames are sorted by id
+    while (b < from.size() || c < to.size()) {
+        if (c == to.size() || (b < from.size() && from[b].id < to[c].id)) {
+            putVarint(records, from[b].id);
+            records += (char) FIELD_REMOVED;
+            count++;
+            b++;
+        } else if (b == from.size() || to[c].id < from[b].id) {
+            Names::const_iterator name = names.find(to[c].id);
+            putChanges(records, EMPTY_STATE, seen(to[c], current.visible[c]), current.visible[c],
+                       name != names.end() ? &name->second : nullptr);
+            count++;
+            c++;
+        } else {
+            State was = seen(from[b], baseline.visible[b]), is = seen(to[c], current.visible[c]);
+            if (was != is || baseline.visible[b] != current.visible[c]) { // unchanged : nothing
+                putChanges(records, was, is, current.visible[c], nullptr);
+                count++;
+            }
+            b++;
+            c++;
+        }
+    }
+
+    putVarint(out, count);
+    out += records;
+    return count;
+}
+
+/**
+ * Apply a delta to its baseline
+ *
+ * @param baseline snapshot the delta was encoded against
+ * @param data encoded delta
+ * @param current rebuilt snapshot (its seq is not changed)
+ * @return false if the delta is malformed
+ */
+bool decodeDelta(const Snapshot &baseline, std::string_view data, Snapshot &current) {
+    Reader r = {data};
+    uint64_t count, id, n;
+    int64_t d;
+    std::vector<Entity>::const_iterator b = baseline.entities.begin();
+
+    current.entities.clear();
+    if (!r.varint(count)) return false;
+
+    for (uint64_t i = 0 ; i < count ; i++) {
+        if (!r.varint(id) || id > UINT32_MAX || r.s.empty()) return false;
+        uint8_t mask = (uint8_t) r.s[0];
+        r.s.remove_prefix(1);
+
+        // players of the baseline before this one did not change
+        while (b != baseline.entities.end() && b->id < id) current.entities.push_back(*b++);
+        if (!current.entities.empty() && current.entities.back().id >= id) return false; // not sorted
+
+        bool known = b != baseline.entities.end() && b->id == id;
+        if (mask & FIELD_REMOVED) {
+            if (!known || mask != FIELD_REMOVED) return false;
+            ++b;
+            continue;
+        }
+
+        Entity e = known ? *b++ : EMPTY_ENTITY;
+        e.id = (uint32_t) id;
+        e.visible = (mask & FIELD_VISIBLE) != 0;
+        for (int j = 0 ; j < 3 ; j++) {
+            if (!(mask & (FIELD_X << j))) continue;
+            if (!r.signedVarint(d)) return false;
+            e.pos[j] = (int32_t) (e.pos[j] + d);
+        }
+        if (mask & FIELD_AZIMUT) {
+            if (!r.signedVarint(d)) return false;
+            e.azimut = (uint16_t) (e.azimut + d);
+        }
+        if (mask & FIELD_FOUND) {
+            if (!r.signedVarint(d)) return false;
+            e.found = (uint32_t) (e.found + d);
+        }
+        if (mask & FIELD_NAME) {
+            if (!r.varint(n) || n > r.s.size()) return false;
+            e.name.assign(r.s.data(), n);
+            r.s.remove_prefix(n);
+        }
+        current.entities.push_back(e);
+    }
+
+    while (b != baseline.entities.end()) current.entities.push_back(*b++);
+    return r.s.empty();
+}
+
+}
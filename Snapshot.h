@@ -0,0 +1,137 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// State of the players of a room, replicated by delta against a snapshot the client acknowledged
+//
+// Sent in MSG_SNAPSHOT (id = sequence, value = baseline sequence, 0 : none). The delta is a list of changed players :
+//     varint id | u8 fields mask | changed fields (zigzag varint difference with the baseline)
+// Positions are fixed-point (POSITION_SCALE units per world unit), the azimut is a fraction of a turn on 16 bits.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "Protocol.h"
+
+namespace snapshot {
+
+// Fixed-point scale of the positions (1/64 world unit)
+const float POSITION_SCALE = 64.0f;
+
+// Snapshots a peer keeps to decode (client) or encode (server) a delta
+const size_t HISTORY = 32;
+
+// Largest record of a player in a delta (id, mask, 3 positions, azimut, found, name), and of a removed one
+const size_t MAX_ENTITY_SIZE = 5 + 1 + 3 * 5 + 3 + 5 + 1 + protocol::MAX_NAME;
+const size_t REMOVED_ENTITY_SIZE = 5 + 1;
+
+// Players in a snapshot at most (players of a room) : a delta against any baseline fits in one SNAPSHOT frame
+const size_t MAX_ENTITIES = (protocol::MAX_PAYLOAD - 8 - 10) / (MAX_ENTITY_SIZE + REMOVED_ENTITY_SIZE);
+
+// Fields of a player in a delta
+enum Field {
+    FIELD_REMOVED = 0x01, // no longer in the room (no other field)
+    FIELD_VISIBLE = 0x02, // value of the visible flag, not a change
+    FIELD_X       = 0x04,
+    FIELD_Y       = 0x08,
+    FIELD_Z       = 0x10,
+    FIELD_AZIMUT  = 0x20,
+    FIELD_FOUND   = 0x40,
+    FIELD_NAME    = 0x80
+};
+
+/**
+ * Quantized state of one player
+ */
+struct Entity {
+    uint32_t id;
+    bool visible; // inside the area of interest (position and azimut are 0 otherwise)
+    int32_t pos[3]; // fixed-point
+    uint16_t azimut; // 65536 = a full turn
+    uint32_t found; // number of objects found
+    std::string name;
+
+    bool operator==(const Entity &other) const;
+    bool operator!=(const Entity &other) const { return !(*this == other); }
+};
+
+/**
+ * State of every player of a room, sorted by id
+ */
+struct Snapshot {
+    uint32_t seq; // 0 : empty baseline
+    std::vector<Entity> entities;
+};
+
+/**
+ * Quantized state of one player at a tick, as the server keeps it (his name is in the names table of the room)
+ */
+struct State {
+    uint32_t id;
+    int32_t pos[3]; // fixed-point
+    uint16_t azimut; // 65536 = a full turn
+    uint32_t found; // number of objects found
+
+    bool operator==(const State &other) const;
+    bool operator!=(const State &other) const { return !(*this == other); }
+};
+
+/**
+ * State of every player of a room at a tick, sorted by id : shared by the snapshots sent to all the players
+ */
+typedef std::shared_ptr<const std::vector<State> > Frame;
+
+/**
+ * Snapshot sent to one player (server side) : the frame of its tick, and which players of it he sees
+ */
+struct View {
+    uint32_t seq; // 0 : empty baseline
+    Frame frame; // nullptr : no player
+    std::vector<bool> visible; // per state of the frame (position and azimut are sent as 0 otherwise)
+};
+
+/**
+ * Name of each player of a room (a name never changes, it is only sent with a new player)
+ */
+typedef std::unordered_map<uint32_t, std::string> Names;
+
+/** world coordinate to fixed-point */
+int32_t quantizePosition(float v);
+
+/** fixed-point to world coordinate */
+float position(int32_t q);
+
+/** azimut in degrees (any turn) to a fraction of a turn */
+uint16_t quantizeAzimut(float degrees);
+
+/** fraction of a turn to degrees in [0, 360[ */
+float azimut(uint16_t q);
+
+/**
+ * Encode the changes between two snapshots sent to a player, as he sees them
+ *
+ * @param baseline view the peer already has (empty : everything is sent)
+ * @param current view to send
+ * @param names names of the players of the current frame
+ * @param out string to append to
+ * @return number of changed players (0 : the peer already has the current view)
+ */
+size_t encodeDelta(const View &baseline, const View &current, const Names &names, std::string &out);
+
+/**
+ * Apply a delta to its baseline
+ *
+ * @param baseline snapshot the delta was encoded against
+ * @param data encoded delta
+ * @param current rebuilt snapshot (its seq is not changed)
+ * @return false if the delta is malformed
+ */
+bool decodeDelta(const Snapshot &baseline, std::string_view data, Snapshot &current);
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+
+/**
+ * Bounded lock-free queue between exactly one producer thread and one consumer thread.
+ * Each side only writes its own index (no lock, no allocation once created): push() fails when it is full.
+ */
+template <typename T>
+class SpscRing
+{
+private:
+
+    std::vector<T> m_Slots;
+    size_t m_Mask;
+
+    // on their own cache line, each one written by one side only
+    alignas(64) std::atomic<size_t> m_Head; // next slot to read (consumer)
+    alignas(64) std::atomic<size_t> m_Tail; // next slot to write (producer)
+
+public:
+
+    /**
+     * @param capacity number of slots (rounded up to a power of two)
+     */
+    explicit SpscRing(size_t capacity): m_Slots(), m_Mask(0), m_Head(0), m_Tail(0)
+    {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        m_Slots.resize(size);
+        m_Mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * Add a value (producer thread only)
+     *
+     * @param value the value, copied
+     * @return false if the ring is full (nothing added)
+     */
+    bool push(const T &value)
+    {
+        size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_Head.load(std::memory_order_acquire) == m_Slots.size()) return false;
+        m_Slots[tail & m_Mask] = value;
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the oldest value (consumer thread only)
+     *
+     * @param value the value
+     * @return false if the ring is empty
+     */
+    bool pop(T &value)
+    {
+        size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_Tail.load(std::memory_order_acquire)) return false;
+        value = m_Slots[head & m_Mask];
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif
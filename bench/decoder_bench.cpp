@@ -0,0 +1,126 @@
+// Microbenchmark of the server decoding path on a burst of POSITION messages
+//
+// legacy : std::string accumulation, find/substr/erase and std::regex (as before the ring buffer)
+// ring   : RingBuffer, protocol::nextMessage and protocol::decodeText on string_views
+//
+// Both decoders are fed the same stream, in chunks of the size of the former read buffer.
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <regex>
+#include <cstring>
+#include <cstdlib>
+
+#include "Protocol.h"
+#include "RingBuffer.h"
+
+#define N_CHAR 1024UL
+#define NB_MESSAGES 200000
+
+
+/**
+ * Decoder of the former server : regex match then substr/stof
+ */
+static size_t legacy(const std::string &stream, float &checksum) {
+    static const std::regex username("USERNAME=[A-Za-z0-9]+(:[0-9]+)?");
+    static const std::regex position("POSITION=(-)?[0-9.]+:(-)?[0-9.]+:(-)?[0-9.]+");
+    static const std::regex askstart("ASKSTART");
+    static const std::regex objectfound("FOUND=[0-9]+");
+    std::string messages;
+    size_t count = 0;
+
+    for (size_t offset = 0 ; offset < stream.size() ; offset += N_CHAR) {
+        messages.append(stream, offset, N_CHAR);
+
+        size_t pos;
+        while ( (pos = messages.find("$")) != std::string::npos ) {
+            std::string current_msg = messages.substr(0, pos);
+            messages.erase(0, pos+1);
+
+            if (regex_match(current_msg, username)) {
+            }
+            else if (regex_match(current_msg, position)) {
+                std::string _pos = current_msg.substr(9);
+                size_t p = _pos.find(":");
+                checksum += stof( _pos.substr(0, p) );
+                _pos.erase(0, p+1);
+                p = _pos.find(":");
+                checksum += stof( _pos.substr(0, p) );
+                _pos.erase(0, p+1);
+                checksum += stof(_pos);
+                count++;
+            }
+            else if (regex_match(current_msg, askstart)) {
+            }
+            else if (regex_match(current_msg, objectfound)) {
+            }
+        }
+    }
+    return count;
+}
+
+
+/**
+ * Decoder of the reactor : ring buffer and string_view parsing
+ */
+static size_t ring(const std::string &stream, float &checksum) {
+    RingBuffer input(8192);
+    char scratch[8192];
+    protocol::Message msg = {};
+    size_t count = 0, length, consumed;
+
+    for (size_t offset = 0 ; offset < stream.size() ; offset += N_CHAR) {
+        input.write(stream.data() + offset, std::min(N_CHAR, stream.size() - offset));
+
+        while (input.size() > 0) {
+            std::string_view data = input.front();
+            length = protocol::nextMessage(data.data(), data.size(), consumed);
+            if (length == 0 && consumed == 0) {
+                if (data.size() == input.size()) break;
+                data = input.peek(input.size(), scratch);
+                length = protocol::nextMessage(data.data(), data.size(), consumed);
+                if (length == 0 && consumed == 0) break;
+            }
+            if (length > 0 && protocol::decodeText(data.substr(0, length), msg) && msg.type == protocol::MSG_POSITION) {
+                checksum += msg.pos[0];
+                checksum += msg.pos[1];
+                checksum += msg.pos[2];
+                count++;
+            }
+            input.consume(consumed);
+        }
+    }
+    return count;
+}
+
+
+template <typename Decoder>
+static void run(const char *name, Decoder decoder, const std::string &stream) {
+    float checksum = 0.0f;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t count = decoder(stream, checksum);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << name << ": " << count << " messages in " << seconds * 1000.0 << " ms, "
+              << (double) count / seconds / 1e6 << " M msg/s, "
+              << seconds * 1e9 / (double) count << " ns/msg (checksum " << checksum << ")" << std::endl;
+}
+
+
+int main(void) {
+    // burst of POSITION as sent by the client (std::to_string format)
+    std::string stream;
+    srand(42);
+    for (int i = 0 ; i < NB_MESSAGES ; i++) {
+        float x = (float) (rand() % 20000) / 100.0f - 100.0f;
+        float y = 1.6f;
+        float z = (float) (rand() % 20000) / 100.0f - 100.0f;
+        stream += "POSITION=" + std::to_string(x) + ":" + std::to_string(y) + ":" + std::to_string(z) + "$";
+    }
+    std::cout << NB_MESSAGES << " messages, " << stream.size() << " bytes" << std::endl;
+
+    run("legacy (regex)", legacy, stream);
+    run("ring (string_view)", ring, stream);
+    return 0;
+}
@@ -0,0 +1,585 @@
+// Load generator : thousands of headless bots speaking the real protocol to a running server
+//
+// Each bot signs up (USERNAME), the leader of each room asks to start (ASKSTART), then every bot walks
+// around its anchor and sends POSITION at a fixed rate, and FOUND every few seconds (never for the last
+// object : nobody wins, the game goes on).
+//
+// Latency : from the message a bot sends to the broadcast another bot receives about it
+//     POSITION -> PLAYERENTER/PLAYERMOVE (protocol 1) or SNAPSHOT (protocol 2)
+//     FOUND    -> PLAYERFIND (protocols 0 and 1)
+// Every bot runs in this process, on one epoll loop, so both ends use the same clock.
+//
+// Usage : loadgen <address> <port> [-c bots] [-r positions per second] [-f seconds between FOUND] [-d seconds] [-p protocol]
+// The server needs rooms for all the bots (see bench/loadgen_config.json), a refused bot counts as a failure.
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <deque>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "Protocol.h"
+#include "Snapshot.h"
+
+#define MAX_EVENTS 256
+#define READ_SIZE 65536
+// positions remembered per bot, to find the one a broadcast is about
+#define POSITION_HISTORY 64
+// bots walk on a circle of this radius around their anchor (an object, or the origin)
+#define WALK_RADIUS 1.0f
+#define WALK_STEP 0.05f
+// delay between the last connection and ASKSTART
+#define START_DELAY_MS 1000
+
+typedef std::chrono::steady_clock Clock;
+
+
+/**
+ * Command line options
+ */
+struct Options {
+    const char *address;
+    uint16_t port;
+    unsigned int bots;
+    double rate; // positions per second and per bot
+    double found_interval; // seconds between two FOUND of a bot
+    double duration; // seconds
+    uint8_t protocol;
+};
+
+/**
+ * A POSITION sent by a bot
+ */
+struct Sent {
+    float pos[3];
+    Clock::time_point at;
+};
+
+/**
+ * One synthetic client
+ */
+struct Bot {
+    enum State { CONNECTING, JOINING, WAITING, PLAYING, CLOSED };
+
+    int socket;
+    unsigned int index;
+    uint32_t id; // given by the server (0 until ID)
+    State state;
+    bool asked_start;
+    std::string input;
+    std::string output;
+    bool want_write;
+
+    // players of the room (to find the leader : the smallest id) and objects to find
+    std::vector<uint32_t> players;
+    std::vector<std::array<float, 3> > objects;
+
+    // walk and FOUND script
+    float anchor[3];
+    float angle;
+    Clock::time_point next_position;
+    Clock::time_point next_found;
+    unsigned int nb_found;
+    Clock::time_point found_at; // last FOUND sent
+
+    // positions sent (ring), and the last one received of each other bot
+    Sent sent[POSITION_HISTORY];
+    uint32_t nb_sent;
+    std::unordered_map<uint32_t, uint32_t> last_seen;
+
+    // snapshots received, baselines of the next ones (protocol 2)
+    std::deque<snapshot::Snapshot> snapshots;
+};
+
+/**
+ * What the bots measured
+ */
+struct Stats {
+    uint64_t messages_sent = 0;
+    uint64_t messages_received = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+    unsigned int connected = 0;
+    unsigned int connect_failures = 0;
+    unsigned int closed_by_server = 0;
+    std::vector<double> position_latencies; // microseconds
+    std::vector<double> found_latencies;
+};
+
+static Options options = {"127.0.0.1", 8080, 1000, 10.0, 2.0, 10.0, 1};
+static Stats stats;
+static std::vector<Bot> bots;
+static std::unordered_map<uint32_t, Bot*> bots_by_id;
+static int epoll_fd;
+
+
+/**
+ * Register or unregister EPOLLOUT for a bot
+ */
+static void watch_write(Bot &bot, bool enable)
+{
+    if (bot.want_write == enable) return;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (enable ? (uint32_t) EPOLLOUT : 0U);
+    ev.data.u32 = bot.index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, bot.socket, &ev);
+    bot.want_write = enable;
+}
+
+/**
+ * Close a bot connection
+ */
+static void close_bot(Bot &bot)
+{
+    if (bot.state == Bot::CLOSED) return;
+    close(bot.socket);
+    bot.state = Bot::CLOSED;
+    bots_by_id.erase(bot.id);
+}
+
+/**
+ * Write as much buffered output as the socket accepts
+ */
+static void flush(Bot &bot)
+{
+    while (!bot.output.empty()) {
+        ssize_t n = send(bot.socket, bot.output.data(), bot.output.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                watch_write(bot, true);
+                return;
+            }
+            stats.closed_by_server++;
+            close_bot(bot);
+            return;
+        }
+        stats.bytes_sent += (uint64_t) n;
+        bot.output.erase(0, (size_t) n);
+    }
+    watch_write(bot, false);
+}
+
+/**
+ * Send a message with the protocol of the test (USERNAME is always text)
+ */
+static void send_message(Bot &bot, const protocol::Message &msg)
+{
+    bot.output += protocol::encode(msg, msg.type == protocol::MSG_USERNAME ? 0 : options.protocol);
+    stats.messages_sent++;
+    if (!bot.want_write) flush(bot);
+}
+
+/**
+ * Next point of the walk of a bot, sent as POSITION (and remembered)
+ */
+static void send_position(Bot &bot, Clock::time_point now)
+{
+    bot.angle += WALK_STEP;
+    Sent &s = bot.sent[bot.nb_sent % POSITION_HISTORY];
+    s.pos[0] = bot.anchor[0] + WALK_RADIUS * cosf(bot.angle);
+    s.pos[1] = bot.anchor[1];
+    s.pos[2] = bot.anchor[2] + WALK_RADIUS * sinf(bot.angle);
+    s.at = now;
+    bot.nb_sent++;
+
+    protocol::Message msg = {protocol::MSG_POSITION, 0, 0, 0, {s.pos[0], s.pos[1], s.pos[2]}, {0, 0, 0}, ""};
+    send_message(bot, msg);
+}
+
+/**
+ * A bot received a position of another one : latency from the matching POSITION (once per POSITION)
+ *
+ * @param receiver bot who received it
+ * @param about id of the bot who moved
+ * @param pos position received
+ * @param quantized compare the fixed-point positions (snapshots)
+ */
+static void position_received(Bot &receiver, uint32_t about, const float pos[3], bool quantized, Clock::time_point now)
+{
+    std::unordered_map<uint32_t, Bot*>::iterator it = bots_by_id.find(about);
+    if (it == bots_by_id.end()) return;
+    Bot &sender = *it->second;
+
+    // newest first, several POSITION can be sent in one tick
+    uint32_t oldest = sender.nb_sent > POSITION_HISTORY ? sender.nb_sent - POSITION_HISTORY : 0;
+    for (uint32_t i = sender.nb_sent ; i > oldest ; i--) {
+        const Sent &s = sender.sent[(i - 1) % POSITION_HISTORY];
+        bool same = true;
+        for (int j = 0 ; j < 3 ; j++) {
+            same = same && (quantized ? snapshot::quantizePosition(s.pos[j]) == snapshot::quantizePosition(pos[j]) : s.pos[j] == pos[j]);
+        }
+        if (!same) continue;
+
+        uint32_t &last = receiver.last_seen[about];
+        if (i > last) {
+            last = i;
+            stats.position_latencies.push_back(std::chrono::duration<double, std::micro>(now - s.at).count());
+        }
+        return;
+    }
+}
+
+/**
+ * Apply a snapshot (protocol 2) and acknowledge it
+ */
+static void snapshot_received(Bot &bot, const protocol::Message &msg, Clock::time_point now)
+{
+    static const snapshot::Snapshot none = {0, {}};
+    const snapshot::Snapshot *baseline = &none;
+
+    if (!bot.snapshots.empty() && msg.id <= bot.snapshots.back().seq) return;
+    if (msg.value != 0) {
+        baseline = nullptr;
+        for (const snapshot::Snapshot &s : bot.snapshots) {
+            if (s.seq == msg.value) baseline = &s;
+        }
+        if (baseline == nullptr) return;
+    }
+
+    snapshot::Snapshot current = {msg.id, {}};
+    if (!snapshot::decodeDelta(*baseline, msg.text, current)) return;
+
+    bot.players.clear();
+    for (const snapshot::Entity &e : current.entities) {
+        bot.players.push_back(e.id);
+        if (!e.visible) continue;
+        float pos[3] = {snapshot::position(e.pos[0]), snapshot::position(e.pos[1]), snapshot::position(e.pos[2])};
+        position_received(bot, e.id, pos, true, now);
+    }
+
+    while (!bot.snapshots.empty() && bot.snapshots.front().seq < msg.value) bot.snapshots.pop_front();
+    bot.snapshots.push_back(current);
+    if (bot.snapshots.size() > snapshot::HISTORY) bot.snapshots.pop_front();
+
+    protocol::Message ack = {protocol::MSG_SNAPSHOTACK, msg.id, 0, 0, {}, {}, ""};
+    send_message(bot, ack);
+}
+
+/**
+ * Deal with a message from the server
+ */
+static void handle_message(Bot &bot, const protocol::Message &msg, Clock::time_point now)
+{
+    switch (msg.type) {
+    case protocol::MSG_ID:
+        bot.id = msg.id;
+        bot.state = Bot::WAITING;
+        bots_by_id[bot.id] = &bot;
+        break;
+    case protocol::MSG_OBJECT:
+        bot.objects.push_back({msg.pos[0], msg.pos[1], msg.pos[2]});
+        break;
+    case protocol::MSG_PLAYER:
+        bot.players.push_back(msg.id);
+        break;
+    case protocol::MSG_PLAYERLEFT:
+        bot.players.erase(std::remove(bot.players.begin(), bot.players.end(), msg.id), bot.players.end());
+        break;
+    case protocol::MSG_START:
+        bot.state = Bot::PLAYING;
+        // START comes right after a tick of the server : spread the first POSITION (and FOUND) over a period,
+        // or every message would wait for a whole tick
+        bot.next_position = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((bot.index % 97) / 97.0 / options.rate));
+        bot.next_found = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((1.0 + (bot.index % 89) / 89.0) * options.found_interval));
+        break;
+    case protocol::MSG_PLAYERENTER:
+    case protocol::MSG_PLAYERMOVE:
+        position_received(bot, msg.id, msg.pos, false, now);
+        break;
+    case protocol::MSG_PLAYERFIND: {
+        std::unordered_map<uint32_t, Bot*>::iterator it = bots_by_id.find(msg.id);
+        if (it != bots_by_id.end() && it->second != &bot) {
+            stats.found_latencies.push_back(std::chrono::duration<double, std::micro>(now - it->second->found_at).count());
+        }
+        break;
+    }
+    case protocol::MSG_SNAPSHOT:
+        snapshot_received(bot, msg, now);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Read and handle everything the server sent to a bot
+ */
+static void read_all(Bot &bot, Clock::time_point now)
+{
+    char buffer[READ_SIZE];
+    protocol::Message msg;
+
+    while (true) {
+        ssize_t n = recv(bot.socket, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        }
+        if (n <= 0) {
+            stats.closed_by_server++;
+            close_bot(bot);
+            return;
+        }
+        stats.bytes_received += (uint64_t) n;
+        bot.input.append(buffer, (size_t) n);
+    }
+
+    size_t offset = 0, length, consumed;
+    while ( (length = protocol::nextMessage(bot.input.data() + offset, bot.input.size() - offset, consumed)) > 0 || consumed > 0 ) {
+        const char *data = bot.input.data() + offset;
+        offset += consumed;
+        stats.messages_received++;
+
+        bool ok = protocol::isBinary(data) ? protocol::decodeBinary(data, length, msg) : protocol::decodeText(std::string_view(data, length), msg);
+        if (ok) handle_message(bot, msg, now);
+        if (bot.state == Bot::CLOSED) return;
+    }
+    bot.input.erase(0, offset);
+}
+
+/**
+ * Start the non-blocking connection of every bot
+ */
+static void connect_all()
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.address, &address.sin_addr) <= 0) {
+        std::cerr << "Invalid address " << options.address << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    bots.resize(options.bots);
+    for (unsigned int i = 0 ; i < options.bots ; i++) {
+        Bot &bot = bots[i];
+        bot.index = i;
+        bot.id = 0;
+        bot.state = Bot::CONNECTING;
+        bot.asked_start = false;
+        bot.want_write = true;
+        bot.anchor[0] = bot.anchor[1] = bot.anchor[2] = 0;
+        bot.angle = (float) i; // not all at the same place
+        bot.nb_found = 0;
+        bot.nb_sent = 0;
+
+        bot.socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (bot.socket < 0) {
+            stats.connect_failures++;
+            bot.state = Bot::CLOSED;
+            continue;
+        }
+        int one = 1;
+        setsockopt(bot.socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if (connect(bot.socket, (struct sockaddr *) &address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+            stats.connect_failures++;
+            close(bot.socket);
+            bot.state = Bot::CLOSED;
+            continue;
+        }
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u32 = i;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, bot.socket, &ev);
+    }
+}
+
+/**
+ * A connecting bot became writable : connected (then it signs up) or failed
+ */
+static void connected(Bot &bot)
+{
+    int error = 0;
+    socklen_t len = sizeof(error);
+    getsockopt(bot.socket, SOL_SOCKET, SO_ERROR, &error, &len);
+    if (error != 0) {
+        stats.connect_failures++;
+        close(bot.socket);
+        bot.state = Bot::CLOSED;
+        return;
+    }
+
+    stats.connected++;
+    bot.state = Bot::JOINING;
+    watch_write(bot, false);
+
+    protocol::Message signup = {protocol::MSG_USERNAME, 0, options.protocol, 0, {}, {}, "bot" + std::to_string(bot.index)};
+    send_message(bot, signup);
+}
+
+/**
+ * Send what is due : ASKSTART (leaders), POSITION and FOUND
+ */
+static void script(Bot &bot, Clock::time_point now, Clock::time_point start_at)
+{
+    if (bot.state == Bot::WAITING && !bot.asked_start && now >= start_at && !bot.players.empty()) {
+        // the leader is the first one who entered the room : the smallest id
+        bot.asked_start = true;
+        if (*std::min_element(bot.players.begin(), bot.players.end()) == bot.id) {
+            protocol::Message msg = {protocol::MSG_ASKSTART, 0, 0, 0, {}, {}, ""};
+            send_message(bot, msg);
+        }
+        return;
+    }
+    if (bot.state != Bot::PLAYING) return;
+
+    // next object (never the last one), from close to it
+    if (now >= bot.next_found && bot.nb_found + 1 < bot.objects.size()) {
+        std::copy(bot.objects[bot.nb_found].begin(), bot.objects[bot.nb_found].end(), bot.anchor);
+        send_position(bot, now);
+
+        protocol::Message msg = {protocol::MSG_FOUND, bot.nb_found + 1, 0, 0, {}, {}, ""};
+        send_message(bot, msg);
+        bot.found_at = now;
+        bot.nb_found++;
+        bot.next_found += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.found_interval));
+    }
+
+    if (now >= bot.next_position) {
+        send_position(bot, now);
+        bot.next_position += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.rate));
+        if (bot.next_position < now) bot.next_position = now; // the loop was late
+    }
+}
+
+/**
+ * Print the percentiles of a list of latencies
+ */
+static void print_latencies(const char *name, std::vector<double> &latencies)
+{
+    std::cout << name << " latency (" << latencies.size() << " samples)";
+    if (latencies.empty()) {
+        std::cout << std::endl;
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const double percentiles[] = {0.50, 0.99, 0.999};
+    const char *labels[] = {"p50", "p99", "p999"};
+    for (int i = 0 ; i < 3 ; i++) {
+        size_t rank = std::min(latencies.size() - 1, (size_t) (percentiles[i] * (double) latencies.size()));
+        std::cout << " " << labels[i] << " " << std::fixed << std::setprecision(3) << latencies[rank] / 1000.0 << " ms";
+    }
+    std::cout << " max " << latencies.back() / 1000.0 << " ms" << std::endl;
+}
+
+/**
+ * Parse the command line
+ */
+static void parse_options(int argc, char *argv[])
+{
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <address> <port> [-c bots] [-r positions/s] [-f seconds between FOUND] [-d seconds] [-p protocol]" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    options.address = argv[1];
+    options.port = (uint16_t) atoi(argv[2]);
+
+    for (int i = 3 ; i + 1 < argc ; i += 2) {
+        std::string flag = argv[i];
+        double value = atof(argv[i+1]);
+        if (flag == "-c") options.bots = (unsigned int) value;
+        else if (flag == "-r") options.rate = value;
+        else if (flag == "-f") options.found_interval = value;
+        else if (flag == "-d") options.duration = value;
+        else if (flag == "-p") options.protocol = (uint8_t) std::min(value, (double) protocol::SNAPSHOT_VERSION); // no UDP channel
+        else {
+            std::cerr << "Unknown option " << flag << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (options.bots == 0 || options.rate <= 0 || options.found_interval <= 0 || options.duration <= 0) {
+        std::cerr << "Invalid option" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    parse_options(argc, argv);
+
+    // one descriptor per bot
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    if ( (epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0 ) {
+        std::cerr << "epoll_create1 " << __FILE__ << " " << __LINE__ << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << options.bots << " bots, " << options.rate << " positions/s each, FOUND every " << options.found_interval
+              << " s, protocol " << (int) options.protocol << ", " << options.duration << " s" << std::endl;
+
+    Clock::time_point begin = Clock::now();
+    Clock::time_point end = begin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+    Clock::time_point start_at = Clock::time_point::max();
+    connect_all();
+
+    struct epoll_event events[MAX_EVENTS];
+    while (Clock::now() < end) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, 1);
+        Clock::time_point now = Clock::now();
+
+        for (int i = 0 ; i < n ; i++) {
+            Bot &bot = bots[events[i].data.u32];
+            if (bot.state == Bot::CLOSED) continue;
+            if (bot.state == Bot::CONNECTING) {
+                connected(bot);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) flush(bot);
+            if (bot.state != Bot::CLOSED && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) read_all(bot, now);
+        }
+
+        // everybody tried to connect : leaders ask to start a bit later
+        if (start_at == Clock::time_point::max() && stats.connected + stats.connect_failures == options.bots) {
+            start_at = now + std::chrono::milliseconds(START_DELAY_MS);
+        }
+
+        for (Bot &bot : bots) {
+            if (bot.state != Bot::CLOSED) script(bot, now, start_at);
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    unsigned int playing = 0;
+    for (Bot &bot : bots) {
+        if (bot.state == Bot::PLAYING) playing++;
+        if (bot.state != Bot::CLOSED) close(bot.socket);
+    }
+
+    std::cout << "bots: " << stats.connected << " connected, " << playing << " playing, "
+              << stats.connect_failures << " connection failures, " << stats.closed_by_server << " closed by the server" << std::endl;
+    std::cout << std::fixed << std::setprecision(0)
+              << "sent: " << stats.messages_sent << " messages (" << (double) stats.messages_sent / elapsed << " msg/s, "
+              << (double) stats.bytes_sent / elapsed / 1024 << " KiB/s)" << std::endl
+              << "received: " << stats.messages_received << " messages (" << (double) stats.messages_received / elapsed << " msg/s, "
+              << (double) stats.bytes_received / elapsed / 1024 << " KiB/s)" << std::endl;
+    print_latencies("position", stats.position_latencies);
+    print_latencies("found", stats.found_latencies);
+
+    close(epoll_fd);
+    return EXIT_SUCCESS;
+}
@@ -5,6 +5,11 @@
 #include <stdlib.h>
 #include <string>
 #include <map>
+#include <atomic>
+#include <chrono>
+
+#include "Protocol.h"
+#include "SpscRing.h"
 
 // List of object type
 enum ObjectType {
@@ -34,14 +39,56 @@ struct ObjectConfigType {
 extern std::map<ObjectType, ObjectConfigType> objects_config;
 
 #define N_CHAR 1024UL
+// Hellos sent on the UDP channel before giving up (every 500 ms)
+#define UDP_HELLOS 10U
+// Connections tried to resume the session after a lost connection (every 500 ms)
+#define RESUME_ATTEMPTS 20U
+// Changes of the remote players waiting for the render thread (it takes them all at each frame)
+#define PLAYER_EVENTS 4096UL
+// Positions sent per second at most (default), and objects found waiting for the uplink thread
+#define POSITION_RATE 20U
+#define FOUND_EVENTS 256UL
+// Seconds between two sends of an unchanged position (the last datagram may have been lost)
+#define POSITION_REFRESH 0.25
 
 // Player structure definition
 struct Player {
     unsigned int id;
     std::string name;
     unsigned int nb_objects_found;
+    bool visible; // inside my area of interest (the server sends his moves)
+    float pos[3]; // last known position, if visible
+    float azimut; // last known facing in degrees, if visible
+};
+
+// Change of a remote player, sent by the network thread to the render thread
+struct PlayerEvent {
+    enum Type {
+        MOVED, // visible, at this position (entered my area of interest, or moved)
+        HIDDEN, // out of my area of interest
+        LEFT // left the game
+    };
+    Type type;
+    unsigned int id;
+    float pos[3]; // MOVED only
+    float azimut; // MOVED only, degrees
+    double time; // reception, see monotonic_time()
 };
 
+// Object found by the player, sent by the render thread to the uplink thread with where he found it
+struct FoundEvent {
+    unsigned int id;
+    float pos[3];
+    float azimut; // degrees
+};
+
+/**
+ * Seconds on a monotonic clock, shared by the network and render threads (player events and their interpolation)
+ */
+inline double monotonic_time() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 // ObjectDef structure definition
 struct ObjectDef {
     unsigned int id;
@@ -61,9 +108,39 @@ enum Status {
     COMPLETED
 };
 
-// Socket
-extern int client_socket;
+// Socket (replaced when the session is resumed on a new connection)
+extern std::atomic<int> client_socket;
+// Negotiated protocol (0: text)
+extern uint8_t protocol_version;
+// UDP channel confirmed by the server (protocol >= UDP_VERSION)
+extern std::atomic<bool> udp_ready;
+// Network thread -> render thread, drained once per frame
+extern SpscRing<PlayerEvent> player_events;
+// Render thread -> uplink thread, sent at its next sample
+extern SpscRing<FoundEvent> found_events;
 // To delimite each socket msgs
 const std::string MSG_DELIMITER = "$";
 
+/**
+ * Send a message to the server, with the negotiated protocol
+ *
+ * @param msg the message
+ */
+void send_message(const protocol::Message &msg);
+
+/**
+ * Send a message to the server on the UDP channel once it is ready, with send_message otherwise
+ *
+ * @param msg the message (POSITION or SNAPSHOTACK)
+ */
+void send_unreliable(const protocol::Message &msg);
+
+/**
+ * Give the current position of the camera to the uplink thread (render thread, never blocked by the network)
+ *
+ * @param pos position
+ * @param azimut facing in degrees
+ */
+void update_position(const float pos[3], float azimut);
+
 #endif
@@ -667,6 +667,61 @@ void Mesh::onDraw(const mat4& matP, const mat4& matVM)
 }
 
 
+/**
+ * dessiner plusieurs instances des facettes du maillage en un seul appel
+ * @param material : variante instanciée d'un matériau, qui fournit la matrice de chaque instance
+ * @param matP : matrice de projection perpective
+ * @param matV : matrice de la caméra
+ * @param count : nombre d'instances
+ */
+void Mesh::onDrawInstanced(Material* material, const mat4& matP, const mat4& matV, GLsizei count)
+{
+    if (count <= 0) return;
+
+    // activer le matériau des instances
+    material->select(this, matP, matV);
+
+    // activer et lier le buffer contenant les indices
+    int facesindexbufferid = getFacesIndexBufferId();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, facesindexbufferid);
+
+    // les VBOs sont à jour
+    m_UpdateVBOs = false;
+
+    // dessiner les triangles de toutes les instances
+    glDrawElementsInstanced(GL_TRIANGLES, m_TriangleList.size() * 3, m_FacesIndexBufferType, 0, count);
+
+    // désactiver le matériau
+    material->deselect();
+
+    // désactiver le VBO des indices
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+
+/**
+ * reprend les sommets et les triangles d'un autre maillage, qui devient vide
+ * (par exemple chargé par un autre thread : il n'a pas encore de VBO)
+ * @param other : maillage à vider
+ */
+void Mesh::takeGeometry(Mesh* other)
+{
+    for (Vertex* vertex: other->m_VertexList) {
+        vertex->setMesh(this);
+        m_VertexList.push_back(vertex);
+    }
+    for (Triangle* triangle: other->m_TriangleList) {
+        triangle->setMesh(this);
+        m_TriangleList.push_back(triangle);
+    }
+    other->m_VertexList.clear();
+    other->m_TriangleList.clear();
+
+    // refaire les VBOs
+    m_UpdateVBOs = true;
+}
+
+
 /**
  * modifie les coordonnées des sommets par la matrice indiquée
  * @param matT mat4 qui est appliquée sur chaque sommet
@@ -698,12 +753,13 @@ Mesh::~Mesh()
         delete vertex;
     }
 
-    // supprimer les VBOs (le shader n'est pas créé ici)
-    Utils::deleteVBO(m_VertexBufferId);
-    Utils::deleteVBO(m_ColorBufferId);
-    Utils::deleteVBO(m_TexCoordsBufferId);
-    Utils::deleteVBO(m_NormalBufferId);
-    Utils::deleteVBO(m_FacesIndexBufferId);
-    Utils::deleteVBO(m_EdgesIndexBufferId);
+    // supprimer les VBOs créés (le shader n'est pas créé ici) : un maillage jamais dessiné n'appelle pas OpenGL
+    if (m_VertexBufferId >= 0) Utils::deleteVBO(m_VertexBufferId);
+    if (m_ColorBufferId >= 0) Utils::deleteVBO(m_ColorBufferId);
+    if (m_TexCoordsBufferId >= 0) Utils::deleteVBO(m_TexCoordsBufferId);
+    if (m_NormalBufferId >= 0) Utils::deleteVBO(m_NormalBufferId);
+    if (m_TangentBufferId >= 0) Utils::deleteVBO(m_TangentBufferId);
+    if (m_FacesIndexBufferId >= 0) Utils::deleteVBO(m_FacesIndexBufferId);
+    if (m_EdgesIndexBufferId >= 0) Utils::deleteVBO(m_EdgesIndexBufferId);
 }
 
@@ -308,11 +308,26 @@ public:
      */
     void onDraw(const mat4& matP, const mat4& matVM);
 
+    /**
+     * dessiner plusieurs instances des facettes du maillage en un seul appel
+     * @param material : variante instanciée d'un matériau, qui fournit la matrice de chaque instance
+     * @param matP : matrice de projection perpective
+     * @param matV : matrice de la caméra
+     * @param count : nombre d'instances
+     */
+    void onDrawInstanced(Material* material, const mat4& matP, const mat4& matV, GLsizei count);
+
     /**
      * modifie les coordonnées des sommets par la matrice indiquée
      * @param matT mat4 qui est appliquée sur chaque sommet
      */
     void transform(mat4 matT);
+
+    /**
+     * reprend les sommets et les triangles d'un autre maillage, qui devient vide
+     * @param other : maillage à vider
+     */
+    void takeGeometry(Mesh* other);
 };
 
 
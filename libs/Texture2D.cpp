@@ -67,28 +67,71 @@ Texture2D::Texture2D(std::string filename, GLenum filtering, GLenum repetition)
 
 
 /**
- * le constructeur lance le chargement d'une image et en fait une texture 2D
- * @param filename : nom du fichier contenant l'image à charger
+ * le constructeur fait une texture 2D d'une image déjà chargée par loadImage (elle n'est pas libérée)
+ * @param image : image retournée verticalement
  * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
  * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
  */
-void Texture2D::loadTexture(const char* filename, GLenum filtering, GLenum repetition)
+Texture2D::Texture2D(SDL_Surface* image, GLenum filtering, GLenum repetition)
 {
-    // au cas où la suite plante, on invalide d'abord cette texture
+    // valeurs par défaut
     m_TextureID = 0;
+    m_Width = -1;
+    m_Height = -1;
+
+    uploadTexture(image, filtering, repetition);
+}
 
+
+/**
+ * charge une image et la retourne verticalement, sans appel OpenGL (utilisable par un autre thread)
+ * @param filename : nom du fichier contenant l'image à charger
+ * @return l'image, à libérer avec SDL_FreeSurface, nullptr si elle ne peut pas être chargée
+ */
+SDL_Surface* Texture2D::loadImage(const char* filename)
+{
     // chargement de l'image
     SDL_Surface *surface = IMG_Load(filename);
     if (!surface) {
         std::cerr << "Texture2D : impossible d'ouvrir \"" << filename << "\"" << std::endl;
-        exit(EXIT_FAILURE);
+        return nullptr;
     }
 
     // retourner la surface verticalement
     SDL_Surface *tmp = flipSurface(surface);
     SDL_FreeSurface(surface);
-    surface = tmp;
+    return tmp;
+}
+
 
+/**
+ * le constructeur lance le chargement d'une image et en fait une texture 2D
+ * @param filename : nom du fichier contenant l'image à charger
+ * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
+ * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
+ */
+void Texture2D::loadTexture(const char* filename, GLenum filtering, GLenum repetition)
+{
+    // au cas où la suite plante, on invalide d'abord cette texture
+    m_TextureID = 0;
+
+    SDL_Surface *surface = loadImage(filename);
+    if (!surface) exit(EXIT_FAILURE);
+    uploadTexture(surface, filtering, repetition);
+
+    // libération de l'image SDL
+    SDL_FreeSurface(surface);
+}
+
+
+/**
+ * fait une texture 2D d'une image chargée
+ * @param surface : image retournée verticalement
+ * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
+ * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
+ */
+void Texture2D::uploadTexture(SDL_Surface* surface, GLenum filtering, GLenum repetition)
+{
     // infos sur cette texture
     m_Width = surface->w;
     m_Height = surface->h;
@@ -128,7 +171,7 @@ void Texture2D::loadTexture(const char* filename, GLenum filtering, GLenum repet
         //std::cout << filename << " luminance" << std::endl;
         break;
     default:
-        std::cerr << "Texture2D: " << filename << " : format inconnu, "  << (int)surface->format->BytesPerPixel << " octets/pixel" << std::endl;
+        std::cerr << "Texture2D: format inconnu, "  << (int)surface->format->BytesPerPixel << " octets/pixel" << std::endl;
     }
 
     // alignement des pixels
@@ -151,9 +194,6 @@ void Texture2D::loadTexture(const char* filename, GLenum filtering, GLenum repet
     glBindTexture(GL_TEXTURE_2D, m_TextureID);
     glTexImage2D(GL_TEXTURE_2D, 0, internal_format, m_Width, m_Height, 0, texture_format, components_type, surface->pixels);
 
-    // libération de l'image SDL
-    SDL_FreeSurface(surface);
-
     // filtrage avec mipmaps ?
     if (filtering == GL_NEAREST_MIPMAP_NEAREST || filtering == GL_LINEAR_MIPMAP_NEAREST ||
         filtering == GL_NEAREST_MIPMAP_LINEAR  || filtering == GL_LINEAR_MIPMAP_LINEAR) {
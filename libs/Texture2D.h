@@ -6,6 +6,8 @@
 
 #include <string>
 
+struct SDL_Surface;
+
 class Texture2D {
 public:
     // constructeurs...
@@ -20,6 +22,21 @@ public:
     Texture2D(const char* filename, GLenum filtering=GL_LINEAR, GLenum repetition=GL_CLAMP_TO_EDGE);
     Texture2D(std::string filename, GLenum filtering=GL_LINEAR, GLenum repetition=GL_CLAMP_TO_EDGE);
 
+    /**
+     * le constructeur fait une texture 2D d'une image déjà chargée par loadImage (elle n'est pas libérée)
+     * @param image : image retournée verticalement
+     * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
+     * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
+     */
+    Texture2D(SDL_Surface* image, GLenum filtering=GL_LINEAR, GLenum repetition=GL_CLAMP_TO_EDGE);
+
+    /**
+     * charge une image et la retourne verticalement, sans appel OpenGL (utilisable par un autre thread)
+     * @param filename : nom du fichier contenant l'image à charger
+     * @return l'image, à libérer avec SDL_FreeSurface, nullptr si elle ne peut pas être chargée
+     */
+    static SDL_Surface* loadImage(const char* filename);
+
     // destructeur
     virtual ~Texture2D();
 
@@ -44,6 +61,14 @@ private:
      * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
      */
     void loadTexture(const char* filename, GLenum filtering, GLenum repetition);
+
+    /**
+     * fait une texture 2D d'une image chargée
+     * @param surface : image retournée verticalement
+     * @param filtering : mettre GL_LINEAR ou gl.NEAREST ou GL_LINEAR_MIPMAP_LINEAR (mipmaps)
+     * @param repetition : mettre GL_CLAMP_TO_EDGE ou GL_REPEAT
+     */
+    void uploadTexture(SDL_Surface* surface, GLenum filtering, GLenum repetition);
 };
 
 
@@ -13,35 +13,70 @@
 #include <arpa/inet.h>
 #include <thread>
 #include <mutex>
-#include <regex>
 #include <future>
+#include <algorithm>
+#include <deque>
 #include <signal.h>
+#include <poll.h>
+#include <errno.h>
 #include <cstdlib>
 
 #include <utils.h>
 #include "commons.h"
+#include "Snapshot.h"
 #include "Scene.h"
+#include "Assets.h"
 
 /** Global variable */
 std::string username;
 int userid = -1;
 
-std::mutex mtx_players;
+// owned by the network thread (main), the render thread learns the changes from player_events
 std::map<unsigned int, Player> players;
+SpscRing<PlayerEvent> player_events(PLAYER_EVENTS);
 
-std::mutex mtx_objects;
+// filled by the network thread while WAITING, then only read by the render thread it creates at START
 std::map<unsigned int, ObjectDef> objects;
 
 std::thread interface_dealer;
 std::promise<void> interface_dealer_exit_signal;
 bool interface_closed = false;
+std::atomic<bool> interface_running(false); // the render thread drains player_events
+
+// my position, written by the render thread and sampled by the uplink thread with the objects found
+std::thread uplink_dealer;
+unsigned int position_rate = POSITION_RATE; // samples per second
+std::mutex mtx_position;
+float camera_position[3] = {0, 0, 0};
+float camera_azimut = 0;
+SpscRing<FoundEvent> found_events(FOUND_EVENTS);
 
 std::thread keypress_dealer;
 std::promise<void> keypress_dealer_exit_signal;
 
 std::mutex mtx_status;
 Status current_status = Status::WAITING;
-int client_socket = 0; // it is global var
+std::atomic<int> client_socket(0); // it is global var
+std::mutex mtx_tcp; // one thread writes on client_socket at a time, a frame is never mixed with another (uplink, main and keypress)
+uint8_t protocol_version = 0; // negotiated with the server (0: text)
+
+// session (protocol >= RESUME_VERSION), resumed on a new connection if this one is lost
+uint64_t session = 0; // resume token (0: none)
+uint32_t received = 0; // messages received on TCP, SNAPSHOT and RESUME excluded
+unsigned int resume_attempts = 0; // connections tried since the last resume
+bool resuming = false; // RESUME sent, waiting for the answer
+
+// UDP channel (protocol >= UDP_VERSION), connected to the server address once its token is known
+struct sockaddr_in server_address;
+int udp_socket = -1;
+uint64_t udp_token = 0;
+std::atomic<bool> udp_ready(false); // the server received a datagram from us
+std::mutex mtx_udp; // the datagrams leave in the order of their sequence, whatever thread sends them (uplink and main)
+uint32_t udp_sent = 0; // sequence of the last datagram sent
+uint32_t udp_received = 0; // sequence of the last datagram received, older ones are dropped
+
+// last snapshots received, baselines of the next ones (protocol >= SNAPSHOT_VERSION)
+std::deque<snapshot::Snapshot> snapshots;
 
 /**
  * Scène à dessiner
@@ -64,6 +99,11 @@ static void onSurfaceChanged(GLFWwindow* window, int width, int height)
 static void onDrawRequest(GLFWwindow* window)
 {
     if (scene == nullptr) return;
+
+    // changes of the other players since the last frame
+    PlayerEvent event;
+    while (player_events.pop(event)) scene->onPlayerEvent(event);
+
     Utils::UpdateTime();
     scene->onDrawFrame();
     static bool premiere = true;
@@ -182,7 +222,6 @@ void deal_with_interface(std::future<void> exit_signal) {
     scene = new Scene();
     //debugGLFatal("new Scene()");
 
-    mtx_objects.lock();
     for (auto &o : objects) {
         scene->addObject(
             std::get<1>(o).id,
@@ -195,7 +234,6 @@ void deal_with_interface(std::future<void> exit_signal) {
             std::get<1>(o).dir_z
         );
     }
-    mtx_objects.unlock();
 
     // enregistrement des fonctions callbacks
     glfwSetFramebufferSizeCallback(window, onSurfaceChanged);
@@ -222,6 +260,7 @@ void deal_with_interface(std::future<void> exit_signal) {
         exit_signal.wait_for(std::chrono::nanoseconds(1)) == std::future_status::timeout &&
         current_status == Status::IN_PROGRESS
     );
+    interface_running = false;
 
     onExit(); // normal exit
 
@@ -230,6 +269,183 @@ void deal_with_interface(std::future<void> exit_signal) {
     }
 }
 
+/**
+ * Write whole frames on the TCP connection, after those of the other threads
+ *
+ * @param data encoded messages
+ * @return false if the connection was lost (the frames partly written are not resent on the next connection)
+ */
+bool send_stream(const std::string &data) {
+    mtx_tcp.lock();
+    int socket = client_socket; // every byte goes on the same connection
+    size_t done = 0;
+    while (done < data.length()) {
+        ssize_t written = send(socket, data.c_str() + done, data.length() - done, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) break;
+        done += (size_t) written;
+    }
+    mtx_tcp.unlock();
+    return done == data.length();
+}
+
+/**
+ * Send a message to the server, with the negotiated protocol
+ *
+ * @param msg the message
+ */
+void send_message(const protocol::Message &msg) {
+    send_stream(protocol::encode(msg, protocol_version)); // the connection may be lost (resumed later)
+}
+
+/**
+ * Send a message to the server on the UDP channel, with the next sequence
+ * (the server drops a datagram older than the last one it received)
+ *
+ * @param msg the message
+ */
+void send_datagram(const protocol::Message &msg) {
+    mtx_udp.lock();
+    std::string data = protocol::encodeDatagram(udp_token, ++udp_sent, msg);
+    send(udp_socket, data.c_str(), data.length(), 0);
+    mtx_udp.unlock();
+}
+
+/**
+ * Send a message to the server on the UDP channel once it is ready, with send_message otherwise
+ *
+ * @param msg the message (POSITION or SNAPSHOTACK)
+ */
+void send_unreliable(const protocol::Message &msg) {
+    if (!udp_ready) {
+        send_message(msg);
+        return;
+    }
+    send_datagram(msg);
+}
+
+/**
+ * Give the current position of the camera to the uplink thread (render thread, never blocked by the network)
+ *
+ * @param pos position
+ * @param azimut facing in degrees
+ */
+void update_position(const float pos[3], float azimut) {
+    mtx_position.lock();
+    std::copy(pos, pos + 3, camera_position);
+    camera_azimut = azimut;
+    mtx_position.unlock();
+}
+
+/**
+ * Thread to send my position and the objects I found while the game is displayed
+ * The position is sampled position_rate times per second, and sent only if it changed once quantized as in the
+ * snapshots (the server does not replicate it more precisely), or every POSITION_REFRESH seconds: a lost datagram
+ * does not leave the server with an old position. An object found goes on TCP in the same write as the position
+ * where it was found: the server checks the distance from the last position it received.
+ */
+void deal_with_uplink() {
+    std::chrono::steady_clock::duration period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / position_rate));
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    int32_t sent[3] = {0, 0, 0};
+    uint16_t sent_azimut = 0;
+    bool known = false; // the server has the position in sent
+    std::chrono::steady_clock::time_point last_sent;
+    std::chrono::steady_clock::duration refresh = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(POSITION_REFRESH));
+    std::deque<std::string> found_data; // objects found, kept until they are written whole (no connection while it is resumed)
+
+    while (interface_running) {
+        next += period;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (next < now) next = now; // late (suspended...) : no burst to catch up
+        std::this_thread::sleep_until(next);
+
+        FoundEvent found;
+        while (found_events.pop(found)) {
+            protocol::Message position = {protocol::MSG_POSITION, 0, 0, 0, {found.pos[0], found.pos[1], found.pos[2]}, {found.azimut, 0, 0}, ""};
+            protocol::Message msg = {protocol::MSG_FOUND, found.id, 0, 0, {}, {}, ""};
+            found_data.push_back(protocol::encode(position, protocol_version) + protocol::encode(msg, protocol_version));
+        }
+        // a write cut by a lost connection is done again whole on the next one (its FOUND, the last frame, was not complete)
+        while (!found_data.empty() && send_stream(found_data.front())) {
+            found_data.pop_front();
+            known = false;
+        }
+
+        mtx_position.lock();
+        int32_t q[3] = {snapshot::quantizePosition(camera_position[0]), snapshot::quantizePosition(camera_position[1]), snapshot::quantizePosition(camera_position[2])};
+        uint16_t q_azimut = snapshot::quantizeAzimut(camera_azimut);
+        mtx_position.unlock();
+
+        if (known && std::equal(q, q + 3, sent) && q_azimut == sent_azimut && next - last_sent < refresh) continue;
+        protocol::Message position = {protocol::MSG_POSITION, 0, 0, 0,
+            {snapshot::position(q[0]), snapshot::position(q[1]), snapshot::position(q[2])}, {snapshot::azimut(q_azimut), 0, 0}, ""};
+        send_unreliable(position);
+        std::copy(q, q + 3, sent);
+        sent_azimut = q_azimut;
+        known = true;
+        last_sent = next;
+    }
+}
+
+/**
+ * Open the UDP channel, and say hello until the server answers (from the main loop)
+ */
+void open_udp_channel() {
+    if ( (udp_socket = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+         connect(udp_socket, (struct sockaddr*) &server_address, sizeof(server_address)) < 0 ) {
+        std::cerr << "UDP channel unavailable, positions are sent on TCP" << std::endl;
+        if (udp_socket >= 0) close(udp_socket);
+        udp_socket = -1;
+    }
+}
+
+/**
+ * Tell the server where to send the datagrams (it answers with an ID datagram)
+ */
+void udp_hello() {
+    protocol::Message hello = {protocol::MSG_SNAPSHOTACK, 0, 0, 0, {}, {}, ""};
+    send_datagram(hello);
+}
+
+/**
+ * Connect again after a lost connection, and ask the server to resume the session
+ * (the server answers RESUME, then sends again the messages after <received>)
+ *
+ * @return false if the server can not be reached again
+ */
+bool resume_session() {
+    // the other threads fail to send until RESUME is sent (a write blocked on the lost connection fails first)
+    shutdown(client_socket, SHUT_RDWR);
+    mtx_tcp.lock();
+    int old_socket = client_socket.exchange(-1);
+    mtx_tcp.unlock();
+    close(old_socket);
+
+    protocol::Message resume = {protocol::MSG_RESUME, (uint32_t) userid, received, 0, {}, {}, ""};
+    resume.session = session;
+    std::string data = protocol::encode(resume, protocol_version);
+
+    while (resume_attempts++ < RESUME_ATTEMPTS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        int new_socket = socket(AF_INET, SOCK_STREAM, 0);
+        if (new_socket < 0) return false;
+        // RESUME is the first message of the new connection, the other threads use it only once it is sent
+        if (connect(new_socket, (struct sockaddr*) &server_address, sizeof(server_address)) == 0 &&
+            send(new_socket, data.c_str(), data.length(), MSG_NOSIGNAL) == (ssize_t) data.length()) {
+            resuming = true;
+            client_socket = new_socket;
+            std::cout << "Connection lost, resuming the session..." << std::endl;
+            return true;
+        }
+        close(new_socket);
+    }
+    return false;
+}
+
 /**
  * Thread to manage keypress event (to ask to start game)
 */
@@ -242,8 +458,8 @@ void deal_with_keyevent(std::future<void> exit_signal) {
         if (c == "s" || c == "S") {
             std::cout << "Ask start" << std::endl;
 
-            std::string msg = "ASKSTART" + MSG_DELIMITER;
-            send(client_socket, msg.c_str(), msg.length(), 0);
+            protocol::Message msg = {protocol::MSG_ASKSTART, 0, 0, 0, {}, {}, ""};
+            send_message(msg);
         }
     }
 }
@@ -259,6 +475,9 @@ void stop() {
     } catch (std::exception const& e) {}
     if (interface_dealer.joinable())
         interface_dealer.join();
+    interface_running = false;
+    if (uplink_dealer.joinable())
+        uplink_dealer.join();
     if (keypress_dealer.joinable())
         keypress_dealer.join();
 }
@@ -274,28 +493,279 @@ void exit_handler(int s) {
     exit(EXIT_SUCCESS);
 }
 
+/**
+ * Decode a text message from the server
+ *
+ * @param current_msg the message, without delimiter
+ * @param msg decoded message (MSG_TEXT if it does not match any command)
+ */
+void decode_text(std::string_view current_msg, protocol::Message &msg) {
+    if (!protocol::decodeText(current_msg, msg)) {
+        msg.type = protocol::MSG_TEXT;
+        msg.text.assign(current_msg);
+    }
+}
+
+/**
+ * Tell the render thread about a change of another player (only while it runs, it gets them all at START)
+ * The events can not be dropped (he may have left) : wait for the render thread if it is late.
+ *
+ * @param type the change
+ * @param p the player, up to date
+ */
+void publish_player(PlayerEvent::Type type, const Player &p) {
+    PlayerEvent event = {type, p.id, {p.pos[0], p.pos[1], p.pos[2]}, p.azimut, monotonic_time()};
+    while (interface_running && !player_events.push(event)) {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * Apply a snapshot of the players from the server, and acknowledge it
+ *
+ * @param msg the MSG_SNAPSHOT message
+ */
+void apply_snapshot(const protocol::Message &msg) {
+    static const snapshot::Snapshot none = {0, {}};
+
+    if (!snapshots.empty() && msg.id <= snapshots.back().seq) return; // older than the last one
+
+    const snapshot::Snapshot *baseline = &none;
+    if (msg.value != 0) {
+        baseline = nullptr;
+        for (const snapshot::Snapshot &s : snapshots) {
+            if (s.seq == msg.value) baseline = &s;
+        }
+        if (baseline == nullptr) {
+            std::cerr << "Snapshot " << msg.id << " ignored, baseline " << msg.value << " unknown" << std::endl;
+            return;
+        }
+    }
+
+    snapshot::Snapshot current = {msg.id, {}};
+    if (!snapshot::decodeDelta(*baseline, msg.text, current)) {
+        std::cerr << "Malformed snapshot " << msg.id << std::endl;
+        return;
+    }
+
+    // players gone (both lists are sorted by id)
+    std::vector<snapshot::Entity>::const_iterator e = current.entities.begin();
+    for (std::map<unsigned int, Player>::iterator it = players.begin() ; it != players.end() ; ) {
+        while (e != current.entities.end() && e->id < it->first) ++e;
+        if (e == current.entities.end() || e->id != it->first) {
+            std::cout << "Player '" << it->second.name << "' leave" << std::endl;
+            publish_player(PlayerEvent::LEFT, it->second);
+            it = players.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // new players, objects found, moves
+    for (const snapshot::Entity &e : current.entities) {
+        std::map<unsigned int, Player>::iterator it = players.find(e.id);
+        if (it == players.end()) {
+            std::cout << "New player: " << e.id << ":" << e.name << ":" << e.found << std::endl;
+            it = players.insert(std::make_pair(e.id, Player{e.id, e.name, e.found, false, {0, 0, 0}, 0})).first;
+        } else if (e.found > it->second.nb_objects_found) {
+            std::cout << "Player '" << e.name << "' found an object (" << e.found << ")" << std::endl;
+        }
+        Player &p = it->second;
+        p.nb_objects_found = e.found;
+        bool was_visible = p.visible;
+        p.visible = e.visible;
+        if (e.visible) {
+            float pos[3] = {snapshot::position(e.pos[0]), snapshot::position(e.pos[1]), snapshot::position(e.pos[2])};
+            float azimut = snapshot::azimut(e.azimut);
+            if (!was_visible || !std::equal(pos, pos + 3, p.pos) || azimut != p.azimut) {
+                std::copy(pos, pos + 3, p.pos);
+                p.azimut = azimut;
+                publish_player(PlayerEvent::MOVED, p);
+            }
+        } else if (was_visible) {
+            publish_player(PlayerEvent::HIDDEN, p);
+        }
+    }
+
+    // the older snapshots are no longer used as baseline by the server
+    while (!snapshots.empty() && snapshots.front().seq < msg.value) snapshots.pop_front();
+    snapshots.push_back(current);
+    if (snapshots.size() > snapshot::HISTORY) snapshots.pop_front();
+
+    protocol::Message ack = {protocol::MSG_SNAPSHOTACK, msg.id, 0, 0, {}, {}, ""};
+    send_unreliable(ack);
+}
+
+/**
+ * Deal with a message from the server
+ *
+ * @param msg the message
+ * @return false if the client has to stop
+ */
+bool handle_message(const protocol::Message &msg) {
+    if (msg.type == protocol::MSG_ID && current_status == Status::WAITING && userid == -1) {
+        userid = msg.id;
+        protocol_version = (uint8_t) msg.value; // next messages use this protocol
+        std::cout << "My ID: " << std::to_string(userid) << std::endl;
+        assets::prefetch(_THIRD_PERSON); // my avatar, and the other players'
+
+        if (msg.token != 0) {
+            udp_token = msg.token;
+            open_udp_channel();
+            if (udp_socket >= 0) udp_hello();
+        }
+        session = msg.session;
+    }
+    else if (msg.type == protocol::MSG_RESUME && resuming) {
+        resuming = false;
+        resume_attempts = 0;
+        std::cout << "Session resumed (" << msg.value - received << " message(s) missed)" << std::endl;
+    }
+    else if (msg.type == protocol::MSG_TEXT && resuming) {
+        // the server has forgotten us
+        std::cerr << "Unable to resume the session, exit..." << std::endl;
+        stop();
+        return false;
+    }
+    else if (msg.type == protocol::MSG_TEXT && userid == -1) {
+        // server does not know the binary protocol, sign up again in text (once)
+        static bool text_signup = false;
+        if (!text_signup) {
+            protocol::Message signup = {protocol::MSG_USERNAME, 0, 0, 0, {}, {}, username};
+            send_message(signup);
+            text_signup = true;
+        }
+    }
+    else if (msg.type == protocol::MSG_OBJECT && current_status == Status::WAITING && userid != -1) {
+        if (msg.object_type >= protocol::NB_OBJECT_TYPES) {
+            std::cerr << "Unknown object !, exit..." << std::endl;
+            stop();
+            return false;
+        }
+        ObjectType type = (ObjectType) msg.object_type;
+
+        std::cout << "New object: " << msg.id << ":" << protocol::OBJECT_TYPE_NAMES[msg.object_type] << std::endl;
+
+        objects[msg.id] = {msg.id, type, msg.pos[0], msg.pos[1], msg.pos[2], msg.dir[0], msg.dir[1], msg.dir[2]};
+        assets::prefetch(type); // decoded while we wait for START
+    }
+    else if (msg.type == protocol::MSG_PLAYER && current_status == Status::WAITING && userid != -1) {
+        std::cout << "New player: " << msg.id << ":" << msg.text << ":" << msg.value << std::endl;
+
+        players[msg.id] = {msg.id, msg.text, msg.value, false, {0, 0, 0}, 0};
+    }
+    else if (msg.type == protocol::MSG_PLAYERLEFT && userid != -1) {
+        std::map<unsigned int, Player>::iterator it = players.find(msg.id);
+        if (it != players.end()) {
+            std::cout << "Player '" << it->second.name << "' leave" << std::endl;
+            publish_player(PlayerEvent::LEFT, it->second);
+            players.erase(it);
+        }
+
+    }
+    else if (msg.type == protocol::MSG_START && current_status == Status::WAITING && userid != -1) {
+        mtx_status.lock();
+        current_status = Status::IN_PROGRESS;
+        mtx_status.unlock();
+
+        std::cout << "Let's go !" << std::endl;
+
+        interface_running = true;
+        interface_dealer = std::thread(deal_with_interface, std::move(interface_dealer_exit_signal.get_future()));
+        uplink_dealer = std::thread(deal_with_uplink);
+        for (std::map<unsigned int, Player>::const_iterator it = players.begin() ; it != players.end() ; ++it) {
+            if (it->second.visible) publish_player(PlayerEvent::MOVED, it->second);
+        }
+        signal(SIGTERM, exit_handler);
+        signal(SIGINT, exit_handler);
+
+        keypress_dealer_exit_signal.set_value();
+        keypress_dealer.detach();
+    }
+    else if (msg.type == protocol::MSG_PLAYERFIND && current_status == Status::IN_PROGRESS && userid != -1) {
+        std::map<unsigned int, Player>::iterator it = players.find(msg.id);
+        if (it != players.end()) {
+            it->second.nb_objects_found += 1;
+
+            std::cout << "Player '" << it->second.name << "' found object id: " << std::to_string(msg.value) << std::endl;
+        }
+    }
+    else if ((msg.type == protocol::MSG_PLAYERENTER || msg.type == protocol::MSG_PLAYERMOVE) && current_status == Status::IN_PROGRESS && userid != -1) {
+        std::map<unsigned int, Player>::iterator it = players.find(msg.id);
+        if (it != players.end()) {
+            it->second.visible = true;
+            std::copy(msg.pos, msg.pos + 3, it->second.pos);
+            publish_player(PlayerEvent::MOVED, it->second);
+        }
+    }
+    else if (msg.type == protocol::MSG_PLAYEREXIT && current_status == Status::IN_PROGRESS && userid != -1) {
+        std::map<unsigned int, Player>::iterator it = players.find(msg.id);
+        if (it != players.end() && it->second.visible) {
+            it->second.visible = false;
+            publish_player(PlayerEvent::HIDDEN, it->second);
+        }
+    }
+    else if (msg.type == protocol::MSG_SNAPSHOT && userid != -1) {
+        apply_snapshot(msg);
+    }
+    else if (msg.type == protocol::MSG_WIN && current_status == Status::IN_PROGRESS && userid != -1) {
+        mtx_status.lock();
+        current_status = Status::COMPLETED;
+        mtx_status.unlock();
+
+        int winnerid = msg.id;
+
+        if (winnerid == userid) {
+            std::cout << "$$$$$$$$$$$$$$$" << std::endl;
+            std::cout << "$$ YOU WIN ! $$" << std::endl;
+            std::cout << "$$$$$$$$$$$$$$$" << std::endl << std::endl;
+        }
+
+        // Score board
+        std::cout << "========= ScoreBoard =========" << std::endl;
+        for (auto &user : players) {
+            Player p = std::get<1>(user);
+            std::string line = "";
+
+            if (p.id == userid) line += "*";
+            line += p.name + " (id: " + std::to_string(p.id) +") = " + std::to_string(p.nb_objects_found);
+            if (p.id == winnerid) line += " WINNER";
+
+            std::cout << line << std::endl;
+        }
+        std::cout << "==============================" << std::endl;
+    }
+    return true;
+}
+
 /** point d'entrée du programme **/
 int main(int argc, char *argv[]) {
     // Get params
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <server_ip_address> <server_port>" << std::endl;
+    if (argc != 3 && argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " <server_ip_address> <server_port> [<positions_per_second>]" << std::endl;
         return EXIT_FAILURE;
     }
     char* addr = argv[1];
     uint16_t port = (u_int16_t) atoi(argv[2]);
+    if (argc == 4) {
+        int rate = atoi(argv[3]);
+        if (rate <= 0) {
+            std::cerr << "The number of positions per second must be positive !" << std::endl;
+            return EXIT_FAILURE;
+        }
+        position_rate = (unsigned int) rate;
+    }
 
     // Client enter his/her name
     std::cout << "Enter your USERNAME: ";
     std::cin >> username;
 
-    std::regex accepted_username("^[A-Za-z]+$");
-    if (!regex_match(username, accepted_username)) {
-        std::cerr << "Username must contain only upper or lower case letters! " << std::endl;
+    if (username.empty() || username.size() > protocol::MAX_NAME || !std::all_of(username.begin(), username.end(), [](char c) { return isalpha((unsigned char) c); })) {
+        std::cerr << "Username must contain only upper or lower case letters (" << protocol::MAX_NAME << " at most)! " << std::endl;
         return EXIT_FAILURE;
     }
 
     // Socket stuff
-    size_t valread;
+    ssize_t valread = 1;
     struct sockaddr_in serv_addr;
 
     if ( (client_socket = socket(AF_INET, SOCK_STREAM, 0)) < 0 ) {
@@ -311,194 +781,85 @@ int main(int argc, char *argv[]) {
         std::cout << "Invalid address/ Address not supported !" << std::endl;
         return EXIT_FAILURE;
     }
+    server_address = serv_addr; // the UDP channel uses the same port
 
     if ( connect(client_socket, (struct sockaddr*) &serv_addr, sizeof(serv_addr)) < 0 ) {
         std::cout << "Connection failed !" << std::endl;
         return EXIT_FAILURE;
     }
 
-    // Sign up
-    std::string msg = "USERNAME=";
-    msg += username;
-    msg += MSG_DELIMITER;
-    send(client_socket, msg.c_str(), msg.length(), 0);
+    // Sign up (and ask for the binary protocol, the server answers in its ID message)
+    protocol::Message signup = {protocol::MSG_USERNAME, 0, protocol::VERSION, 0, {}, {}, username};
+    send_message(signup);
 
     keypress_dealer = std::thread(deal_with_keyevent, std::move(keypress_dealer_exit_signal.get_future()));
 
-    // define commands regex
-    std::regex id("ID=[0-9]+");
-    std::regex player("PLAYER=[0-9]+:[A-Za-z0-9]+:[0-9]+");
-    std::regex object("OBJECT=[0-9]+:[a-z]+:[0-9-.]+:[0-9-.]+:[0-9-.]+:[0-9-.]+:[0-9-.]+:[0-9-.]+");
-    std::regex playerleft("PLAYERLEFT=[0-9]+");
-    std::regex start("START");
-    std::regex playerfind("PLAYERFIND=[0-9]+:[0-9]+");
-    std::regex end("WIN=[0-9]+");
-
     std::string messages;
     char buffer[N_CHAR];
+    char datagram[protocol::MAX_DATAGRAM];
+    unsigned int hellos = 0;
+    protocol::Message msg; // reused: no allocation per message once its text has grown
 
     do {
-        valread = read(client_socket , buffer, N_CHAR); // PASSIVE WAIT
-        buffer[valread] = '\0';
-
-        if (valread == 0 || interface_closed) break; // avoid unnecessary treatments
-
-        messages += buffer;
-
-        // Split buffer in real messages
-        size_t pos = 0;
-        while ( (pos = messages.find(MSG_DELIMITER)) != std::string::npos ) {
-            std::string current_msg(messages.substr(0, pos));
-            messages.erase(0, pos + MSG_DELIMITER.length());
-
-            if (regex_match(current_msg, id) && current_status == Status::WAITING && userid == -1) {
-                std::string _id = current_msg.substr(3);
-                userid = stoi(_id);
-                std::cout << "My ID: " << std::to_string(userid) << std::endl;
-            }
-            else if (regex_match(current_msg, object) && current_status == Status::WAITING && userid != -1) {
-                std::string _o = current_msg.substr(7);
-                unsigned int objectid;
-                double pos_x, pos_y, pos_z, dir_x, dir_y, dir_z;
-                std::string str_type;
-                ObjectType type;
-
-                std::cout << "New object: " << _o << std::endl;
-
-                objectid = stoi( _o.substr(0, _o.find(":") ) );
-                _o.erase(0, _o.find(":") + 1);
-
-                str_type = _o.substr(0, _o.find(":") );
-                if (str_type == "duck")
-                    type = ObjectType::DUCK;
-                else if (str_type == "cat")
-                    type = ObjectType::CAT;
-                else if (str_type == "horse")
-                    type = ObjectType::HORSE;
-                else if (str_type == "lion")
-                    type = ObjectType::LION;
-                else if (str_type == "penguin")
-                    type = ObjectType::PENGUIN;
-                else if (str_type == "monkey")
-                    type = ObjectType::MONKEY;
-                else {
-                    std::cerr << "Unknown object !, exit..." << std::endl;
-                    stop();
-                    return EXIT_FAILURE;
+        // PASSIVE WAIT on both channels (hello again every 500 ms until the UDP channel is confirmed)
+        struct pollfd fds[2] = {{client_socket, POLLIN, 0}, {udp_socket, POLLIN, 0}};
+        int ready = poll(fds, udp_socket >= 0 ? 2 : 1, 500);
+        if (ready == 0 && udp_socket >= 0 && !udp_ready && ++hellos <= UDP_HELLOS) udp_hello();
+        if (interface_closed) break;
+
+        // Datagrams: sequenced, the older ones are dropped
+        if (udp_socket >= 0 && (fds[1].revents & POLLIN)) {
+            ssize_t size = recv(udp_socket, datagram, sizeof(datagram), MSG_DONTWAIT);
+            uint64_t token;
+            uint32_t seq;
+            protocol::Message msg;
+            if (size > 0 && protocol::decodeDatagram(datagram, (size_t) size, token, seq, msg) && token == udp_token &&
+                (udp_received == 0 || seq > udp_received)) {
+                udp_received = seq;
+                if (msg.type == protocol::MSG_ID) {
+                    if (!udp_ready) std::cout << "UDP channel ready" << std::endl;
+                    udp_ready = true;
+                } else if (msg.type == protocol::MSG_SNAPSHOT) {
+                    if (!handle_message(msg)) return EXIT_FAILURE;
                 }
-
-                // position
-                _o.erase(0, _o.find(":") + 1);
-                pos_x = stod( _o.substr(0, _o.find(":") ) );
-                _o.erase(0, _o.find(":") + 1);
-                pos_y = stod( _o.substr(0, _o.find(":") ) );
-                _o.erase(0, _o.find(":") + 1);
-                pos_z = stod( _o.substr(0, _o.find(":") ) );
-
-                // direction
-                _o.erase(0, _o.find(":") + 1);
-                dir_x = stod( _o.substr(0, _o.find(":") ) );
-                _o.erase(0, _o.find(":") + 1);
-                dir_y = stod( _o.substr(0, _o.find(":") ) );
-                _o.erase(0, _o.find(":") + 1);
-                dir_z = stod( _o.substr(0, _o.find(":") ) );
-
-                mtx_objects.lock();
-                objects[objectid] = {objectid, type, pos_x, pos_y, pos_z, dir_x, dir_y, dir_z};
-                mtx_objects.unlock();
-            }
-            else if (regex_match(current_msg, player) && current_status == Status::WAITING && userid != -1) {
-                std::string _p = current_msg.substr(7);
-                unsigned int playerid, nb_object_found;
-                std::string name;
-
-                std::cout << "New player: " << _p << std::endl;
-
-                playerid = stoi( _p.substr(0, _p.find(":") ) );
-                _p.erase(0, _p.find(":") + 1);
-                name = _p.substr(0, _p.find(":") );
-                _p.erase(0, _p.find(":") + 1);
-                nb_object_found = stoi( _p.substr(0, _p.find(":") ) );
-
-                mtx_players.lock();
-                players[playerid] = {playerid, name, nb_object_found};
-                mtx_players.unlock();
             }
-            else if (regex_match(current_msg, playerleft) && userid != -1) {
-                std::string _pid = current_msg.substr(11);
-                int playerid = stoi(_pid);
-
-                mtx_players.lock();
-                std::map<unsigned int, Player>::iterator it = players.find(playerid);
-                if (it != players.end()) {
-                    std::cout << "Player '" << it->second.name << "' leave" << std::endl;
-                    players.erase(it);
-                }
-                mtx_players.unlock();
-
-            }
-            else if (regex_match(current_msg, start) && current_status == Status::WAITING && userid != -1) {
-                mtx_status.lock();
-                current_status = Status::IN_PROGRESS;
-                mtx_status.unlock();
-
-                std::cout << "Let's go !" << std::endl;
+        }
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
 
-                interface_dealer = std::thread(deal_with_interface, std::move(interface_dealer_exit_signal.get_future()));
-                signal(SIGTERM, exit_handler);
-                signal(SIGINT, exit_handler);
+        valread = read(client_socket , buffer, N_CHAR);
 
-                keypress_dealer_exit_signal.set_value();
-                keypress_dealer.detach();
-            }
-            else if (regex_match(current_msg, playerfind) && current_status == Status::IN_PROGRESS && userid != -1) {
-                std::string _pid = current_msg.substr(11);
-                int playerid = stoi(_pid);
+        if (interface_closed) break; // avoid unnecessary treatments
+        if (valread <= 0) {
+            // connection lost : the game goes on if the server still has our session
+            if (session == 0 || current_status == Status::COMPLETED || !resume_session()) break;
+            messages.clear();
+            valread = 1;
+            continue;
+        }
 
-                current_msg.erase(0, current_msg.find(":") + 1);
-                std::string _oid = current_msg;
-                int objectid = stoi(_oid);
+        messages.append(buffer, valread);
 
-                mtx_players.lock();
-                std::map<unsigned int, Player>::iterator it = players.find(playerid);
-                if (it != players.end()) {
-                    it->second.nb_objects_found += 1;
+        // Split buffer in real messages (text or binary frames)
+        size_t offset = 0, length, consumed;
+        while ( (length = protocol::nextMessage(messages.data() + offset, messages.length() - offset, consumed)) > 0 || consumed > 0 ) {
+            const char *current_msg = messages.data() + offset;
+            offset += consumed;
 
-                    std::cout << "Player '" << it->second.name << "' found object id: " << std::to_string(objectid) << std::endl;
-                }
-                mtx_players.unlock();
+            // counted as the server does, even if it can not be decoded
+            if (length > 0 && !(protocol::isBinary(current_msg) &&
+                ((uint8_t) current_msg[0] == protocol::MSG_SNAPSHOT || (uint8_t) current_msg[0] == protocol::MSG_RESUME))) {
+                received++;
             }
-            else if (regex_match(current_msg, end) && current_status == Status::IN_PROGRESS && userid != -1) {
-                mtx_status.lock();
-                current_status = Status::COMPLETED;
-                mtx_status.unlock();
-
-                std::string _id = current_msg.substr(4);
-                int winnerid = stoi(_id);
-
-                if (winnerid == userid) {
-                    std::cout << "$$$$$$$$$$$$$$$" << std::endl;
-                    std::cout << "$$ YOU WIN ! $$" << std::endl;
-                    std::cout << "$$$$$$$$$$$$$$$" << std::endl << std::endl;
-                }
 
-                // Score board
-                mtx_players.lock();
-                std::cout << "========= ScoreBoard =========" << std::endl;
-                for (auto &user : players) {
-                    Player p = std::get<1>(user);
-                    std::string msg = "";
-
-                    if (p.id == userid) msg += "*";
-                    msg += p.name + " (id: " + std::to_string(p.id) +") = " + std::to_string(p.nb_objects_found);
-                    if (p.id == winnerid) msg += " WINNER";
-
-                    std::cout << msg << std::endl;
-                }
-                std::cout << "==============================" << std::endl;
-                mtx_players.unlock();
+            if (protocol::isBinary(current_msg)) {
+                if (!protocol::decodeBinary(current_msg, length, msg)) continue;
+            } else {
+                decode_text(std::string_view(current_msg, length), msg);
             }
+
+            if (!handle_message(msg)) return EXIT_FAILURE;
         }
+        messages.erase(0, offset);
     } while (valread != 0 && current_status != Status::COMPLETED);
 
     stop();
@@ -0,0 +1,230 @@
+#include <iostream>
+#include <cstring>
+#include <sstream>
+
+#include "EventLog.h"
+
+
+/*******************************
+ * Encoding
+*******************************/
+
+static void putVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out += (char) ((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    out += (char) v;
+}
+
+static void putFixed(std::string &out, uint64_t v, unsigned int bytes) {
+    for (unsigned int i = 0 ; i < bytes ; i++) {
+        out += (char) (v >> (8 * i));
+    }
+}
+
+static bool getVarint(std::string_view &in, uint64_t &v) {
+    v = 0;
+    for (unsigned int shift = 0 ; shift < 64 ; shift += 7) {
+        if (in.empty()) return false;
+        uint8_t b = (uint8_t) in[0];
+        in.remove_prefix(1);
+        v |= (uint64_t) (b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+static bool getFixed(std::string_view &in, uint64_t &v, unsigned int bytes) {
+    if (in.size() < bytes) return false;
+    v = 0;
+    for (unsigned int i = 0 ; i < bytes ; i++) {
+        v |= (uint64_t) (uint8_t) in[i] << (8 * i);
+    }
+    in.remove_prefix(bytes);
+    return true;
+}
+
+
+/*******************************
+ * Writer
+*******************************/
+
+EventLogWriter::EventLogWriter():
+    m_File(), m_Buffer(), m_Start(std::chrono::steady_clock::now()), m_Last(0), m_Failed(false)
+{
+}
+
+
+/**
+ * Create (or truncate) a log and write its header
+ *
+ * @param path log file
+ * @param error why the file can not be written
+ * @return the log, nullptr if the file can not be written
+ */
+std::unique_ptr<EventLogWriter> EventLogWriter::create(const std::string &path, std::string &error)
+{
+    std::unique_ptr<EventLogWriter> log(new EventLogWriter());
+
+    log->m_File.open(path, std::ios::binary | std::ios::trunc);
+    if (!log->m_File) {
+        error = "can not create '" + path + "': " + strerror(errno);
+        return nullptr;
+    }
+    log->m_Buffer.reserve(EVENT_LOG_BUFFER_SIZE + UINT16_MAX);
+    log->m_Buffer.append(EVENT_LOG_MAGIC, EVENT_LOG_MAGIC_SIZE);
+    return log;
+}
+
+
+/**
+ * Append a record
+ *
+ * @param type type of the event
+ * @param connection connection id (DATAGRAM : player id)
+ * @param when time of the event (time it was received, or time of the tick)
+ * @param data MESSAGE, DATAGRAM : bytes as received
+ * @param from DATAGRAM : address of the sender
+ */
+void EventLogWriter::record(LoggedEvent::Type type, unsigned int connection, std::chrono::steady_clock::time_point when,
+                            std::string_view data, const sockaddr_in *from)
+{
+    if (m_Failed) return;
+
+    // events are applied in the order of the queue, not of their reception : the difference can be negative
+    int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(when - m_Start).count();
+    int64_t delta = time - m_Last;
+    m_Last = time;
+
+    m_Buffer += (char) type;
+    putVarint(m_Buffer, connection);
+    putVarint(m_Buffer, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63)); // zigzag
+    if (type == LoggedEvent::DATAGRAM) {
+        putFixed(m_Buffer, from ? from->sin_addr.s_addr : 0, 4);
+        putFixed(m_Buffer, from ? from->sin_port : 0, 2);
+    }
+    if (type == LoggedEvent::MESSAGE || type == LoggedEvent::DATAGRAM) {
+        putVarint(m_Buffer, data.size());
+        m_Buffer.append(data.data(), data.size());
+    }
+
+    if (m_Buffer.size() >= EVENT_LOG_BUFFER_SIZE) flush();
+}
+
+
+/**
+ * Append a token drawn by a room (see Room::TokenSource)
+ *
+ * @param token the token
+ * @param when time it was drawn
+ */
+void EventLogWriter::recordToken(uint64_t token, std::chrono::steady_clock::time_point when)
+{
+    record(LoggedEvent::TOKEN, 0, when);
+    if (!m_Failed) putFixed(m_Buffer, token, 8); // payload, right after the header (even if record flushed it)
+}
+
+
+/**
+ * Write the buffered records
+ */
+void EventLogWriter::flush()
+{
+    m_File.write(m_Buffer.data(), (std::streamsize) m_Buffer.size());
+    m_Buffer.clear();
+    if (!m_File) {
+        std::cerr << "Event log: write failed, nothing more is recorded" << std::endl;
+        m_Failed = true;
+    }
+}
+
+
+/**
+ * Write the buffered records and close the file
+ */
+EventLogWriter::~EventLogWriter()
+{
+    if (!m_Failed && !m_Buffer.empty()) flush();
+}
+
+
+/*******************************
+ * Reader
+*******************************/
+
+EventLogReader::EventLogReader():
+    m_Content(), m_Next(), m_Time(0)
+{
+}
+
+
+/**
+ * Load a whole log and check its header
+ *
+ * @param path log file
+ * @param error why the file can not be read
+ * @return the log, nullptr if the file can not be read or is not a log
+ */
+std::unique_ptr<EventLogReader> EventLogReader::open(const std::string &path, std::string &error)
+{
+    std::unique_ptr<EventLogReader> log(new EventLogReader());
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "can not open '" + path + "': " + strerror(errno);
+        return nullptr;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    log->m_Content = content.str();
+
+    log->m_Next = log->m_Content;
+    if (log->m_Next.substr(0, EVENT_LOG_MAGIC_SIZE) != std::string_view(EVENT_LOG_MAGIC, EVENT_LOG_MAGIC_SIZE)) {
+        error = "'" + path + "' is not an event log (or of another version)";
+        return nullptr;
+    }
+    log->m_Next.remove_prefix(EVENT_LOG_MAGIC_SIZE);
+    return log;
+}
+
+
+/**
+ * Read the next record
+ *
+ * @param event the record (its data points into the log)
+ * @return false at the end of the log, or if the rest of it is truncated or corrupted
+ */
+bool EventLogReader::next(LoggedEvent &event)
+{
+    std::string_view in = m_Next;
+    uint64_t connection, delta, value, size;
+
+    if (in.empty() || (uint8_t) in[0] >= LoggedEvent::_TYPE_COUNT) return false;
+    event.type = (LoggedEvent::Type) in[0];
+    in.remove_prefix(1);
+    if (!getVarint(in, connection) || !getVarint(in, delta)) return false;
+    event.connection = (unsigned int) connection;
+    m_Time += (int64_t) (delta >> 1) ^ -(int64_t) (delta & 1);
+    event.time = std::chrono::nanoseconds(m_Time);
+
+    event.data = std::string_view();
+    event.from = {};
+    event.token = 0;
+    if (event.type == LoggedEvent::DATAGRAM) {
+        event.from.sin_family = AF_INET;
+        if (!getFixed(in, value, 4)) return false;
+        event.from.sin_addr.s_addr = (in_addr_t) value;
+        if (!getFixed(in, value, 2)) return false;
+        event.from.sin_port = (in_port_t) value;
+    }
+    if (event.type == LoggedEvent::TOKEN && !getFixed(in, event.token, 8)) return false;
+    if (event.type == LoggedEvent::MESSAGE || event.type == LoggedEvent::DATAGRAM) {
+        if (!getVarint(in, size) || size > in.size()) return false;
+        event.data = in.substr(0, size);
+        in.remove_prefix(size);
+    }
+
+    m_Next = in;
+    return true;
+}
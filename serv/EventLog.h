@@ -0,0 +1,148 @@
+#ifndef SERV_EVENTLOG_H
+#define SERV_EVENTLOG_H
+
+// Events applied by the game thread, recorded to replay a session through the same game logic, without sockets
+//
+// Header : magic (EVENT_LOG_MAGIC, 8 bytes)
+// Record : u8 type | varint connection id | zigzag varint nanoseconds since the previous record | payload
+//     MESSAGE  : varint length | message as received (text without delimiter, or binary frame)
+//     DATAGRAM : u32 address | u16 port (network order) | varint length | datagram as received
+//     TOKEN    : u64 token (little endian), drawn while the previous event was applied (the replay reads it back)
+//     CONNECTED, DISCONNECTED, TICK : nothing (a TICK closes the events applied before a tick)
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <netinet/in.h>
+
+// First bytes of a log (the last two are the format version)
+#define EVENT_LOG_MAGIC "WTDLOG02"
+#define EVENT_LOG_MAGIC_SIZE 8
+
+// Records buffered before a write
+#define EVENT_LOG_BUFFER_SIZE 65536UL
+
+
+/**
+ * One record of a log
+ */
+struct LoggedEvent {
+    enum Type : uint8_t {
+        CONNECTED,
+        MESSAGE,
+        DISCONNECTED,
+        DATAGRAM,
+        TICK,
+        TOKEN,
+        _TYPE_COUNT
+    };
+    Type type;
+    unsigned int connection; // connection id (DATAGRAM : player id, the low part of the token)
+    std::chrono::nanoseconds time; // since the log was created
+    std::string_view data; // MESSAGE, DATAGRAM : bytes as received (valid until the reader is destroyed)
+    sockaddr_in from; // DATAGRAM : address of the sender
+    uint64_t token; // TOKEN : the token drawn
+};
+
+
+/**
+ * Append-only log, written by the game thread only (buffered, written every EVENT_LOG_BUFFER_SIZE bytes)
+ */
+class EventLogWriter
+{
+private:
+
+    std::ofstream m_File;
+    std::string m_Buffer;
+
+    // time of the creation, and of the last record
+    std::chrono::steady_clock::time_point m_Start;
+    int64_t m_Last;
+
+    // a write failed : nothing more is recorded
+    bool m_Failed;
+
+    EventLogWriter();
+
+    /** write the buffered records */
+    void flush();
+
+public:
+
+    EventLogWriter(const EventLogWriter&) = delete;
+    EventLogWriter& operator=(const EventLogWriter&) = delete;
+
+    /**
+     * Create (or truncate) a log and write its header
+     *
+     * @param path log file
+     * @param error why the file can not be written
+     * @return the log, nullptr if the file can not be written
+     */
+    static std::unique_ptr<EventLogWriter> create(const std::string &path, std::string &error);
+
+    /** Write the buffered records and close the file */
+    ~EventLogWriter();
+
+    /**
+     * Append a record
+     *
+     * @param type type of the event
+     * @param connection connection id (DATAGRAM : player id)
+     * @param when time of the event (time it was received, or time of the tick)
+     * @param data MESSAGE, DATAGRAM : bytes as received
+     * @param from DATAGRAM : address of the sender
+     */
+    void record(LoggedEvent::Type type, unsigned int connection, std::chrono::steady_clock::time_point when,
+                std::string_view data = std::string_view(), const sockaddr_in *from = nullptr);
+
+    /**
+     * Append a token drawn by a room (see Room::TokenSource)
+     *
+     * @param token the token
+     * @param when time it was drawn
+     */
+    void recordToken(uint64_t token, std::chrono::steady_clock::time_point when);
+};
+
+
+/**
+ * Log loaded in memory at once, read record after record (a replay does not wait for the disk)
+ */
+class EventLogReader
+{
+private:
+
+    std::string m_Content;
+    std::string_view m_Next; // records not read yet
+    int64_t m_Time;
+
+    EventLogReader();
+
+public:
+
+    /**
+     * Load a whole log and check its header
+     *
+     * @param path log file
+     * @param error why the file can not be read
+     * @return the log, nullptr if the file can not be read or is not a log
+     */
+    static std::unique_ptr<EventLogReader> open(const std::string &path, std::string &error);
+
+    /**
+     * Read the next record
+     *
+     * @param event the record (its data points into the log)
+     * @return false at the end of the log, or if the rest of it is truncated or corrupted
+     */
+    bool next(LoggedEvent &event);
+
+    /** the whole log was read */
+    bool done() const { return m_Next.empty(); }
+};
+
+#endif
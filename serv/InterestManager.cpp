@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "InterestManager.h"
+
+
+/**
+ * Key of an ordered pair of players
+ */
+static uint64_t pair_key(unsigned int to, unsigned int about)
+{
+    return ((uint64_t) to << 32) | about;
+}
+
+
+/**
+ * @param radius distance under which two players see each other
+ */
+InterestManager::InterestManager(float radius):
+    m_Radius(radius), m_Visible(), m_Moved(), m_Near(), m_Gone(), m_Entered()
+{
+}
+
+
+/**
+ * A player moved (his new position is in the grid)
+ *
+ * @param id player id
+ */
+void InterestManager::moved(unsigned int id)
+{
+    m_Moved.insert(id);
+}
+
+
+/**
+ * Forget a player (the others are told he left the game by other means)
+ *
+ * @param id player id
+ */
+void InterestManager::remove(unsigned int id)
+{
+    std::unordered_map<unsigned int, std::unordered_set<unsigned int> >::iterator it = m_Visible.find(id);
+    if (it != m_Visible.end()) {
+        for (unsigned int peer : it->second) {
+            m_Visible[peer].erase(id);
+        }
+        m_Visible.erase(it);
+    }
+    m_Moved.erase(id);
+}
+
+
+/**
+ * Forget every player
+ */
+void InterestManager::clear()
+{
+    m_Visible.clear();
+    m_Moved.clear();
+}
+
+
+/**
+ * Is a player inside the area of interest of another one (at the last update) ?
+ *
+ * @param to player who sees
+ * @param about player seen
+ */
+bool InterestManager::sees(unsigned int to, unsigned int about) const
+{
+    std::unordered_map<unsigned int, std::unordered_set<unsigned int> >::const_iterator it = m_Visible.find(to);
+    return it != m_Visible.end() && it->second.count(about) > 0;
+}
+
+
+/**
+ * Update the areas of interest of the players who moved
+ *
+ * @param positions positions of the players
+ * @param events filled with what each player has to be told (cleared first, the MOVE of a player are contiguous)
+ */
+void InterestManager::update(const SpatialHash &positions, std::vector<Event> &events)
+{
+    events.clear();
+    m_Entered.clear();
+
+    for (unsigned int id : m_Moved) {
+        float pos[3];
+        if (!positions.get(id, pos)) continue; // no position (left)
+
+        std::unordered_set<unsigned int> &visible = m_Visible[id];
+        positions.query(pos, leaveRadius(), m_Near);
+        std::sort(m_Near.begin(), m_Near.end());
+
+        // too far now
+        m_Gone.clear();
+        for (unsigned int peer : visible) {
+            if (!std::binary_search(m_Near.begin(), m_Near.end(), peer)) m_Gone.push_back(peer);
+        }
+        std::sort(m_Gone.begin(), m_Gone.end());
+        for (unsigned int peer : m_Gone) {
+            visible.erase(peer);
+            m_Visible[peer].erase(id);
+            events.push_back(Event{Event::EXIT, id, peer});
+            events.push_back(Event{Event::EXIT, peer, id});
+        }
+
+        // close enough now, or still in the area
+        size_t first_move = events.size();
+        for (unsigned int peer : m_Near) {
+            if (peer == id) continue;
+            if (visible.count(peer)) {
+                if (!m_Entered.count(pair_key(peer, id))) events.push_back(Event{Event::MOVE, peer, id});
+            } else if (positions.isWithin(peer, pos, m_Radius)) {
+                visible.insert(peer);
+                m_Visible[peer].insert(id);
+                events.push_back(Event{Event::ENTER, id, peer});
+                events.push_back(Event{Event::ENTER, peer, id});
+                m_Entered.insert(pair_key(id, peer));
+                m_Entered.insert(pair_key(peer, id));
+            }
+        }
+
+        // keep the MOVE of this player together (one encoding for all of them)
+        std::stable_partition(events.begin() + (std::ptrdiff_t) first_move, events.end(), [](const Event &e) {
+            return e.type != Event::MOVE;
+        });
+    }
+    m_Moved.clear();
+}
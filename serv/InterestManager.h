@@ -0,0 +1,97 @@
+#ifndef SERV_INTERESTMANAGER_H
+#define SERV_INTERESTMANAGER_H
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdint.h>
+
+#include "SpatialHash.h"
+
+// A player leaves the area of interest of another one a bit farther than he enters it (no flickering on the border)
+#define INTEREST_HYSTERESIS 1.1f
+
+
+/**
+ * Area of interest of each player : the other players close enough to receive his moves.
+ * Visibility is symmetric, it is computed from the positions grid of the room for the players who moved only.
+ */
+class InterestManager
+{
+public:
+
+    /**
+     * What a player has to be told about another one
+     */
+    struct Event {
+        enum Type {
+            ENTER, // about is now visible (with his position)
+            MOVE,  // about, still visible, moved
+            EXIT   // about is no longer visible
+        };
+        Type type;
+        unsigned int to;
+        unsigned int about;
+    };
+
+private:
+
+    float m_Radius;
+
+    // players each player can see
+    std::unordered_map<unsigned int, std::unordered_set<unsigned int> > m_Visible;
+
+    // players who moved since the last update (ordered, for the same events from the same moves)
+    std::set<unsigned int> m_Moved;
+
+    // reused by each update
+    std::vector<unsigned int> m_Near;
+    std::vector<unsigned int> m_Gone;
+    std::unordered_set<uint64_t> m_Entered; // (to, about) pairs told ENTER, with the latest position already
+
+public:
+
+    /**
+     * @param radius distance under which two players see each other
+     */
+    explicit InterestManager(float radius);
+
+    /** distance above which two players no longer see each other */
+    float leaveRadius() const { return m_Radius * INTEREST_HYSTERESIS; }
+
+    /**
+     * A player moved (his new position is in the grid)
+     *
+     * @param id player id
+     */
+    void moved(unsigned int id);
+
+    /**
+     * Forget a player (the others are told he left the game by other means)
+     *
+     * @param id player id
+     */
+    void remove(unsigned int id);
+
+    /** forget every player */
+    void clear();
+
+    /**
+     * Is a player inside the area of interest of another one (at the last update) ?
+     *
+     * @param to player who sees
+     * @param about player seen
+     */
+    bool sees(unsigned int to, unsigned int about) const;
+
+    /**
+     * Update the areas of interest of the players who moved
+     *
+     * @param positions positions of the players
+     * @param events filled with what each player has to be told (cleared first, the MOVE of a player are contiguous)
+     */
+    void update(const SpatialHash &positions, std::vector<Event> &events);
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "IoUring.h"
+
+
+/**
+ * The io_uring system calls (glibc has no wrapper)
+ */
+static int io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+
+IoUring::IoUring():
+    m_Fd(-1), m_Rings(MAP_FAILED), m_RingsSize(0), m_Sqes((struct io_uring_sqe *) MAP_FAILED), m_SqesSize(0),
+    m_SqHead(nullptr), m_SqTail(nullptr), m_SqMask(0), m_SqEntries(0), m_SqLocalTail(0),
+    m_CqHead(nullptr), m_CqTail(nullptr), m_CqMask(0), m_Cqes(nullptr),
+    m_BufRing((struct io_uring_buf_ring *) MAP_FAILED), m_BufRingSize(0), m_Buffers(), m_NbBuffers(0), m_BufferSize(0), m_BufTail(0)
+{
+}
+
+
+/**
+ * Create a ring and register its receive buffers
+ * (it needs Linux 6.1 : single issuer, deferred task run, multishot receive, provided buffer rings)
+ *
+ * @param entries submission queue size (power of two)
+ * @param nb_buffers number of receive buffers (power of two)
+ * @param buffer_size bytes per receive buffer
+ * @param error why io_uring can not be used (old kernel, forbidden by seccomp...)
+ * @return the ring, nullptr if io_uring can not be used
+ */
+std::unique_ptr<IoUring> IoUring::create(unsigned entries, unsigned nb_buffers, unsigned buffer_size, std::string &error)
+{
+    std::unique_ptr<IoUring> ring(new IoUring());
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 8; // multishot operations complete more often than they are submitted
+
+    if ( (ring->m_Fd = io_uring_setup(entries, &params)) < 0 ) {
+        error = std::string("io_uring_setup: ") + strerror(errno);
+        return nullptr;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        error = "io_uring: kernel too old";
+        return nullptr;
+    }
+
+    // submission and completion rings share one mapping, the entries have their own
+    ring->m_RingsSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                 params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    ring->m_Rings = mmap(nullptr, ring->m_RingsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->m_Fd, IORING_OFF_SQ_RING);
+    if (ring->m_Rings == MAP_FAILED) {
+        error = std::string("io_uring mmap: ") + strerror(errno);
+        return nullptr;
+    }
+    ring->m_SqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->m_Sqes = (struct io_uring_sqe *) mmap(nullptr, ring->m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->m_Fd, IORING_OFF_SQES);
+    if (ring->m_Sqes == MAP_FAILED) {
+        error = std::string("io_uring mmap: ") + strerror(errno);
+        return nullptr;
+    }
+
+    char *sq = (char *) ring->m_Rings;
+    ring->m_SqHead = (unsigned *) (sq + params.sq_off.head);
+    ring->m_SqTail = (unsigned *) (sq + params.sq_off.tail);
+    ring->m_SqMask = *(unsigned *) (sq + params.sq_off.ring_mask);
+    ring->m_SqEntries = params.sq_entries;
+    ring->m_SqLocalTail = *ring->m_SqTail;
+    unsigned *array = (unsigned *) (sq + params.sq_off.array);
+    for (unsigned i = 0 ; i < params.sq_entries ; i++) array[i] = i; // entry i is always in slot i
+
+    char *cq = sq;
+    ring->m_CqHead = (unsigned *) (cq + params.cq_off.head);
+    ring->m_CqTail = (unsigned *) (cq + params.cq_off.tail);
+    ring->m_CqMask = *(unsigned *) (cq + params.cq_off.ring_mask);
+    ring->m_Cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    // receive buffers, handed to the kernel through a buffer ring
+    ring->m_NbBuffers = nb_buffers;
+    ring->m_BufferSize = buffer_size;
+    ring->m_Buffers.reset(new char[(size_t) nb_buffers * buffer_size]);
+    ring->m_BufRingSize = nb_buffers * sizeof(struct io_uring_buf);
+    ring->m_BufRing = (struct io_uring_buf_ring *) mmap(nullptr, ring->m_BufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->m_BufRing == MAP_FAILED) {
+        error = std::string("io_uring buffers: ") + strerror(errno);
+        return nullptr;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t) (uintptr_t) ring->m_BufRing;
+    reg.ring_entries = nb_buffers;
+    reg.bgid = IOURING_BUFFER_GROUP;
+    if (io_uring_register(ring->m_Fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        error = std::string("io_uring provided buffers: ") + strerror(errno);
+        return nullptr;
+    }
+    for (unsigned i = 0 ; i < nb_buffers ; i++) {
+        ring->recycle((uint16_t) i);
+    }
+
+    return ring;
+}
+
+
+/**
+ * Next free submission entry, cleared (the pending ones are submitted if the queue is full)
+ */
+struct io_uring_sqe *IoUring::sqe()
+{
+    while (m_SqLocalTail - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE) >= m_SqEntries) {
+        submit(0);
+    }
+
+    struct io_uring_sqe *entry = &m_Sqes[m_SqLocalTail & m_SqMask];
+    memset(entry, 0, sizeof(*entry));
+    m_SqLocalTail++;
+    return entry;
+}
+
+
+/**
+ * Submit the prepared entries and wait for completions (one system call)
+ *
+ * @param min_complete completions to wait for (0: do not wait)
+ * @return like io_uring_enter, -errno on error
+ */
+int IoUring::submit(unsigned min_complete)
+{
+    __atomic_store_n(m_SqTail, m_SqLocalTail, __ATOMIC_RELEASE);
+    unsigned to_submit = m_SqLocalTail - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE);
+
+    // GETEVENTS also runs the deferred completions (IORING_SETUP_DEFER_TASKRUN)
+    int ret = io_uring_enter(m_Fd, to_submit, min_complete, IORING_ENTER_GETEVENTS);
+    return ret < 0 ? -errno : ret;
+}
+
+
+/**
+ * Copy the available completions out of the queue
+ *
+ * @param out completions
+ * @param max size of out
+ * @return number of completions copied
+ */
+unsigned IoUring::reap(struct io_uring_cqe *out, unsigned max)
+{
+    unsigned head = *m_CqHead;
+    unsigned tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+    unsigned n = 0;
+
+    while (head != tail && n < max) {
+        out[n++] = m_Cqes[head & m_CqMask];
+        head++;
+    }
+    __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+
+/**
+ * Give a provided buffer back to the kernel, once its data was copied
+ *
+ * @param id buffer id
+ */
+void IoUring::recycle(uint16_t id)
+{
+    // not m_BufRing->bufs : in C++ the empty struct before this flexible array shifts it by 8 bytes
+    struct io_uring_buf *buf = (struct io_uring_buf *) m_BufRing + (m_BufTail & (m_NbBuffers - 1));
+    buf->addr = (uint64_t) (uintptr_t) (m_Buffers.get() + (size_t) id * m_BufferSize);
+    buf->len = m_BufferSize;
+    buf->bid = id;
+    m_BufTail++;
+    __atomic_store_n(&m_BufRing->tail, m_BufTail, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * Close the ring (every pending operation is cancelled)
+ */
+IoUring::~IoUring()
+{
+    if (m_Fd >= 0) close(m_Fd);
+    if (m_BufRing != MAP_FAILED) munmap(m_BufRing, m_BufRingSize);
+    if (m_Sqes != MAP_FAILED) munmap(m_Sqes, m_SqesSize);
+    if (m_Rings != MAP_FAILED) munmap(m_Rings, m_RingsSize);
+}
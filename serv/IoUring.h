@@ -0,0 +1,110 @@
+#ifndef SERV_IOURING_H
+#define SERV_IOURING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <memory>
+#include <linux/io_uring.h>
+
+// Group id of the provided receive buffers (only one group per ring)
+#define IOURING_BUFFER_GROUP 0
+
+
+/**
+ * Minimal io_uring, with the raw system calls (no liburing) : one submission queue, one completion queue
+ * and one ring of provided buffers for the multishot receives.
+ * Only the thread which created it can use it (IORING_SETUP_SINGLE_ISSUER).
+ */
+class IoUring
+{
+private:
+
+    int m_Fd;
+
+    // rings shared with the kernel (submission and completion rings in one mapping)
+    void *m_Rings;
+    size_t m_RingsSize;
+    struct io_uring_sqe *m_Sqes;
+    size_t m_SqesSize;
+
+    // submission queue : the kernel moves the head, we move the tail
+    unsigned *m_SqHead;
+    unsigned *m_SqTail;
+    unsigned m_SqMask;
+    unsigned m_SqEntries;
+    unsigned m_SqLocalTail; // prepared, published by submit()
+
+    // completion queue : the kernel moves the tail, we move the head
+    unsigned *m_CqHead;
+    unsigned *m_CqTail;
+    unsigned m_CqMask;
+    struct io_uring_cqe *m_Cqes;
+
+    // provided buffers : the kernel picks one for each receive, we give it back once copied
+    struct io_uring_buf_ring *m_BufRing;
+    size_t m_BufRingSize;
+    std::unique_ptr<char[]> m_Buffers;
+    unsigned m_NbBuffers; // power of two
+    unsigned m_BufferSize;
+    uint16_t m_BufTail;
+
+    IoUring();
+
+public:
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /**
+     * Create a ring and register its receive buffers
+     *
+     * @param entries submission queue size (power of two)
+     * @param nb_buffers number of receive buffers (power of two)
+     * @param buffer_size bytes per receive buffer
+     * @param error why io_uring can not be used (old kernel, forbidden by seccomp...)
+     * @return the ring, nullptr if io_uring can not be used
+     */
+    static std::unique_ptr<IoUring> create(unsigned entries, unsigned nb_buffers, unsigned buffer_size, std::string &error);
+
+    /** Close the ring (every pending operation is cancelled) */
+    ~IoUring();
+
+    /**
+     * Next free submission entry, cleared (the pending ones are submitted if the queue is full)
+     */
+    struct io_uring_sqe *sqe();
+
+    /**
+     * Submit the prepared entries and wait for completions (one system call)
+     *
+     * @param min_complete completions to wait for (0: do not wait)
+     * @return like io_uring_enter, -errno on error
+     */
+    int submit(unsigned min_complete);
+
+    /**
+     * Copy the available completions out of the queue
+     *
+     * @param out completions
+     * @param max size of out
+     * @return number of completions copied
+     */
+    unsigned reap(struct io_uring_cqe *out, unsigned max);
+
+    /**
+     * Data of a provided buffer, picked by the kernel for a receive
+     *
+     * @param id buffer id (cqe flags >> IORING_CQE_BUFFER_SHIFT)
+     */
+    const char *buffer(uint16_t id) const { return m_Buffers.get() + (size_t) id * m_BufferSize; }
+
+    /**
+     * Give a provided buffer back to the kernel, once its data was copied
+     *
+     * @param id buffer id
+     */
+    void recycle(uint16_t id);
+};
+
+#endif
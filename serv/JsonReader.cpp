@@ -0,0 +1,325 @@
+#include <cstdlib>
+
+#include "JsonReader.h"
+
+
+/**
+ * @param in the document (read as needed)
+ */
+JsonReader::JsonReader(std::istream &in):
+    m_In(in.rdbuf()), m_Line(1), m_Column(1), m_Stack(), m_First(false), m_AfterKey(false), m_Started(false),
+    m_Text(), m_Number(0), m_Boolean(false), m_Error()
+{
+}
+
+
+/**
+ * Next character, without reading it (EOF at the end)
+ */
+int JsonReader::peek()
+{
+    return m_In ? m_In->sgetc() : EOF;
+}
+
+
+/**
+ * Read a character
+ */
+int JsonReader::get()
+{
+    int c = m_In ? m_In->sbumpc() : EOF;
+    if (c == '\n') {
+        m_Line++;
+        m_Column = 1;
+    } else if (c != EOF) {
+        m_Column++;
+    }
+    return c;
+}
+
+
+/**
+ * Skip spaces and comments
+ */
+void JsonReader::skipSpaces()
+{
+    while (true) {
+        int c = peek();
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            get();
+        } else if (c == '/') {
+            get();
+            c = get();
+            if (c == '/') {
+                while (c != '\n' && c != EOF) c = get();
+            } else if (c == '*') {
+                int previous = 0;
+                while ((c = get()) != EOF && !(previous == '*' && c == '/')) previous = c;
+            } else {
+                fail("'/' outside of a comment");
+                return;
+            }
+        } else {
+            return;
+        }
+    }
+}
+
+
+/**
+ * Position of the reader, "Line <l>, column <c>"
+ */
+std::string JsonReader::where() const
+{
+    return "Line " + std::to_string(m_Line) + ", column " + std::to_string(m_Column);
+}
+
+
+/**
+ * Stop at an error
+ */
+JsonReader::Token JsonReader::fail(const std::string &message)
+{
+    if (m_Error.empty()) m_Error = where() + ": " + message + "\n";
+    return ERROR;
+}
+
+
+/**
+ * Read the next token
+ *
+ * @return the token, END once the whole document was read, ERROR if it is malformed (and from then on)
+ */
+JsonReader::Token JsonReader::next()
+{
+    if (!m_Error.empty()) return ERROR;
+    skipSpaces();
+    if (!m_Error.empty()) return ERROR;
+    int c = peek();
+
+    // top level : one value, then nothing
+    if (m_Stack.empty()) {
+        if (m_Started) return c == EOF ? END : fail("unexpected character after the document");
+        m_Started = true;
+        return value();
+    }
+
+    bool in_object = m_Stack.back() == '{';
+    if (m_AfterKey) {
+        if (c != ':') return fail("':' expected after a key");
+        get();
+        skipSpaces();
+        m_AfterKey = false;
+        return value();
+    }
+
+    if (c == (in_object ? '}' : ']')) {
+        get();
+        return close();
+    }
+    if (!m_First) {
+        if (c != ',') return fail(in_object ? "',' or '}' expected" : "',' or ']' expected");
+        get();
+        skipSpaces();
+        c = peek();
+    }
+    m_First = false;
+
+    if (in_object) {
+        if (c != '"') return fail("key expected");
+        if (!readString()) return ERROR;
+        m_AfterKey = true;
+        return KEY;
+    }
+    return value();
+}
+
+
+/**
+ * Read a value, from its first character
+ */
+JsonReader::Token JsonReader::value()
+{
+    int c = peek();
+
+    switch (c) {
+    case '{':
+    case '[':
+        get();
+        m_Stack.push_back((char) c);
+        m_First = true;
+        return c == '{' ? BEGIN_OBJECT : BEGIN_ARRAY;
+    case '"':
+        return readString() ? STRING : ERROR;
+    case 't':
+        return literal("true", BOOLEAN, true);
+    case 'f':
+        return literal("false", BOOLEAN, false);
+    case 'n':
+        return literal("null", NONE, false);
+    case EOF:
+        return fail("unexpected end of the document");
+    default:
+        if (c == '-' || (c >= '0' && c <= '9')) return readNumber();
+        return fail(std::string("unexpected character '") + (char) c + "'");
+    }
+}
+
+
+/**
+ * Close the innermost object or array
+ */
+JsonReader::Token JsonReader::close()
+{
+    char open = m_Stack.back();
+    m_Stack.pop_back();
+    m_First = false; // the parent holds at least this value
+    return open == '{' ? END_OBJECT : END_ARRAY;
+}
+
+
+/**
+ * Read a literal (true, false, null)
+ */
+JsonReader::Token JsonReader::literal(const char *word, Token token, bool boolean)
+{
+    for (const char *w = word ; *w != '\0' ; w++) {
+        if (get() != *w) return fail(std::string("'") + word + "' expected");
+    }
+    m_Boolean = boolean;
+    return token;
+}
+
+
+/**
+ * Read a number into m_Number
+ */
+JsonReader::Token JsonReader::readNumber()
+{
+    char digits[64];
+    size_t size = 0;
+
+    int c = peek();
+    while (c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E' || (c >= '0' && c <= '9')) {
+        if (size == sizeof(digits) - 1) return fail("number too long");
+        digits[size++] = (char) get();
+        c = peek();
+    }
+    digits[size] = '\0';
+
+    char *end;
+    m_Number = strtod(digits, &end);
+    if (end != digits + size) return fail(std::string("malformed number '") + digits + "'");
+    return NUMBER;
+}
+
+
+/**
+ * Append a code point to a string, in UTF-8
+ */
+static void append_utf8(std::string &out, uint32_t code)
+{
+    if (code < 0x80) {
+        out += (char) code;
+    } else if (code < 0x800) {
+        out += (char) (0xC0 | (code >> 6));
+        out += (char) (0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += (char) (0xE0 | (code >> 12));
+        out += (char) (0x80 | ((code >> 6) & 0x3F));
+        out += (char) (0x80 | (code & 0x3F));
+    } else {
+        out += (char) (0xF0 | (code >> 18));
+        out += (char) (0x80 | ((code >> 12) & 0x3F));
+        out += (char) (0x80 | ((code >> 6) & 0x3F));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+}
+
+
+/**
+ * Read the 4 hexadecimal digits of a \u escape
+ */
+bool JsonReader::hex4(uint32_t &code)
+{
+    code = 0;
+    for (int i = 0 ; i < 4 ; i++) {
+        int c = get();
+        if (c >= '0' && c <= '9') code = code * 16 + (uint32_t) (c - '0');
+        else if (c >= 'a' && c <= 'f') code = code * 16 + (uint32_t) (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') code = code * 16 + (uint32_t) (c - 'A' + 10);
+        else {
+            fail("malformed \\u escape");
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * Read a string (the opening quote is next) into m_Text
+ */
+bool JsonReader::readString()
+{
+    m_Text.clear();
+    get(); // "
+
+    while (true) {
+        int c = get();
+        if (c == '"') return true;
+        if (c == EOF || (c >= 0 && c < 0x20)) {
+            fail(c == EOF ? "unterminated string" : "control character in a string");
+            return false;
+        }
+        if (c != '\\') {
+            m_Text += (char) c;
+            continue;
+        }
+
+        uint32_t code, low;
+        switch (c = get()) {
+        case '"': case '\\': case '/': m_Text += (char) c; break;
+        case 'b': m_Text += '\b'; break;
+        case 'f': m_Text += '\f'; break;
+        case 'n': m_Text += '\n'; break;
+        case 'r': m_Text += '\r'; break;
+        case 't': m_Text += '\t'; break;
+        case 'u':
+            if (!hex4(code)) return false;
+            // a character out of the basic plane is a pair of surrogates
+            if (code >= 0xD800 && code < 0xDC00) {
+                if (get() != '\\' || get() != 'u' || !hex4(low) || low < 0xDC00 || low >= 0xE000) {
+                    if (m_Error.empty()) fail("unpaired surrogate in a string");
+                    return false;
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            append_utf8(m_Text, code);
+            break;
+        default:
+            fail("unknown escape in a string");
+            return false;
+        }
+    }
+}
+
+
+/**
+ * Skip a value whose first token was just read (the whole object or array for BEGIN_OBJECT / BEGIN_ARRAY)
+ *
+ * @param token the first token of the value
+ * @return false on error
+ */
+bool JsonReader::skip(Token token)
+{
+    if (token == ERROR) return false;
+    if (token != BEGIN_OBJECT && token != BEGIN_ARRAY) return true;
+
+    size_t depth = m_Stack.size();
+    while (m_Stack.size() >= depth) {
+        Token t = next();
+        if (t == ERROR || t == END) return false;
+    }
+    return true;
+}
@@ -0,0 +1,120 @@
+#ifndef SERV_JSONREADER_H
+#define SERV_JSONREADER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <istream>
+
+
+/**
+ * Streaming JSON reader : the document is read once, token after token, and never held in memory
+ * (the caller builds what it needs as the tokens come, and skips what it does not know).
+ * C and C++ comments are allowed, as jsoncpp allowed them in the config files.
+ */
+class JsonReader
+{
+public:
+
+    enum Token {
+        BEGIN_OBJECT,
+        END_OBJECT,
+        BEGIN_ARRAY,
+        END_ARRAY,
+        KEY, // text()
+        STRING, // text()
+        NUMBER, // number()
+        BOOLEAN, // boolean()
+        NONE, // null
+        END, // end of the document
+        ERROR // error()
+    };
+
+private:
+
+    std::streambuf *m_In;
+
+    // position of the next character (for the errors)
+    unsigned int m_Line;
+    unsigned int m_Column;
+
+    // open objects ('{') and arrays ('['), and where we are in the innermost one
+    std::vector<char> m_Stack;
+    bool m_First; // nothing read in it yet
+    bool m_AfterKey; // a key was read, its value comes next
+    bool m_Started; // the top-level value was read (or is being read)
+
+    std::string m_Text;
+    double m_Number;
+    bool m_Boolean;
+    std::string m_Error;
+
+    /** next character, without reading it (EOF at the end) */
+    int peek();
+
+    /** read a character */
+    int get();
+
+    /** skip spaces and comments */
+    void skipSpaces();
+
+    /** read a value, from its first character */
+    Token value();
+
+    /** read a string (the opening quote is next) into m_Text */
+    bool readString();
+
+    /** read the 4 hexadecimal digits of a \u escape */
+    bool hex4(uint32_t &code);
+
+    /** read a number into m_Number */
+    Token readNumber();
+
+    /** read a literal (true, false, null) */
+    Token literal(const char *word, Token token, bool boolean);
+
+    /** close the innermost object or array */
+    Token close();
+
+    /** stop at an error */
+    Token fail(const std::string &message);
+
+public:
+
+    /**
+     * @param in the document (read as needed)
+     */
+    explicit JsonReader(std::istream &in);
+
+    /**
+     * Read the next token
+     *
+     * @return the token, END once the whole document was read, ERROR if it is malformed (and from then on)
+     */
+    Token next();
+
+    /**
+     * Skip a value whose first token was just read (the whole object or array for BEGIN_OBJECT / BEGIN_ARRAY)
+     *
+     * @param token the first token of the value
+     * @return false on error
+     */
+    bool skip(Token token);
+
+    /** text of the last KEY or STRING */
+    const std::string &text() const { return m_Text; }
+
+    /** value of the last NUMBER */
+    double number() const { return m_Number; }
+
+    /** value of the last BOOLEAN */
+    bool boolean() const { return m_Boolean; }
+
+    /** why the document is malformed, with the line and column */
+    const std::string &error() const { return m_Error; }
+
+    /** position of the reader, "Line <l>, column <c>" (for the errors of the caller) */
+    std::string where() const;
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include <iostream>
+
+#include "Lobby.h"
+
+
+/**
+ * Create the rooms, one per room of the config
+ *
+ * @param world server config
+ * @param udp unreliable channel of the clients (nullptr: TCP only)
+ * @param tokens source of the tokens of the players
+ */
+Lobby::Lobby(std::shared_ptr<const WorldConfig> world, UdpChannel *udp, TokenSource tokens):
+    m_Rooms(), m_Connections(), m_Players(), m_World(world), m_Udp(udp), m_Tokens(tokens)
+{
+    for (unsigned int i = 0 ; i < m_World->rooms.size() ; i++) {
+        m_Rooms.emplace_back(new Room(i+1, m_World->rooms[i], m_Udp, m_Tokens));
+    }
+}
+
+
+/**
+ * Use a new config : each room changes once its players have left, rooms are added or closed
+ * (a room keeps its number, the room i of the config is the room i of the lobby)
+ *
+ * @param world new server config
+ */
+void Lobby::configure(std::shared_ptr<const WorldConfig> world)
+{
+    m_World = world;
+
+    for (unsigned int i = 0 ; i < m_Rooms.size() ; i++) {
+        m_Rooms[i]->configure(i < m_World->rooms.size() ? m_World->rooms[i] : nullptr);
+    }
+    for (unsigned int i = (unsigned int) m_Rooms.size() ; i < m_World->rooms.size() ; i++) {
+        m_Rooms.emplace_back(new Room(i+1, m_World->rooms[i], m_Udp, m_Tokens));
+    }
+}
+
+
+/**
+ * Number of rooms in a status
+ *
+ * @param status game status
+ */
+unsigned int Lobby::count(Status status) const
+{
+    unsigned int nb = 0;
+    for (auto &room : m_Rooms) {
+        if (room->status() == status) nb++;
+    }
+    return nb;
+}
+
+
+/**
+ * A new connection was accepted by a reactor
+ * (it enters a room with its first message, unless this message resumes a session : see message)
+ *
+ * @param id connection id
+ * @param socket player connection
+ * @param reactor owner of the connection
+ * @return true (the connection is refused by its first message if every room is full or playing)
+ */
+bool Lobby::connect(unsigned int id, int socket, Reactor *reactor)
+{
+    m_Connections[id] = Link{0, socket, reactor};
+    return true;
+}
+
+
+/**
+ * A player sent a message, forwarded to his room
+ * The first message of a connection is routed before any room admission : RESUME moves the session of a player to
+ * this connection (even if the server did not notice yet that his previous one was lost, whatever the status of the
+ * rooms), any other message makes the connection a new player of the first room waiting for players.
+ *
+ * @param id connection id
+ * @param msg the decoded message (MSG_UNKNOWN if malformed)
+ * @return false if the connection was refused (session unknown, or every room full or playing)
+ */
+bool Lobby::message(unsigned int id, const protocol::Message &msg)
+{
+    std::map<unsigned int, Link>::iterator link = m_Connections.find(id);
+    if (link == m_Connections.end()) return true; // refused, the reactor will close the socket
+    Link &from = link->second;
+
+    if (from.player == 0 && msg.type == protocol::MSG_RESUME) {
+        std::map<unsigned int, Room*>::iterator session = m_Players.find(msg.id);
+        if (session != m_Players.end() && session->second->resume(msg.id, msg.session, msg.value, id, from.socket, from.reactor)) {
+            from.player = msg.id;
+            return true;
+        }
+
+        std::cout << "Client (connection: " << id << ") can not resume session " << msg.id << std::endl;
+        protocol::Message answer = {protocol::MSG_TEXT, 0, 0, 0, {}, {}, "Session inconnue."};
+        from.reactor->post(id, from.socket, std::make_shared<const std::string>(protocol::encode(answer, 0)));
+        from.reactor->disconnect(id, from.socket);
+        m_Connections.erase(link);
+        return false;
+    }
+
+    if (from.player == 0) {
+        for (auto &room : m_Rooms) {
+            if (room->isOpen()) {
+                room->join(id, from.socket, from.reactor);
+                m_Players[id] = room.get();
+                from.player = id;
+                break;
+            }
+        }
+    }
+
+    std::map<unsigned int, Room*>::iterator it = m_Players.find(from.player);
+    if (it == m_Players.end()) {
+        std::cout << "out" << std::endl;
+        // Maximum number of players already reached in every room
+        // Or games already in progress
+        from.reactor->disconnect(id, from.socket);
+        m_Connections.erase(link);
+        return false;
+    }
+    it->second->message(from.player, msg);
+    return true;
+}
+
+
+/**
+ * A datagram was received, forwarded to the room of the player its token names
+ *
+ * @param id player id (low bits of the token)
+ * @param token token of the datagram
+ * @param seq sequence of the datagram
+ * @param from address of the sender
+ * @param msg the decoded message
+ */
+void Lobby::datagram(unsigned int id, uint64_t token, uint32_t seq, const sockaddr_in &from, const protocol::Message &msg)
+{
+    std::map<unsigned int, Room*>::iterator it = m_Players.find(id);
+    if (it == m_Players.end()) return; // unknown or gone
+
+    it->second->datagram(id, token, seq, from, msg);
+}
+
+
+/**
+ * A connection was closed by a reactor
+ *
+ * @param id connection id
+ */
+void Lobby::disconnect(unsigned int id)
+{
+    std::map<unsigned int, Link>::iterator link = m_Connections.find(id);
+    if (link == m_Connections.end()) return;
+    unsigned int player = link->second.player;
+    m_Connections.erase(link);
+
+    std::map<unsigned int, Room*>::iterator it = m_Players.find(player);
+    if (it == m_Players.end()) return;
+
+    // with a resumable session, he stays in his room for a while
+    if (!it->second->leave(player, id)) m_Players.erase(it);
+}
+
+
+/**
+ * Move every room forward (and remove the closed rooms once empty)
+ *
+ * @param now time of the tick
+ */
+void Lobby::tick(std::chrono::steady_clock::time_point now)
+{
+    std::vector<unsigned int> released;
+
+    for (auto &room : m_Rooms) {
+        room->tick(now, released);
+    }
+    for (unsigned int player : released) {
+        m_Players.erase(player);
+    }
+
+    // only the last ones, to keep the numbers of the others
+    while (!m_Rooms.empty() && m_Rooms.back()->closed() && m_Rooms.back()->empty()) {
+        std::cout << "Room " << m_Rooms.back()->id() << " closed" << std::endl;
+        m_Rooms.pop_back();
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef SERV_LOBBY_H
+#define SERV_LOBBY_H
+
+#include <map>
+#include <vector>
+#include <memory>
+
+#include "Protocol.h"
+#include "Reactor.h"
+#include "UdpChannel.h"
+#include "WorldConfig.h"
+#include "Room.h"
+
+
+/**
+ * Every room of the server, and the room of each connected player.
+ * A new player enters the first room waiting for players with his first message, he is refused if they are all
+ * full or playing. A first message RESUME moves the session of a player to the connection instead.
+ * Only used by the game thread.
+ */
+class Lobby
+{
+private:
+
+    // an open connection, and the player it is (0: no message received yet)
+    struct Link {
+        unsigned int player;
+        int socket;
+        Reactor *reactor;
+    };
+
+    std::vector<std::unique_ptr<Room> > m_Rooms;
+
+    // open connections (key: connection id, the id of the player who joined with it)
+    std::map<unsigned int, Link> m_Connections;
+
+    // room of each player, until he leaves it (key: player id, a session can outlive its connection)
+    std::map<unsigned int, Room*> m_Players;
+
+    // config the rooms were created (or reconfigured) from
+    std::shared_ptr<const WorldConfig> m_World;
+    UdpChannel *m_Udp;
+
+    // tokens of the players of every room
+    TokenSource m_Tokens;
+
+public:
+
+    /**
+     * Create the rooms, one per room of the config
+     *
+     * @param world server config
+     * @param udp unreliable channel of the clients (nullptr: TCP only)
+     * @param tokens source of the tokens of the players
+     */
+    Lobby(std::shared_ptr<const WorldConfig> world, UdpChannel *udp, TokenSource tokens);
+
+    /** config the rooms were created (or reconfigured) from */
+    const std::shared_ptr<const WorldConfig> &world() const { return m_World; }
+
+    /**
+     * Use a new config : each room changes once its players have left, rooms are added or closed
+     *
+     * @param world new server config
+     */
+    void configure(std::shared_ptr<const WorldConfig> world);
+
+    /** number of rooms */
+    size_t size() const { return m_Rooms.size(); }
+
+    /** number of rooms in a status */
+    unsigned int count(Status status) const;
+
+    /** number of players in the rooms */
+    size_t players() const { return m_Players.size(); }
+
+    /**
+     * A new connection was accepted by a reactor
+     *
+     * @param id connection id
+     * @param socket player connection
+     * @param reactor owner of the connection
+     * @return true (the connection is refused by its first message if every room is full or playing)
+     */
+    bool connect(unsigned int id, int socket, Reactor *reactor);
+
+    /**
+     * A player sent a message, forwarded to his room (the first message of a connection resumes a session, or
+     * makes it a new player)
+     *
+     * @param id connection id
+     * @param msg the decoded message (MSG_UNKNOWN if malformed)
+     * @return false if the connection was refused (session unknown, or every room full or playing)
+     */
+    bool message(unsigned int id, const protocol::Message &msg);
+
+    /**
+     * A datagram was received, forwarded to the room of the player its token names
+     *
+     * @param id player id (low bits of the token)
+     * @param token token of the datagram
+     * @param seq sequence of the datagram
+     * @param from address of the sender
+     * @param msg the decoded message
+     */
+    void datagram(unsigned int id, uint64_t token, uint32_t seq, const sockaddr_in &from, const protocol::Message &msg);
+
+    /**
+     * A connection was closed by a reactor
+     *
+     * @param id connection id
+     */
+    void disconnect(unsigned int id);
+
+    /**
+     * Move every room forward (and remove the closed rooms once empty)
+     *
+     * @param now time of the tick
+     */
+    void tick(std::chrono::steady_clock::time_point now);
+};
+
+#endif
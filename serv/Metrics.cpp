@@ -0,0 +1,156 @@
+#include <cstdio>
+
+#include "Metrics.h"
+
+static const double BUCKET_BOUNDS[NB_HISTOGRAM_BUCKETS] = HISTOGRAM_BUCKETS;
+static const char* const ROOM_STATUS_NAMES[NB_ROOM_STATUS] = {"waiting", "starting", "in_progress", "completed"};
+
+
+/**
+ * Append the header of a metric
+ *
+ * @param out text to append to
+ * @param name metric name
+ * @param type counter, gauge or histogram
+ * @param help metric description
+ */
+static void render_header(std::string &out, const char *name, const char *type, const char *help)
+{
+    out += "# HELP ";
+    out += name;
+    out += " ";
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " ";
+    out += type;
+    out += "\n";
+}
+
+/**
+ * Append one sample of a metric
+ *
+ * @param out text to append to
+ * @param name metric name
+ * @param labels labels, without braces ("" : none)
+ * @param value the value
+ */
+static void render_sample(std::string &out, const std::string &name, const std::string &labels, uint64_t value)
+{
+    out += name;
+    if (!labels.empty()) out += "{" + labels + "}";
+    out += " " + std::to_string(value) + "\n";
+}
+
+/**
+ * Sum of a counter over several event loops
+ */
+static uint64_t sum(const std::vector<const TrafficStats*> &stats, std::atomic<uint64_t> TrafficStats::*counter)
+{
+    uint64_t total = 0;
+    for (const TrafficStats *s : stats) total += (s->*counter).load(std::memory_order_relaxed);
+    return total;
+}
+
+
+Histogram::Histogram(): m_Sum(0), m_Count(0)
+{
+    for (std::atomic<uint64_t> &b : m_Buckets) b.store(0, std::memory_order_relaxed);
+}
+
+
+/**
+ * Count a duration
+ *
+ * @param seconds the duration
+ */
+void Histogram::observe(double seconds)
+{
+    unsigned int i = 0;
+    while (i < NB_HISTOGRAM_BUCKETS && seconds > BUCKET_BOUNDS[i]) i++;
+
+    m_Buckets[i].store(m_Buckets[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_Sum.store(m_Sum.load(std::memory_order_relaxed) + (uint64_t) (seconds * 1e9), std::memory_order_relaxed);
+    m_Count.store(m_Count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+
+/**
+ * Append the histogram in Prometheus text format
+ *
+ * @param out text to append to
+ * @param name metric name
+ * @param help metric description
+ */
+void Histogram::render(std::string &out, const char *name, const char *help) const
+{
+    char bound[32];
+    uint64_t cumulated = 0;
+
+    render_header(out, name, "histogram", help);
+    for (unsigned int i = 0 ; i <= NB_HISTOGRAM_BUCKETS ; i++) {
+        cumulated += m_Buckets[i].load(std::memory_order_relaxed);
+        if (i < NB_HISTOGRAM_BUCKETS) snprintf(bound, sizeof(bound), "%g", BUCKET_BOUNDS[i]);
+        render_sample(out, std::string(name) + "_bucket", std::string("le=\"") + (i < NB_HISTOGRAM_BUCKETS ? bound : "+Inf") + "\"", cumulated);
+    }
+
+    snprintf(bound, sizeof(bound), "%.9f", (double) m_Sum.load(std::memory_order_relaxed) / 1e9);
+    out += std::string(name) + "_sum " + bound + "\n";
+    render_sample(out, std::string(name) + "_count", "", m_Count.load(std::memory_order_relaxed));
+}
+
+
+/**
+ * Prometheus text format of every metric
+ *
+ * @param tcp traffic of each reactor
+ * @param udp traffic of the UDP channel (nullptr: none)
+ * @return the text, served on /metrics
+ */
+std::string Metrics::render(const std::vector<const TrafficStats*> &tcp, const TrafficStats *udp) const
+{
+    std::string out;
+    std::vector<const TrafficStats*> datagrams;
+    if (udp) datagrams.push_back(udp);
+
+    render_header(out, "wtd_connections_accepted_total", "counter", "TCP connections accepted by the reactors");
+    render_sample(out, "wtd_connections_accepted_total", "", sum(tcp, &TrafficStats::connections_accepted));
+    render_header(out, "wtd_connections_rejected_total", "counter", "Connections refused by the lobby (every room full or playing)");
+    render_sample(out, "wtd_connections_rejected_total", "", connections_rejected.load(std::memory_order_relaxed));
+    render_header(out, "wtd_resume_failed_total", "counter", "Connections refused by the lobby (session unknown or expired)");
+    render_sample(out, "wtd_resume_failed_total", "", resume_failed.load(std::memory_order_relaxed));
+    render_header(out, "wtd_connections_closed_total", "counter", "TCP connections closed");
+    render_sample(out, "wtd_connections_closed_total", "", sum(tcp, &TrafficStats::connections_closed));
+
+    render_header(out, "wtd_bytes_received_total", "counter", "Bytes received from the clients");
+    render_sample(out, "wtd_bytes_received_total", "transport=\"tcp\"", sum(tcp, &TrafficStats::bytes_in));
+    render_sample(out, "wtd_bytes_received_total", "transport=\"udp\"", sum(datagrams, &TrafficStats::bytes_in));
+    render_header(out, "wtd_bytes_sent_total", "counter", "Bytes sent to the clients");
+    render_sample(out, "wtd_bytes_sent_total", "transport=\"tcp\"", sum(tcp, &TrafficStats::bytes_out));
+    render_sample(out, "wtd_bytes_sent_total", "transport=\"udp\"", sum(datagrams, &TrafficStats::bytes_out));
+
+    render_header(out, "wtd_messages_received_total", "counter", "Messages decoded, by type (UNKNOWN: malformed or unknown command)");
+    for (unsigned int type = 0 ; type < protocol::_MSG_COUNT ; type++) {
+        uint64_t nb_tcp = 0, nb_udp = 0;
+        for (const TrafficStats *s : tcp) nb_tcp += s->messages[type].load(std::memory_order_relaxed);
+        if (udp) nb_udp = udp->messages[type].load(std::memory_order_relaxed);
+        std::string label = std::string("type=\"") + protocol::MESSAGE_TYPE_NAMES[type] + "\"";
+        if (nb_tcp > 0 || type == protocol::MSG_UNKNOWN) render_sample(out, "wtd_messages_received_total", "transport=\"tcp\"," + label, nb_tcp);
+        if (nb_udp > 0) render_sample(out, "wtd_messages_received_total", "transport=\"udp\"," + label, nb_udp);
+    }
+
+    render_header(out, "wtd_players", "gauge", "Players in the rooms");
+    render_sample(out, "wtd_players", "", players.load(std::memory_order_relaxed));
+    render_header(out, "wtd_rooms", "gauge", "Rooms, by game status");
+    for (unsigned int status = 0 ; status < NB_ROOM_STATUS ; status++) {
+        render_sample(out, "wtd_rooms", std::string("status=\"") + ROOM_STATUS_NAMES[status] + "\"", rooms[status].load(std::memory_order_relaxed));
+    }
+
+    render_header(out, "wtd_game_events_total", "counter", "Events applied by the game thread");
+    render_sample(out, "wtd_game_events_total", "", events.load(std::memory_order_relaxed));
+    event_wait.render(out, "wtd_game_event_wait_seconds", "Time between an event of a reactor and its processing by the game thread");
+    tick_duration.render(out, "wtd_tick_duration_seconds", "Time spent by the game thread in each tick");
+    fanout_duration.render(out, "wtd_fanout_duration_seconds", "Time spent replicating the rooms to their players in each tick");
+
+    return out;
+}
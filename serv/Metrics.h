@@ -0,0 +1,93 @@
+#ifndef SERV_METRICS_H
+#define SERV_METRICS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "Protocol.h"
+
+// Upper bounds (seconds) of the histogram buckets, the last one is +Inf
+#define HISTOGRAM_BUCKETS {0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0}
+#define NB_HISTOGRAM_BUCKETS 16
+
+// Game status of a room (Status of Room.h)
+#define NB_ROOM_STATUS 4
+
+
+/**
+ * Traffic of one event loop (a reactor or the UDP channel).
+ * Only its thread writes it (relaxed atomics, no contention), the metrics server reads it.
+ */
+struct TrafficStats {
+    std::atomic<uint64_t> connections_accepted{0};
+    std::atomic<uint64_t> connections_closed{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> messages[protocol::_MSG_COUNT] = {}; // decoded, by type (MSG_UNKNOWN: malformed or unknown)
+
+    /** add to a counter (from the owner thread only) */
+    static void add(std::atomic<uint64_t> &counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+
+/**
+ * Distribution of durations, in Prometheus histogram buckets (only one thread observes it)
+ */
+class Histogram
+{
+private:
+
+    std::atomic<uint64_t> m_Buckets[NB_HISTOGRAM_BUCKETS + 1]; // not cumulative, the last one is +Inf
+    std::atomic<uint64_t> m_Sum; // nanoseconds
+    std::atomic<uint64_t> m_Count;
+
+public:
+
+    Histogram();
+
+    /**
+     * Count a duration
+     *
+     * @param seconds the duration
+     */
+    void observe(double seconds);
+
+    /**
+     * Append the histogram in Prometheus text format
+     *
+     * @param out text to append to
+     * @param name metric name
+     * @param help metric description
+     */
+    void render(std::string &out, const char *name, const char *help) const;
+};
+
+
+/**
+ * Counters and histograms of the game thread, and export of every metric of the server
+ */
+struct Metrics {
+    std::atomic<uint64_t> connections_rejected{0}; // every room full or playing ("out")
+    std::atomic<uint64_t> resume_failed{0}; // RESUME of an unknown or expired session ("Session inconnue.")
+    std::atomic<uint64_t> events{0}; // applied by the game thread
+    std::atomic<uint64_t> players{0}; // in the rooms, at the last tick
+    std::atomic<uint64_t> rooms[NB_ROOM_STATUS] = {}; // by status, at the last tick
+    Histogram tick_duration; // events + rooms, per tick
+    Histogram fanout_duration; // replication of the rooms to their players, per tick
+    Histogram event_wait; // from a reactor to the game thread, per event
+
+    /**
+     * Prometheus text format of every metric
+     *
+     * @param tcp traffic of each reactor
+     * @param udp traffic of the UDP channel (nullptr: none)
+     * @return the text, served on /metrics
+     */
+    std::string render(const std::vector<const TrafficStats*> &tcp, const TrafficStats *udp) const;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include <iostream>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include "MetricsServer.h"
+
+
+/**
+ * Write a whole buffer on a blocking socket (gives up on error or timeout)
+ *
+ * @param socket the socket
+ * @param data bytes to write
+ */
+static void write_all(int socket, const std::string &data)
+{
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t n = send(socket, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        offset += (size_t) n;
+    }
+}
+
+
+/**
+ * Create the listening socket (loopback only) and the epoll/eventfd descriptors
+ *
+ * @param port TCP port of the HTTP server
+ * @param render builds the body of /metrics
+ */
+MetricsServer::MetricsServer(uint16_t port, RenderCallback render):
+    m_Render(render), m_Stopping(false)
+{
+    struct sockaddr_in address;
+    int opt = 1;
+
+    if ( (m_ListenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ) {
+        std::cerr << "Socket failed " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (setsockopt(m_ListenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
+        std::cerr << "setsockopt" << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // only for the monitoring of this host
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons( port );
+
+    if (bind(m_ListenFd, (struct sockaddr *)&address, sizeof(address))) {
+        std::cerr << "Bind failed " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (listen(m_ListenFd, 16) < 0) {
+        std::cerr << "Listen " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // eventfd written by stop()
+    if ( (m_EventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 ) {
+        std::cerr << "eventfd " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if ( (m_EpollFd = epoll_create1(EPOLL_CLOEXEC)) < 0 ) {
+        std::cerr << "epoll_create1 " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = m_ListenFd;
+    epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_ListenFd, &ev);
+    ev.data.fd = m_EventFd;
+    epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_EventFd, &ev);
+}
+
+
+/**
+ * Event loop, returns only after stop()
+ */
+void MetricsServer::run()
+{
+    struct epoll_event events[2];
+
+    while (true) {
+        int n = epoll_wait(m_EpollFd, events, 2, -1); // PASSIVE WAIT
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait " << __FILE__ << " " << __LINE__ << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0 ; i < n ; i++) {
+            if (events[i].data.fd == m_EventFd) {
+                if (m_Stopping.load()) return; // stop() was called
+                continue;
+            }
+
+            int socket;
+            while ( (socket = accept4(m_ListenFd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0 ) {
+                serve(socket);
+                close(socket);
+            }
+        }
+    }
+}
+
+
+/**
+ * Ask the event loop to stop (async-signal-safe)
+ */
+void MetricsServer::stop()
+{
+    m_Stopping.store(true);
+    uint64_t one = 1;
+    ssize_t r = write(m_EventFd, &one, sizeof(one));
+    (void) r;
+}
+
+
+/**
+ * Answer one scraper : the metrics on GET /metrics, 404 otherwise
+ *
+ * @param socket the accepted connection (blocking, with timeouts)
+ */
+void MetricsServer::serve(int socket)
+{
+    struct timeval timeout = {METRICS_TIMEOUT_MS / 1000, (METRICS_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // the request line is enough, the headers are read to be polite
+    std::string request;
+    char buffer[METRICS_REQUEST_SIZE];
+    while (request.size() < METRICS_REQUEST_SIZE && request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = recv(socket, buffer, sizeof(buffer) - request.size(), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        request.append(buffer, (size_t) n);
+    }
+
+    std::string body, status;
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0) {
+        status = "200 OK";
+        body = m_Render();
+    } else {
+        status = "404 Not Found";
+        body = "Only /metrics is served\n";
+    }
+
+    write_all(socket, "HTTP/1.0 " + status + "\r\n"
+                      "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                      "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                      "Connection: close\r\n\r\n" + body);
+}
+
+
+/**
+ * Close every descriptor
+ */
+MetricsServer::~MetricsServer()
+{
+    close(m_ListenFd);
+    close(m_EventFd);
+    close(m_EpollFd);
+}
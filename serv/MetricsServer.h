@@ -0,0 +1,63 @@
+#ifndef SERV_METRICSSERVER_H
+#define SERV_METRICSSERVER_H
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <functional>
+
+// Bytes of an HTTP request read at most (only the request line is used)
+#define METRICS_REQUEST_SIZE 4096
+// A scraper sending its request slower than this is dropped (milliseconds)
+#define METRICS_TIMEOUT_MS 1000
+
+
+/**
+ * Minimal HTTP server for Prometheus : GET /metrics on a local port, one request per connection.
+ * One thread, blocking on each scrape only for METRICS_TIMEOUT_MS at most, never on the game.
+ */
+class MetricsServer
+{
+public:
+
+    /** builds the body of /metrics */
+    typedef std::function<std::string()> RenderCallback;
+
+private:
+
+    int m_ListenFd;
+    int m_EpollFd;
+    int m_EventFd;
+
+    RenderCallback m_Render;
+
+    std::atomic<bool> m_Stopping;
+
+    /** answer one scraper */
+    void serve(int socket);
+
+public:
+
+    /**
+     * Create the listening socket (loopback only) and the epoll/eventfd descriptors
+     *
+     * @param port TCP port of the HTTP server
+     * @param render builds the body of /metrics
+     */
+    MetricsServer(uint16_t port, RenderCallback render);
+
+    /** Close every descriptor */
+    ~MetricsServer();
+
+    /**
+     * Event loop, returns only after stop()
+     */
+    void run();
+
+    /**
+     * Ask the event loop to stop (async-signal-safe)
+     */
+    void stop();
+};
+
+#endif
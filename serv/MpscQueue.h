@@ -0,0 +1,78 @@
+#ifndef SERV_MPSCQUEUE_H
+#define SERV_MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+
+/**
+ * Unbounded lock-free queue, many producers and a single consumer.
+ * push() is wait-free (one atomic exchange), pop() must always be called from the same thread.
+ */
+template <typename T>
+class MpscQueue
+{
+private:
+
+    struct Node {
+        std::atomic<Node*> next;
+        T value;
+
+        Node(): next(nullptr), value() {}
+        explicit Node(T &&v): next(nullptr), value(std::move(v)) {}
+    };
+
+    // last pushed node (producers side)
+    alignas(64) std::atomic<Node*> m_Head;
+
+    // already consumed node, its successor is the next to pop (consumer side)
+    alignas(64) Node *m_Tail;
+
+public:
+
+    MpscQueue(): m_Head(nullptr), m_Tail(new Node())
+    {
+        m_Head.store(m_Tail, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value)) {}
+        delete m_Tail;
+    }
+
+    /**
+     * Add a value (any thread)
+     *
+     * @param value value to move in the queue
+     */
+    void push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        Node *prev = m_Head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Take the oldest value (consumer thread only)
+     *
+     * @param value where to move the value
+     * @return false if the queue is empty
+     */
+    bool pop(T &value)
+    {
+        Node *next = m_Tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) return false;
+
+        value = std::move(next->value);
+        delete m_Tail;
+        m_Tail = next;
+        return true;
+    }
+};
+
+#endif
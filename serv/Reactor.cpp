@@ -0,0 +1,740 @@
+#include <iostream>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <tuple>
+
+#include "Protocol.h"
+#include "Reactor.h"
+
+#define MAX_EVENTS 64
+#define MAX_IOV 64
+
+// io_uring : submission queue size, and receive buffers (one per receive completion, given back once copied)
+#define IOURING_ENTRIES 256
+#define IOURING_BUFFERS 1024
+#define IOURING_BUFFER_SIZE 2048
+
+// io_uring operations, in the low byte of user_data (the socket is above)
+enum UringOperation : uint8_t { OP_ACCEPT = 1, OP_WAKEUP, OP_RECEIVE, OP_SEND };
+
+// connection ids, shared by every reactor (0 is never used)
+static std::atomic<unsigned int> next_connection_id(1);
+
+
+/**
+ * Is a client too slow to read what it is sent ?
+ * (the bulk packets still pending, and what was queued before them, are not counted)
+ *
+ * @param conn the connection
+ * @param max_output pending output bytes allowed
+ */
+static bool too_slow(const Connection &conn, size_t max_output)
+{
+    uint64_t bulk = conn.bulk_end > conn.output_written ? conn.bulk_end - conn.output_written : 0;
+    if (conn.output_size <= max_output + bulk) return false;
+    std::cerr << "Connection " << conn.id << " is too slow (" << conn.output_size << " bytes pending), closed" << std::endl;
+    return true;
+}
+
+
+/**
+ * Create the listening socket and the epoll/eventfd descriptors
+ *
+ * @param port TCP port to listen on
+ * @param cpu core to pin the event loop thread to (-1: not pinned)
+ * @param max_output pending output bytes above which a client is disconnected
+ * @param io_uring use io_uring if the kernel supports it (epoll otherwise)
+ * @param on_accept called for each new connection
+ * @param on_message called for each complete message
+ * @param on_close called when a connection is closed
+ */
+Reactor::Reactor(uint16_t port, int cpu, size_t max_output, bool io_uring, AcceptCallback on_accept, MessageCallback on_message, CloseCallback on_close):
+    m_Cpu(cpu), m_UseUring(io_uring), m_Ring(), m_MaxOutput(max_output), m_OnAccept(on_accept), m_OnMessage(on_message), m_OnClose(on_close),
+    m_Message(), m_Scratch(new char[INPUT_BUFFER_SIZE]), m_Outbox(), m_Notified(false), m_Stopping(false)
+{
+    struct sockaddr_in address;
+    int opt = 1;
+
+    // Creating socket file descriptor (IPv4 protocol, TCP : reliable & connection oriented), non-blocking
+    if ( (m_ListenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ) {
+        std::cerr << "Socket failed " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Forcefully attaching socket to the port <port>, shared with the other reactors
+    if (setsockopt(m_ListenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+        setsockopt(m_ListenFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+        std::cerr << "setsockopt" << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    address.sin_family = AF_INET; // IPv4 protocol
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons( port );
+
+    // Binds the socket to the address and port number
+    if (bind(m_ListenFd, (struct sockaddr *)&address, sizeof(address))) {
+        std::cerr << "Bind failed " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Puts the server socket in a passive mode (it waits for the client to approach the server to make a connection)
+    if (listen(m_ListenFd, SOMAXCONN) < 0) {
+        std::cerr << "Listen " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // eventfd written by stop() and by the other threads posting packets
+    if ( (m_EventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 ) {
+        std::cerr << "eventfd " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if ( (m_EpollFd = epoll_create1(EPOLL_CLOEXEC)) < 0 ) {
+        std::cerr << "epoll_create1 " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = m_ListenFd;
+    epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_ListenFd, &ev);
+    ev.data.fd = m_EventFd;
+    epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_EventFd, &ev);
+}
+
+
+/**
+ * Event loop, returns only after stop()
+ * (the calling thread is pinned to the reactor core, the io_uring ring is created by it)
+ */
+void Reactor::run()
+{
+    if (m_Cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(m_Cpu, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+            std::cerr << "Unable to pin reactor to core " << m_Cpu << std::endl;
+        }
+    }
+
+    if (m_UseUring) {
+        std::string error;
+        if ( (m_Ring = IoUring::create(IOURING_ENTRIES, IOURING_BUFFERS, IOURING_BUFFER_SIZE, error)) ) {
+            runUring();
+            return;
+        }
+        std::cerr << "Reactor: " << error << ", epoll is used" << std::endl;
+    }
+    runEpoll();
+}
+
+
+/**
+ * epoll event loop
+ */
+void Reactor::runEpoll()
+{
+    struct epoll_event events[MAX_EVENTS];
+
+    while (true) {
+        int n = epoll_wait(m_EpollFd, events, MAX_EVENTS, -1); // PASSIVE WAIT
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait " << __FILE__ << " " << __LINE__ << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0 ; i < n ; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == m_EventFd) {
+                uint64_t count;
+                ssize_t r = read(m_EventFd, &count, sizeof(count));
+                (void) r;
+                if (m_Stopping.load()) return; // stop() was called
+                drainOutbox();
+                continue;
+            }
+            if (fd == m_ListenFd) {
+                acceptAll();
+                continue;
+            }
+
+            std::map<int, Connection>::iterator it = m_Connections.find(fd);
+            if (it == m_Connections.end()) continue; // already closed in this batch
+
+            bool ok = true;
+            if (events[i].events & EPOLLOUT) {
+                ok = flushOutput(it->second);
+            }
+            if (ok && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                ok = readAll(it->second);
+            }
+            if (!ok) {
+                closeConnection(fd);
+            }
+        }
+    }
+}
+
+
+/**
+ * io_uring event loop : one system call per wake-up submits the new operations (the sends of the
+ * last batch) and waits for the next completions
+ */
+void Reactor::runUring()
+{
+    struct io_uring_cqe cqes[MAX_EVENTS];
+
+    // the accepts are completed by the kernel, no need to retry them
+    fcntl(m_ListenFd, F_SETFL, fcntl(m_ListenFd, F_GETFL) & ~O_NONBLOCK);
+    armAccept();
+    armWakeup();
+
+    while (true) {
+        int ret = m_Ring->submit(1); // PASSIVE WAIT
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            std::cerr << "io_uring_enter " << __FILE__ << " " << __LINE__ << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        unsigned n;
+        while ( (n = m_Ring->reap(cqes, MAX_EVENTS)) > 0 ) {
+            for (unsigned i = 0 ; i < n ; i++) {
+                const struct io_uring_cqe &cqe = cqes[i];
+                switch (cqe.user_data & 0xff) {
+                case OP_ACCEPT:
+                    if (cqe.res >= 0) addConnection(cqe.res);
+                    if (!(cqe.flags & IORING_CQE_F_MORE)) armAccept();
+                    break;
+                case OP_WAKEUP: {
+                    uint64_t count;
+                    ssize_t r = read(m_EventFd, &count, sizeof(count));
+                    (void) r;
+                    if (m_Stopping.load()) return; // stop() was called
+                    drainOutbox();
+                    if (!(cqe.flags & IORING_CQE_F_MORE)) armWakeup();
+                    break;
+                }
+                case OP_RECEIVE:
+                    received(cqe);
+                    break;
+                case OP_SEND:
+                    sent(cqe);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * io_uring : accept every connection of the listening socket (multishot)
+ */
+void Reactor::armAccept()
+{
+    struct io_uring_sqe *sqe = m_Ring->sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = m_ListenFd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = (uint64_t) m_ListenFd << 8 | OP_ACCEPT;
+}
+
+
+/**
+ * io_uring : wait for the eventfd (multishot poll)
+ */
+void Reactor::armWakeup()
+{
+    struct io_uring_sqe *sqe = m_Ring->sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = m_EventFd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = (uint64_t) m_EventFd << 8 | OP_WAKEUP;
+}
+
+
+/**
+ * io_uring : receive everything the client sends (multishot, into the provided buffers)
+ *
+ * @param conn the connection
+ */
+void Reactor::armReceive(Connection& conn)
+{
+    struct io_uring_sqe *sqe = m_Ring->sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = IOURING_BUFFER_GROUP;
+    sqe->user_data = (uint64_t) conn.socket << 8 | OP_RECEIVE;
+    conn.receiving = true;
+}
+
+
+/**
+ * io_uring : a receive completed (data in a provided buffer, end of file or error)
+ *
+ * @param cqe the completion
+ */
+void Reactor::received(const struct io_uring_cqe &cqe)
+{
+    int socket = (int) (cqe.user_data >> 8);
+    std::map<int, Connection>::iterator it = m_Connections.find(socket);
+    if (it == m_Connections.end()) return;
+    Connection &conn = it->second;
+
+    // out of buffers : the receive ends, it is armed again once the data of this batch is copied
+    bool ok = cqe.res > 0 || cqe.res == -ENOBUFS;
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        uint16_t id = (uint16_t) (cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (!conn.closed && cqe.res > 0) ok = append(conn, m_Ring->buffer(id), (size_t) cqe.res);
+        m_Ring->recycle(id);
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE)) conn.receiving = false;
+
+    if (conn.closed) {
+        release(socket);
+    } else if (!ok) {
+        closeConnection(socket); // end of file (res 0) or error
+    } else if (!conn.receiving) {
+        armReceive(conn);
+    }
+}
+
+
+/**
+ * io_uring : a send completed
+ *
+ * @param cqe the completion
+ */
+void Reactor::sent(const struct io_uring_cqe &cqe)
+{
+    int socket = (int) (cqe.user_data >> 8);
+    std::map<int, Connection>::iterator it = m_Connections.find(socket);
+    if (it == m_Connections.end()) return;
+    Connection &conn = it->second;
+
+    conn.want_write = false;
+    if (conn.closed) {
+        release(socket);
+        return;
+    }
+    if (cqe.res < 0) {
+        closeConnection(socket);
+        return;
+    }
+    dropOutput(conn, (size_t) cqe.res);
+    if (!flushOutput(conn)) {
+        closeConnection(socket);
+    }
+}
+
+
+/**
+ * Append received bytes to the input of a connection and dispatch messages
+ *
+ * @param conn the connection
+ * @param data the bytes
+ * @param size number of bytes
+ * @return false if the connection has to be closed
+ */
+bool Reactor::append(Connection& conn, const char *data, size_t size)
+{
+    TrafficStats::add(m_Stats.bytes_in, size);
+    while (size > 0) {
+        size_t n = conn.input.write(data, size);
+        data += n;
+        size -= n;
+        if (!dispatchAll(conn)) return false;
+    }
+    return true;
+}
+
+
+/**
+ * io_uring : close the socket of a closed connection once nothing is in flight on it
+ * (the kernel may still write into its buffers until the completions)
+ *
+ * @param socket the connection socket
+ */
+void Reactor::release(int socket)
+{
+    std::map<int, Connection>::iterator it = m_Connections.find(socket);
+    if (it == m_Connections.end() || it->second.receiving || it->second.want_write) return;
+
+    m_Connections.erase(it);
+    close(socket);
+}
+
+
+/**
+ * Ask the event loop to stop (async-signal-safe)
+ */
+void Reactor::stop()
+{
+    m_Stopping.store(true);
+    uint64_t one = 1;
+    ssize_t r = write(m_EventFd, &one, sizeof(one));
+    (void) r;
+}
+
+
+/**
+ * Queue a packet for a connection of this reactor (any thread)
+ *
+ * @param id connection id (ignored if this connection is already closed)
+ * @param socket connection socket
+ * @param packet encoded message
+ * @param bulk large packet the client reads at its pace (the objects of the world when it joins) : it is
+ *             not counted against the slow consumer cap, nor the bytes queued before it
+ */
+void Reactor::post(unsigned int id, int socket, Packet packet, bool bulk)
+{
+    m_Outbox.push(Outgoing{id, socket, std::move(packet), bulk});
+    notify();
+}
+
+
+/**
+ * Shut a connection down once the packets posted before are written (any thread)
+ *
+ * @param id connection id
+ * @param socket connection socket
+ */
+void Reactor::disconnect(unsigned int id, int socket)
+{
+    m_Outbox.push(Outgoing{id, socket, nullptr, false});
+    notify();
+}
+
+
+/**
+ * Wake up the event loop (any thread), once until it drains the outbox
+ */
+void Reactor::notify()
+{
+    if (m_Notified.exchange(true)) return;
+    uint64_t one = 1;
+    ssize_t r = write(m_EventFd, &one, sizeof(one));
+    (void) r;
+}
+
+
+/**
+ * Accept every pending connection
+ */
+void Reactor::acceptAll()
+{
+    while (true) {
+        int new_socket = accept4(m_ListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (new_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Accept " << __FILE__ << " " << __LINE__ << std::endl;
+            }
+            return;
+        }
+        addConnection(new_socket);
+    }
+}
+
+
+/**
+ * Register a new connection : refused by m_OnAccept, or read from now on
+ *
+ * @param new_socket the accepted socket
+ */
+void Reactor::addConnection(int new_socket)
+{
+    Connection &conn = m_Connections.emplace(std::piecewise_construct,
+        std::forward_as_tuple(new_socket), std::forward_as_tuple(new_socket, next_connection_id++, this)).first->second;
+    if (!m_OnAccept(conn)) {
+        m_Connections.erase(new_socket);
+        close(new_socket);
+        return;
+    }
+
+    if (m_Ring) {
+        armReceive(conn);
+    } else {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = new_socket;
+        if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, new_socket, &ev) < 0) {
+            std::cerr << "epoll_ctl " << __FILE__ << " " << __LINE__ << std::endl;
+            m_OnClose(conn);
+            m_Connections.erase(new_socket);
+            close(new_socket);
+            return;
+        }
+    }
+    TrafficStats::add(m_Stats.connections_accepted, 1);
+}
+
+
+/**
+ * Read everything available on a connection and dispatch messages
+ *
+ * @param conn the connection
+ * @return false if the connection has to be closed
+ */
+bool Reactor::readAll(Connection& conn)
+{
+    while (true) {
+        ssize_t valread = conn.input.readFrom(conn.socket);
+        if (valread < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            return false;
+        }
+        if (valread == 0) return false; // exit from client
+        TrafficStats::add(m_Stats.bytes_in, (uint64_t) valread);
+
+        if (!dispatchAll(conn)) return false;
+    }
+}
+
+
+/**
+ * Decode and dispatch every complete message buffered on a connection
+ *
+ * @param conn the connection
+ * @return false if the connection has to be closed
+ */
+bool Reactor::dispatchAll(Connection& conn)
+{
+    RingBuffer &input = conn.input;
+    size_t length, consumed;
+
+    // Split buffer in real messages (text or binary frames), decoded in place
+    while (input.size() > 0) {
+        std::string_view data = input.front();
+        length = protocol::nextMessage(data.data(), data.size(), consumed);
+        if (length == 0 && consumed == 0) {
+            if (data.size() == input.size()) break; // incomplete, wait for more bytes
+            // the message wraps around the end of the buffer
+            data = input.peek(input.size(), m_Scratch.get());
+            length = protocol::nextMessage(data.data(), data.size(), consumed);
+            if (length == 0 && consumed == 0) break;
+        }
+
+        if (length > 0) {
+            if (protocol::isBinary(data.data())) {
+                protocol::decodeBinary(data.data(), length, m_Message);
+            } else {
+                protocol::decodeText(data.substr(0, length), m_Message);
+            }
+            TrafficStats::add(m_Stats.messages[m_Message.type], 1);
+            m_OnMessage(conn, m_Message, data.substr(0, length));
+        }
+        input.consume(consumed);
+    }
+
+    // a full buffer without any complete message will never be decoded
+    return input.space() > 0;
+}
+
+
+/**
+ * Queue the posted packets on their connections and write them
+ */
+void Reactor::drainOutbox()
+{
+    Outgoing out;
+
+    m_Notified.store(false); // packets posted from now on wake the loop again
+    while (m_Outbox.pop(out)) {
+        std::map<int, Connection>::iterator it = m_Connections.find(out.socket);
+        if (it == m_Connections.end() || it->second.id != out.id || it->second.closed) continue; // already closed
+        Connection &conn = it->second;
+
+        if (conn.output.empty() && !conn.closing) m_ToFlush.push_back(conn.socket);
+        if (out.packet) {
+            conn.output_size += out.packet->size();
+            conn.output.push_back(std::move(out.packet));
+            if (out.bulk) conn.bulk_end = conn.output_written + conn.output_size;
+            if (conn.want_write && too_slow(conn, m_MaxOutput)) {
+                closeConnection(conn.socket); // still full since the last flush
+            }
+        } else {
+            conn.closing = true;
+        }
+    }
+
+    // one gather write per connection for all its packets
+    for (int socket : m_ToFlush) {
+        std::map<int, Connection>::iterator it = m_Connections.find(socket);
+        if (it == m_Connections.end() || it->second.closed || it->second.want_write) continue; // EPOLLOUT (or the send in flight) will flush it
+        if (!flushOutput(it->second)) {
+            closeConnection(socket);
+        }
+    }
+    m_ToFlush.clear();
+}
+
+
+/**
+ * Write as much pending output as the socket accepts
+ * (io_uring : prepare one send of the pending output, submitted with the others of this wake-up)
+ *
+ * @param conn the connection
+ * @return false if the connection has to be closed
+ */
+bool Reactor::flushOutput(Connection& conn)
+{
+    struct iovec iov[MAX_IOV];
+    struct msghdr msg = {};
+
+    while (!conn.output.empty() && !(m_Ring && conn.want_write)) {
+        // the io_uring send reads its iovecs after this call, they live in the connection
+        struct iovec *vec = iov;
+        if (m_Ring) {
+            conn.send_iov.resize(MAX_IOV);
+            vec = conn.send_iov.data();
+        }
+
+        size_t nb_iov = 0, offset = conn.output_offset;
+        for (std::deque<Packet>::iterator it = conn.output.begin() ; it != conn.output.end() && nb_iov < MAX_IOV ; ++it) {
+            vec[nb_iov].iov_base = (void *) ((*it)->data() + offset);
+            vec[nb_iov].iov_len = (*it)->size() - offset;
+            offset = 0;
+            nb_iov++;
+        }
+
+        if (m_Ring) {
+            conn.send_msg = msghdr();
+            conn.send_msg.msg_iov = vec;
+            conn.send_msg.msg_iovlen = nb_iov;
+
+            struct io_uring_sqe *sqe = m_Ring->sqe();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = conn.socket;
+            sqe->addr = (uint64_t) (uintptr_t) &conn.send_msg;
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL;
+            sqe->user_data = (uint64_t) conn.socket << 8 | OP_SEND;
+            conn.want_write = true; // the rest is sent on its completion
+            break;
+        }
+
+        msg.msg_iov = vec;
+        msg.msg_iovlen = nb_iov;
+
+        // like writev, but without SIGPIPE if the client is gone
+        ssize_t written = sendmsg(conn.socket, &msg, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        dropOutput(conn, (size_t) written);
+    }
+
+    if (too_slow(conn, m_MaxOutput)) return false;
+
+    if (!m_Ring) watchWrite(conn, !conn.output.empty());
+    if (conn.output.empty() && conn.closing) {
+        shutdown(conn.socket, SHUT_RDWR); // the end of file is read next and closes the connection
+    }
+    return true;
+}
+
+
+/**
+ * Drop the first bytes of the output of a connection (written)
+ *
+ * @param conn the connection
+ * @param n number of bytes written
+ */
+void Reactor::dropOutput(Connection& conn, size_t n)
+{
+    TrafficStats::add(m_Stats.bytes_out, n);
+    conn.output_size -= n;
+    conn.output_written += n;
+    while (n > 0) {
+        size_t left = conn.output.front()->size() - conn.output_offset;
+        if (n < left) {
+            conn.output_offset += n;
+            break;
+        }
+        n -= left;
+        conn.output_offset = 0;
+        conn.output.pop_front();
+    }
+}
+
+
+/**
+ * Register or unregister EPOLLOUT for a connection
+ *
+ * @param conn the connection
+ * @param enable wait for the socket to be writable
+ */
+void Reactor::watchWrite(Connection& conn, bool enable)
+{
+    if (conn.want_write == enable) return;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | (enable ? (uint32_t) EPOLLOUT : 0U);
+    ev.data.fd = conn.socket;
+    epoll_ctl(m_EpollFd, EPOLL_CTL_MOD, conn.socket, &ev);
+    conn.want_write = enable;
+}
+
+
+/**
+ * Unregister, notify and close a connection
+ *
+ * @param socket the connection socket
+ */
+void Reactor::closeConnection(int socket)
+{
+    std::map<int, Connection>::iterator it = m_Connections.find(socket);
+    if (it == m_Connections.end() || it->second.closed) return;
+
+    m_OnClose(it->second);
+    TrafficStats::add(m_Stats.connections_closed, 1);
+
+    if (m_Ring) {
+        // ends the receive and the send in flight, their completions release the socket
+        it->second.closed = true;
+        shutdown(socket, SHUT_RDWR);
+        release(socket);
+        return;
+    }
+
+    epoll_ctl(m_EpollFd, EPOLL_CTL_DEL, socket, nullptr);
+    m_Connections.erase(it);
+    close(socket);
+}
+
+
+/**
+ * Close every descriptor (listening socket, clients, epoll, eventfd)
+ */
+Reactor::~Reactor()
+{
+    m_Ring.reset(); // cancels the operations in flight before their buffers are freed
+    for (auto &i : m_Connections) {
+        close(i.first);
+    }
+    m_Connections.clear();
+    close(m_ListenFd);
+    close(m_EventFd);
+    close(m_EpollFd);
+}
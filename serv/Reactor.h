@@ -0,0 +1,253 @@
+#ifndef SERV_REACTOR_H
+#define SERV_REACTOR_H
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <map>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "Protocol.h"
+#include "RingBuffer.h"
+#include "MpscQueue.h"
+#include "Metrics.h"
+#include "IoUring.h"
+
+// Bytes buffered per connection, a longer message closes the connection
+#define INPUT_BUFFER_SIZE 8192UL
+
+class Reactor;
+
+/**
+ * Encoded message, shared by every connection it is sent to
+ */
+typedef std::shared_ptr<const std::string> Packet;
+
+
+/**
+ * State of one client connection, owned by the reactor
+ */
+struct Connection {
+    int socket;
+    unsigned int id; // unique in the process, a socket number can be reused
+    Reactor *reactor; // owner
+    RingBuffer input; // bytes received but not yet delimited
+
+    std::deque<Packet> output; // packets not (fully) written yet
+    size_t output_offset; // bytes of output.front() already written
+    size_t output_size; // bytes waiting in output
+    uint64_t output_written; // bytes written since the connection
+    uint64_t bulk_end; // the stream up to this byte is not counted against the slow consumer cap (see Reactor::post)
+    bool want_write; // EPOLLOUT registered (socket buffer was full), io_uring : a send is in flight
+    bool closing; // shut down once output is flushed
+
+    // io_uring only : the operations in flight, and the send they read (kept until its completion)
+    bool receiving; // multishot receive armed
+    bool closed; // closed, the socket is released once nothing is in flight
+    struct msghdr send_msg;
+    std::vector<struct iovec> send_iov;
+
+    Connection(int socket, unsigned int id, Reactor *reactor):
+        socket(socket), id(id), reactor(reactor), input(INPUT_BUFFER_SIZE),
+        output(), output_offset(0), output_size(0), output_written(0), bulk_end(0), want_write(false), closing(false),
+        receiving(false), closed(false), send_msg(), send_iov() {}
+};
+
+
+/**
+ * Single-threaded, non-blocking event loop.
+ * It owns its listening socket, every client socket accepted on it and an eventfd used to wake it up.
+ * Several reactors can listen on the same port (SO_REUSEPORT), the kernel balances the connections.
+ * Other threads never write on a socket: they post packets, written by the reactor when the socket is ready.
+ *
+ * Two backends : epoll (readiness, one system call per read or write) or, if asked and supported, io_uring
+ * (completions : multishot accept and receive into provided buffers, the sends of a wake-up submitted together).
+ */
+class Reactor
+{
+public:
+
+    /** called for each new connection, return false to refuse it */
+    typedef std::function<bool(Connection&)> AcceptCallback;
+
+    /** called for each complete message, already decoded (type MSG_UNKNOWN if malformed), with its bytes (text without delimiter, or binary frame) */
+    typedef std::function<void(Connection&, const protocol::Message&, std::string_view)> MessageCallback;
+
+    /** called once when a connection is closed (by peer or by shutdown) */
+    typedef std::function<void(Connection&)> CloseCallback;
+
+private:
+
+    // packet posted by another thread (no packet: disconnect)
+    struct Outgoing {
+        unsigned int id;
+        int socket;
+        Packet packet;
+        bool bulk;
+    };
+
+    int m_EpollFd;
+    int m_ListenFd;
+    int m_EventFd;
+
+    // core the event loop thread is pinned to (-1: not pinned)
+    int m_Cpu;
+
+    // io_uring asked, and the ring once created by run() (nullptr: epoll)
+    bool m_UseUring;
+    std::unique_ptr<IoUring> m_Ring;
+
+    // a connection with more pending output bytes is closed (slow consumer)
+    size_t m_MaxOutput;
+
+    // client connections (key: socket)
+    std::map<int, Connection> m_Connections;
+
+    AcceptCallback m_OnAccept;
+    MessageCallback m_OnMessage;
+    CloseCallback m_OnClose;
+
+    // reused for every decoded message (no allocation per message)
+    protocol::Message m_Message;
+
+    // a message wrapping around the end of a ring buffer is copied here
+    std::unique_ptr<char[]> m_Scratch;
+
+    // posted by the other threads, m_Notified avoids a write on the eventfd per packet
+    MpscQueue<Outgoing> m_Outbox;
+    std::atomic<bool> m_Notified;
+    std::atomic<bool> m_Stopping;
+
+    // connections with new output, flushed once per wake-up
+    std::vector<int> m_ToFlush;
+
+    // written by the event loop thread only
+    TrafficStats m_Stats;
+
+    /** accept every pending connection */
+    void acceptAll();
+
+    /** register a new connection (refused by m_OnAccept, or read from now on) */
+    void addConnection(int socket);
+
+    /** epoll event loop */
+    void runEpoll();
+
+    /** io_uring event loop */
+    void runUring();
+
+    /** io_uring : arm the multishot accept, the eventfd poll or the multishot receive of a connection */
+    void armAccept();
+    void armWakeup();
+    void armReceive(Connection& conn);
+
+    /** io_uring : a receive completed (data in a provided buffer, end of file or error) */
+    void received(const struct io_uring_cqe &cqe);
+
+    /** io_uring : a send completed */
+    void sent(const struct io_uring_cqe &cqe);
+
+    /**
+     * append received bytes to the input of a connection and dispatch messages
+     * @return false if the connection has to be closed
+     */
+    bool append(Connection& conn, const char *data, size_t size);
+
+    /** drop the first n bytes of the output of a connection (written) */
+    void dropOutput(Connection& conn, size_t n);
+
+    /** io_uring : close the socket of a closed connection once nothing is in flight on it */
+    void release(int socket);
+
+    /**
+     * read everything available on a connection and dispatch messages
+     * @return false if the connection has to be closed
+     */
+    bool readAll(Connection& conn);
+
+    /**
+     * decode and dispatch every complete message buffered on a connection
+     * @return false if the connection has to be closed
+     */
+    bool dispatchAll(Connection& conn);
+
+    /** queue the posted packets on their connections and write them */
+    void drainOutbox();
+
+    /**
+     * write as much pending output as the socket accepts
+     * @return false if the connection has to be closed
+     */
+    bool flushOutput(Connection& conn);
+
+    /** register or unregister EPOLLOUT for a connection */
+    void watchWrite(Connection& conn, bool enable);
+
+    /** wake up the event loop (any thread) */
+    void notify();
+
+    /** unregister, notify and close a connection */
+    void closeConnection(int socket);
+
+public:
+
+    /**
+     * Create the listening socket and the epoll/eventfd descriptors
+     *
+     * @param port TCP port to listen on
+     * @param cpu core to pin the event loop thread to (-1: not pinned)
+     * @param max_output pending output bytes above which a client is disconnected
+     * @param io_uring use io_uring if the kernel supports it (epoll otherwise)
+     * @param on_accept called for each new connection
+     * @param on_message called for each complete message
+     * @param on_close called when a connection is closed
+     */
+    Reactor(uint16_t port, int cpu, size_t max_output, bool io_uring, AcceptCallback on_accept, MessageCallback on_message, CloseCallback on_close);
+
+    /** Close every descriptor (listening socket, clients, epoll, eventfd) */
+    ~Reactor();
+
+    /**
+     * Event loop, returns only after stop()
+     * (the calling thread is pinned to the reactor core, the io_uring ring is created by it)
+     */
+    void run();
+
+    /**
+     * Ask the event loop to stop (async-signal-safe)
+     */
+    void stop();
+
+    /**
+     * Queue a packet for a connection of this reactor (any thread)
+     *
+     * @param id connection id (ignored if this connection is already closed)
+     * @param socket connection socket
+     * @param packet encoded message
+     * @param bulk large packet the client reads at its pace (the objects of the world when it joins) : it is
+     *             not counted against the slow consumer cap, nor the bytes queued before it
+     */
+    void post(unsigned int id, int socket, Packet packet, bool bulk = false);
+
+    /**
+     * Shut a connection down once the packets posted before are written (any thread)
+     *
+     * @param id connection id
+     * @param socket connection socket
+     */
+    void disconnect(unsigned int id, int socket);
+
+    /**
+     * Traffic of this reactor (any thread)
+     */
+    const TrafficStats& stats() const { return m_Stats; }
+};
+
+#endif
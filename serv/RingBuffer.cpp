@@ -0,0 +1,101 @@
+#include <string.h>
+#include <algorithm>
+#include <sys/uio.h>
+
+#include "RingBuffer.h"
+
+
+/**
+ * @param capacity size in bytes, rounded up to a power of two
+ */
+RingBuffer::RingBuffer(size_t capacity):
+    m_Capacity(1), m_Head(0), m_Tail(0)
+{
+    while (m_Capacity < capacity) m_Capacity <<= 1;
+    m_Data.reset(new char[m_Capacity]);
+}
+
+
+/**
+ * Read from a file descriptor into the free space (one readv call)
+ *
+ * @param fd file descriptor
+ * @return like read(), 0 means end of file
+ */
+ssize_t RingBuffer::readFrom(int fd)
+{
+    size_t tail = m_Tail & (m_Capacity - 1);
+    size_t free_bytes = space();
+    struct iovec iov[2];
+    int nb_iov = 1;
+
+    // free space is [tail, end of storage[ then [0, head[
+    iov[0].iov_base = m_Data.get() + tail;
+    iov[0].iov_len = std::min(free_bytes, m_Capacity - tail);
+    if (iov[0].iov_len < free_bytes) {
+        iov[1].iov_base = m_Data.get();
+        iov[1].iov_len = free_bytes - iov[0].iov_len;
+        nb_iov = 2;
+    }
+
+    ssize_t n = readv(fd, iov, nb_iov);
+    if (n > 0) m_Tail += (size_t) n;
+    return n;
+}
+
+
+/**
+ * Append bytes
+ *
+ * @param data bytes to copy
+ * @param size number of bytes
+ * @return number of bytes copied (less than size if the buffer is full)
+ */
+size_t RingBuffer::write(const char *data, size_t size)
+{
+    size = std::min(size, space());
+    size_t tail = m_Tail & (m_Capacity - 1);
+    size_t first = std::min(size, m_Capacity - tail);
+    memcpy(m_Data.get() + tail, data, first);
+    memcpy(m_Data.get(), data + first, size - first);
+    m_Tail += size;
+    return size;
+}
+
+
+/**
+ * Stored bytes up to the end of the storage (all of them if they do not wrap)
+ */
+std::string_view RingBuffer::front() const
+{
+    size_t head = m_Head & (m_Capacity - 1);
+    return std::string_view(m_Data.get() + head, std::min(size(), m_Capacity - head));
+}
+
+
+/**
+ * First n stored bytes as one view, copied in scratch only if they wrap
+ *
+ * @param n number of bytes (<= size())
+ * @param scratch buffer of at least n bytes
+ */
+std::string_view RingBuffer::peek(size_t n, char *scratch) const
+{
+    size_t head = m_Head & (m_Capacity - 1);
+    if (head + n <= m_Capacity) {
+        return std::string_view(m_Data.get() + head, n);
+    }
+    size_t first = m_Capacity - head;
+    memcpy(scratch, m_Data.get() + head, first);
+    memcpy(scratch + first, m_Data.get(), n - first);
+    return std::string_view(scratch, n);
+}
+
+
+/**
+ * Drop the first n stored bytes
+ */
+void RingBuffer::consume(size_t n)
+{
+    m_Head += std::min(n, size());
+}
@@ -0,0 +1,75 @@
+#ifndef SERV_RINGBUFFER_H
+#define SERV_RINGBUFFER_H
+
+#include <sys/types.h>
+#include <stddef.h>
+#include <memory>
+#include <string_view>
+
+
+/**
+ * Fixed-size byte ring buffer, filled from a socket and read as string_views.
+ * Nothing is allocated after construction.
+ */
+class RingBuffer
+{
+private:
+
+    std::unique_ptr<char[]> m_Data;
+    size_t m_Capacity; // power of two
+    size_t m_Head;     // read counter (never wraps, masked on access)
+    size_t m_Tail;     // write counter (never wraps, masked on access)
+
+public:
+
+    /**
+     * @param capacity size in bytes, rounded up to a power of two
+     */
+    explicit RingBuffer(size_t capacity);
+
+    /** number of bytes stored */
+    size_t size() const { return m_Tail - m_Head; }
+
+    /** number of free bytes */
+    size_t space() const { return m_Capacity - size(); }
+
+    /** capacity in bytes */
+    size_t capacity() const { return m_Capacity; }
+
+    /**
+     * Read from a file descriptor into the free space (one readv call)
+     *
+     * @param fd file descriptor
+     * @return like read(), 0 means end of file
+     */
+    ssize_t readFrom(int fd);
+
+    /**
+     * Append bytes
+     *
+     * @param data bytes to copy
+     * @param size number of bytes
+     * @return number of bytes copied (less than size if the buffer is full)
+     */
+    size_t write(const char *data, size_t size);
+
+    /**
+     * Stored bytes up to the end of the storage (all of them if they do not wrap)
+     */
+    std::string_view front() const;
+
+    /**
+     * First n stored bytes as one view, copied in scratch only if they wrap
+     *
+     * @param n number of bytes (<= size())
+     * @param scratch buffer of at least n bytes
+     */
+    std::string_view peek(size_t n, char *scratch) const;
+
+    /**
+     * Drop the first n stored bytes
+     */
+    void consume(size_t n);
+};
+
+#endif
@@ -0,0 +1,674 @@
+#include <math.h>
+#include <iostream>
+#include <algorithm>
+#include <memory>
+
+#include "Room.h"
+
+
+/**
+ * @param id room number (for the logs)
+ * @param config room description
+ * @param udp unreliable channel of the clients (nullptr: TCP only)
+ * @param tokens source of the tokens of the players
+ */
+Room::Room(unsigned int id, std::shared_ptr<const RoomConfig> config, UdpChannel *udp, TokenSource tokens):
+    m_Id(id), m_Udp(udp), m_Tokens(tokens), m_Now(std::chrono::steady_clock::now()), m_Config(), m_NextConfig(config), m_Reconfigure(true),
+    m_Clients(), m_ClientToRemove(), m_NewPlayerHasJoin(), m_PlayerFindObject(), m_Suspended(0), m_Released(),
+    m_Interest(config->interest_radius), m_InterestEvents(), m_Frame(), m_Names(),
+    m_PlayerPositions(m_Interest.leaveRadius()), m_ObjectPositions(config->found_radius),
+    m_Status(WAITING), m_Leader(-1)
+{
+    applyConfig();
+}
+
+
+/**
+ * Move the game to another status, only from the expected one
+ *
+ * @param from expected status
+ * @param to new status
+ * @return false if the game was not in the expected status (nothing changed)
+ */
+bool Room::transition(Status from, Status to)
+{
+    return m_Status.compare_exchange_strong(from, to, std::memory_order_acq_rel);
+}
+
+
+/**
+ * Change the description of the room, once the players in it have left
+ * (a game in progress is not changed)
+ *
+ * @param config new description (nullptr: close the room)
+ */
+void Room::configure(std::shared_ptr<const RoomConfig> config)
+{
+    m_NextConfig = config;
+    m_Reconfigure = true;
+    if (m_Clients.empty()) applyConfig();
+}
+
+
+/**
+ * Use m_NextConfig (the room has to be empty)
+ */
+void Room::applyConfig()
+{
+    if (!m_NextConfig) return; // closed
+    if (m_Config) std::cout << "Room " << m_Id << " reloaded [" << m_NextConfig->name << "]" << std::endl;
+
+    m_Config = m_NextConfig;
+    m_NextConfig = nullptr;
+    m_Reconfigure = false;
+
+    m_Interest = InterestManager(m_Config->interest_radius);
+    m_PlayerPositions = SpatialHash(m_Interest.leaveRadius());
+    m_ObjectPositions = SpatialHash(m_Config->found_radius);
+
+    // objects never move
+    for (unsigned int i = 0 ; i < m_Config->objects.size() ; i++) {
+        m_ObjectPositions.set(i+1, m_Config->objects.position(i));
+    }
+}
+
+
+/**
+ * Can a new player join the room ?
+ * (not full and no game in progress, a room never has more players than a snapshot can hold)
+ */
+bool Room::isOpen() const
+{
+    return !m_Reconfigure && m_Clients.size() < std::min((size_t) m_Config->max_player, snapshot::MAX_ENTITIES) && status() == WAITING;
+}
+
+
+/**
+ * Has a player of the room sent his name ?
+ *
+ * @param id player id
+ */
+bool Room::registered(unsigned int id) const
+{
+    std::map<unsigned int, Player>::const_iterator it = m_Clients.find(id);
+    return it != m_Clients.end() && it->second.is_registred;
+}
+
+
+/**
+ * Send a message to a player, with the protocol he has negotiated
+ * (queued on his connection, never blocks)
+ *
+ * @param p the player
+ * @param msg the message
+ */
+void Room::send(Player &p, const protocol::Message &msg)
+{
+    deliver(p, std::make_shared<const std::string>(protocol::encode(msg, p.protocol)), 1);
+}
+
+
+/**
+ * Post a packet on the connection of a player (if he is connected), and keep it for a resume
+ * (every message sent on TCP goes through here, except the snapshots)
+ *
+ * @param p the player
+ * @param packet encoded messages
+ * @param count number of messages in the packet
+ * @param bulk not counted against the slow consumer cap (see Reactor::post)
+ */
+void Room::deliver(Player &p, const Packet &packet, uint32_t count, bool bulk)
+{
+    if (p.session != 0) {
+        p.history.push_back(SentPacket{p.sent + 1, packet});
+        if (p.history.size() > SESSION_HISTORY) p.history.pop_front();
+    }
+    p.sent += count;
+    if (p.connection != 0) p.reactor->post(p.connection, p.socket, packet, bulk);
+}
+
+
+/**
+ * Send a message to every player of the room, encoded once per protocol version
+ *
+ * @param msg the message
+ * @param except id of a player who does not receive it (0: nobody)
+ * @param snapshots false if the players receiving snapshots already know it
+ */
+void Room::broadcast(const protocol::Message &msg, unsigned int except, bool snapshots)
+{
+    Packet packets[protocol::VERSION + 1];
+
+    for (auto &i : m_Clients) {
+        if (i.second.id == except) continue;
+        if (!snapshots && i.second.protocol >= protocol::SNAPSHOT_VERSION) continue;
+        Packet &packet = packets[i.second.protocol];
+        if (!packet) packet = std::make_shared<const std::string>(protocol::encode(msg, i.second.protocol));
+        deliver(i.second, packet, 1);
+    }
+}
+
+
+/**
+ * Send a message to a player on his UDP channel if it is bound (and the message small enough), on TCP otherwise
+ *
+ * @param p the player
+ * @param msg the message
+ */
+void Room::sendUnreliable(Player &p, const protocol::Message &msg)
+{
+    if (p.udp_bound) {
+        std::string datagram = protocol::encodeDatagram(p.udp_token, p.udp_sent + 1, msg);
+        if (datagram.size() <= protocol::MAX_DATAGRAM) {
+            p.udp_sent++;
+            m_Udp->post(p.udp_address, std::make_shared<const std::string>(std::move(datagram)));
+            return;
+        }
+    }
+    // not kept for a resume (a snapshot is replaced by the next one)
+    if (p.connection != 0) p.reactor->post(p.connection, p.socket, std::make_shared<const std::string>(protocol::encode(msg, p.protocol)));
+}
+
+
+/**
+ * Send the moves of the players to the players who see them
+ * (text clients do not know these messages, they get nothing, and the moves are in the snapshots since SNAPSHOT_VERSION)
+ */
+void Room::replicatePositions()
+{
+    static const protocol::MessageType types[] = {protocol::MSG_PLAYERENTER, protocol::MSG_PLAYERMOVE, protocol::MSG_PLAYEREXIT};
+    protocol::Message msg = {protocol::MSG_UNKNOWN, 0, 0, 0, {}, {}, ""};
+    Packet packet;
+    uint8_t version = 0;
+
+    m_Interest.update(m_PlayerPositions, m_InterestEvents);
+
+    for (const InterestManager::Event &e : m_InterestEvents) {
+        std::map<unsigned int, Player>::iterator to = m_Clients.find(e.to);
+        if (to == m_Clients.end() || to->second.protocol == 0 || to->second.protocol >= protocol::SNAPSHOT_VERSION || to->second.connection == 0) continue;
+
+        // same message as the previous one (MOVE of a player to each player around) : same packet
+        if (!packet || msg.type != types[e.type] || msg.id != e.about || version != to->second.protocol) {
+            msg.type = types[e.type];
+            msg.id = e.about;
+            m_PlayerPositions.get(e.about, msg.pos);
+            version = to->second.protocol;
+            packet = std::make_shared<const std::string>(protocol::encode(msg, version));
+        }
+        to->second.reactor->post(to->second.connection, to->second.socket, packet);
+    }
+}
+
+
+/**
+ * Send to each player receiving snapshots what changed since the last one he acknowledged
+ * (nothing if the room did not change for him since the last snapshot he acknowledged)
+ */
+void Room::replicateSnapshots()
+{
+    protocol::Message msg = {protocol::MSG_SNAPSHOT, 0, 0, 0, {}, {}, ""};
+    const snapshot::View none = {0, nullptr, {}};
+    float pos[3];
+
+    // state of every player, m_Clients is sorted by id (a new frame only if something changed)
+    std::vector<snapshot::State> states;
+    for (auto &i : m_Clients) {
+        if (!i.second.is_registred) continue;
+        snapshot::State state = {i.second.id, {0, 0, 0}, 0, i.second.nb_objects_found};
+        if (m_PlayerPositions.get(i.second.id, pos)) {
+            for (int j = 0 ; j < 3 ; j++) state.pos[j] = snapshot::quantizePosition(pos[j]);
+            state.azimut = snapshot::quantizeAzimut(i.second.azimut);
+        }
+        states.push_back(state);
+    }
+    if (!m_Frame || *m_Frame != states) m_Frame = std::make_shared<const std::vector<snapshot::State> >(std::move(states));
+
+    for (auto &i : m_Clients) {
+        Player &p = i.second;
+        if (!p.is_registred || p.protocol < protocol::SNAPSHOT_VERSION || p.connection == 0) continue;
+
+        // what he can see : himself without position (he knows it), the others inside his area of interest
+        snapshot::View view = {0, m_Frame, std::vector<bool>(m_Frame->size())};
+        for (size_t k = 0 ; k < m_Frame->size() ; k++) {
+            unsigned int other = (*m_Frame)[k].id;
+            view.visible[k] = other != p.id && m_Interest.sees(p.id, other);
+        }
+
+        // delta against the last snapshot he acknowledged, if it is still known
+        const snapshot::View *baseline = &none;
+        if (!p.snapshots.empty() && p.snapshots.front().seq == p.snapshot_acked) baseline = &p.snapshots.front();
+
+        msg.text.clear();
+        size_t changes = snapshot::encodeDelta(*baseline, view, m_Names, msg.text);
+
+        // he already has it (sent again until acknowledged : the last snapshot before the room goes quiet may be lost)
+        if (baseline != &none && changes == 0) continue;
+
+        view.seq = ++p.snapshot_seq;
+        msg.id = view.seq;
+        msg.value = baseline->seq;
+        sendUnreliable(p, msg);
+
+        p.snapshots.push_back(std::move(view));
+        if (p.snapshots.size() > snapshot::HISTORY) p.snapshots.pop_front(); // too late to ack the oldest ones
+    }
+}
+
+
+/**
+ * Close all clients connections, after the messages already sent
+ * (the reactor shuts the socket down and releases it itself)
+ */
+void Room::closeConnections()
+{
+    for (auto &i : m_Clients) {
+        if (i.second.connection != 0) {
+            i.second.reactor->disconnect(i.second.connection, i.second.socket);
+        } else {
+            m_Released.push_back(i.second.id); // no connection to close, the lobby is told now
+        }
+    }
+    m_Clients.clear(); // clear player list
+    m_Suspended = 0;
+    m_ClientToRemove.clear();
+    m_Names.clear();
+    m_Frame = nullptr;
+    m_PlayerPositions.clear();
+    m_Interest.clear();
+}
+
+
+/**
+ * Tell to each client that a player win, and reload data
+ *
+ * @param winner the winner
+ */
+void Room::end(const Player &winner)
+{
+    transition(IN_PROGRESS, COMPLETED);
+
+    // Announce
+    protocol::Message msg = {protocol::MSG_WIN, winner.id, 0, 0, {}, {}, ""};
+
+    // Server
+    std::cout << "[" << m_Config->name << "] " << protocol::encode(msg, 0) << std::endl;
+
+    // for each player
+    broadcast(msg);
+
+    closeConnections();
+
+    m_Leader.store(-1, std::memory_order_release);
+    transition(COMPLETED, WAITING);
+}
+
+
+/**
+ * A new player enters the room
+ *
+ * @param id player id
+ * @param socket player connection
+ * @param reactor owner of the connection
+ */
+void Room::join(unsigned int id, int socket, Reactor *reactor)
+{
+    if (m_Clients.empty()) {
+        m_Leader.store((int) id, std::memory_order_release); // set leader
+    }
+
+    std::cout << "Client " << id << " connected to room " << m_Id << " [" << m_Config->name << "]" << std::endl;
+
+    m_Clients[id] = {id, "", 0, false, 0, id, socket, reactor, 0, 0, 0, {}, 0, false, {}, 0, 0, 0, 0, {}, {}};
+}
+
+
+/**
+ * A player resumes his session on a new connection : he is sent again what he missed
+ * (his previous connection is closed if the server did not notice it was lost)
+ *
+ * @param id player id
+ * @param session resume token
+ * @param received messages he received on his previous connections
+ * @param connection id of the new connection
+ * @param socket the new connection
+ * @param reactor owner of the connection
+ * @return false if the session is unknown or if the messages he missed are no longer known
+ */
+bool Room::resume(unsigned int id, uint64_t session, uint32_t received, unsigned int connection, int socket, Reactor *reactor)
+{
+    std::map<unsigned int, Player>::iterator it = m_Clients.find(id);
+    if (it == m_Clients.end() || it->second.session == 0 || it->second.session != session) return false;
+    Player &player = it->second;
+
+    // the missed messages start a packet still in the history
+    if (received > player.sent) return false;
+    std::deque<SentPacket>::const_iterator missed = player.history.end();
+    if (received < player.sent) {
+        missed = std::find_if(player.history.begin(), player.history.end(), [received](const SentPacket &s) { return s.seq == received + 1; });
+        if (missed == player.history.end()) return false;
+    }
+
+    if (player.connection != 0) {
+        player.reactor->disconnect(player.connection, player.socket);
+    } else {
+        m_Suspended--;
+    }
+    player.connection = connection;
+    player.socket = socket;
+    player.reactor = reactor;
+
+    // Send the answer and the missed messages (the packets kept, not copied), written together by the reactor
+    protocol::Message answer = {protocol::MSG_RESUME, id, player.sent, 0, {}, {}, ""};
+    answer.session = session;
+    reactor->post(connection, socket, std::make_shared<const std::string>(protocol::encode(answer, player.protocol)));
+    for ( ; missed != player.history.end() ; ++missed) {
+        reactor->post(connection, socket, missed->packet, true);
+    }
+
+    std::cout << "Client " << id << " resumed his session (" << player.sent - received << " message(s) sent again)" << std::endl;
+    return true;
+}
+
+
+/**
+ * A player of the room sent a message (ignored if he is no longer in the room)
+ *
+ * @param id player id
+ * @param msg the decoded message (MSG_UNKNOWN if malformed)
+ */
+void Room::message(unsigned int id, const protocol::Message &msg)
+{
+    std::map<unsigned int, Player>::iterator me = m_Clients.find(id);
+    if (me == m_Clients.end()) {
+        // kicked (end of game), the reactor will close the socket
+        return;
+    }
+    Player &player = me->second;
+
+    if (msg.type == protocol::MSG_USERNAME && !player.is_registred) {
+        std::cout << "Received username: " << msg.text << std::endl;
+
+        // binary protocol if the client knows it
+        uint8_t version = (uint8_t) std::min(msg.value, (uint32_t) protocol::VERSION);
+
+        // overwrite
+        player.name = msg.text;
+        player.is_registred = true;
+        m_Names[id] = player.name;
+
+        // token of the UDP channel : random, and the player id so that it is unique
+        if (m_Udp != nullptr && version >= protocol::UDP_VERSION) {
+            player.udp_token = (m_Tokens() & 0xFFFFFFFF00000000ULL) | id;
+        }
+        // resume token : random (checked with the player id)
+        if (version >= protocol::RESUME_VERSION && m_Config->resume_grace > 0) {
+            player.session = m_Tokens() | 1;
+        }
+
+        /* Send data, written together by the reactor */
+        // Send client id (always in text, it tells the client which protocol is used next)
+        protocol::Message answer = {protocol::MSG_ID, id, version, 0, {}, {}, ""};
+        answer.token = player.udp_token;
+        answer.session = player.session;
+        deliver(player, std::make_shared<const std::string>(protocol::encode(answer, 0)), 1);
+        player.protocol = version;
+
+        // Send every objects : the packet encoded for the first player of this version, not copied (several MB in
+        // a large world, read by the client at its pace)
+        const Packet &objects = m_Config->objectsPacket(version);
+        if (!objects->empty()) deliver(player, objects, (uint32_t) m_Config->objects.size(), true);
+
+        // Send player list (in the first snapshot since SNAPSHOT_VERSION)
+        std::string players;
+        uint32_t count = 0;
+        for (std::map<unsigned int, Player>::iterator it=m_Clients.begin() ; it != m_Clients.end() && version < protocol::SNAPSHOT_VERSION ; ++it) {
+            answer = {protocol::MSG_PLAYER, it->second.id, it->second.nb_objects_found, 0, {}, {}, it->second.name};
+            players += protocol::encode(answer, version);
+            count++;
+        }
+        if (count > 0) deliver(player, std::make_shared<const std::string>(std::move(players)), count);
+
+        m_NewPlayerHasJoin.push_back(id); // add to queue
+    }
+    else if (msg.type == protocol::MSG_POSITION && player.is_registred && status() == IN_PROGRESS) {
+        // finite and inside the world (see protocol::MAX_COORDINATE), malformed otherwise
+        m_PlayerPositions.set(id, msg.pos);
+        m_Interest.moved(id);
+        player.azimut = msg.dir[0];
+    }
+    else if (msg.type == protocol::MSG_SNAPSHOTACK && player.is_registred && player.protocol >= protocol::SNAPSHOT_VERSION) {
+        // acks can be late : only a newer snapshot still in the history becomes the baseline
+        if (msg.id > player.snapshot_acked && msg.id <= player.snapshot_seq) {
+            player.snapshot_acked = msg.id;
+            while (!player.snapshots.empty() && player.snapshots.front().seq < msg.id) player.snapshots.pop_front();
+        }
+    }
+    else if (msg.type == protocol::MSG_ASKSTART && player.is_registred && status() == WAITING) {
+        if ((int) id == leader() && transition(WAITING, STARTING)) {
+            std::cout << "Leader asks to start room " << m_Id << std::endl;
+        } else {
+            protocol::Message answer = {protocol::MSG_TEXT, 0, 0, 0, {}, {}, "Vous n'êtes pas le leader, vous ne pouvez pas lancer la partie."};
+            send(player, answer);
+        }
+    }
+    else if (msg.type == protocol::MSG_FOUND && player.is_registred && status() == IN_PROGRESS) {
+        unsigned int object_id = msg.id;
+        object_id--; // start at 0 in list !
+
+        // check object exist
+        if (object_id < m_Config->objects.size()) {
+            // check the player is close to it (from his last position)
+            float player_pos[3];
+            if (m_PlayerPositions.get(id, player_pos) && m_ObjectPositions.isWithin(msg.id, player_pos, m_Config->found_radius)) {
+                // overwrite
+                player.nb_objects_found++;
+
+                m_PlayerFindObject.push_back( std::make_pair(id, object_id)); // add to queue
+            } else {
+                std::cout << "Client (id: " << id << ") is too far to find object " << msg.id << std::endl;
+            }
+        }
+    }
+    else {
+        // default
+        std::cout << "Client (id: " << id << ") sent an unknown message" << std::endl;
+        protocol::Message answer = {protocol::MSG_TEXT, 0, 0, 0, {}, {}, "Commande inconnu..."};
+        send(player, answer);
+    }
+}
+
+
+/**
+ * A player of the room sent a datagram (ignored if the token is wrong or if a newer one was already received)
+ * The channel is bound to the address of the last datagram, the client is told once with an ID datagram.
+ *
+ * @param id player id
+ * @param token token of the datagram
+ * @param seq sequence of the datagram
+ * @param from address of the sender
+ * @param msg the decoded message
+ */
+void Room::datagram(unsigned int id, uint64_t token, uint32_t seq, const sockaddr_in &from, const protocol::Message &msg)
+{
+    std::map<unsigned int, Player>::iterator me = m_Clients.find(id);
+    if (me == m_Clients.end() || me->second.udp_token == 0 || me->second.udp_token != token) return;
+    Player &player = me->second;
+
+    if (player.udp_bound && seq <= player.udp_received) return; // late or duplicated
+    player.udp_received = seq;
+
+    if (!player.udp_bound || player.udp_address.sin_addr.s_addr != from.sin_addr.s_addr || player.udp_address.sin_port != from.sin_port) {
+        std::cout << "Client (id: " << id << ") UDP channel bound" << std::endl;
+        player.udp_address = from;
+        player.udp_bound = true;
+
+        protocol::Message bound = {protocol::MSG_ID, id, player.protocol, 0, {}, {}, ""};
+        sendUnreliable(player, bound);
+    }
+
+    // only the high frequency messages are accepted on this channel
+    if (msg.type == protocol::MSG_POSITION || msg.type == protocol::MSG_SNAPSHOTACK) {
+        message(id, msg);
+    }
+}
+
+
+/**
+ * The connection of a player of the room is closed
+ * (with a resumable session, he keeps his seat for the grace period : the others are not told)
+ *
+ * @param id player id
+ * @param connection id of the closed connection
+ * @return true if he is still in the room (his session waits for a resume, or was resumed on another connection)
+ */
+bool Room::leave(unsigned int id, unsigned int connection)
+{
+    // players kicked at the end of a game are already gone
+    std::map<unsigned int, Player>::iterator it = m_Clients.find(id);
+    if (it == m_Clients.end()) return false;
+    Player &player = it->second;
+
+    if (player.connection != connection) return true; // a previous connection, closed after the resume
+    if (player.session != 0) {
+        player.connection = 0;
+        player.socket = -1;
+        player.reactor = nullptr;
+        player.expires = m_Now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<float>(m_Config->resume_grace));
+        m_Suspended++;
+        std::cout << "Client " << id << " disconnected, his session is kept " << m_Config->resume_grace << " s" << std::endl;
+        return true;
+    }
+
+    remove(it);
+    return false;
+}
+
+
+/**
+ * Remove a player from the room, and tell the others at the next tick
+ *
+ * @param it the player
+ */
+void Room::remove(std::map<unsigned int, Player>::iterator it)
+{
+    unsigned int id = it->second.id;
+    m_Clients.erase(it);
+    m_ClientToRemove.push_back(id);
+    m_Names.erase(id);
+    m_PlayerPositions.remove(id);
+    m_Interest.remove(id);
+}
+
+
+/**
+ * Broadcast what happened since the last tick and move the game forward
+ *
+ * @param now time of the tick
+ * @param released ids of the disconnected players removed from the room (grace period over, or end of the game), appended
+ */
+void Room::tick(std::chrono::steady_clock::time_point now, std::vector<unsigned int> &released)
+{
+    m_Now = now;
+
+    // sessions not resumed in time
+    if (m_Suspended > 0) {
+        for (std::map<unsigned int, Player>::iterator it = m_Clients.begin() ; it != m_Clients.end() ; ) {
+            std::map<unsigned int, Player>::iterator next = std::next(it);
+            if (it->second.connection == 0 && it->second.expires <= now) {
+                std::cout << "Client " << it->first << " did not resume his session" << std::endl;
+                m_Released.push_back(it->first);
+                m_Suspended--;
+                remove(it);
+            }
+            it = next;
+        }
+    }
+
+    // tell other players about lost clients
+    if (m_ClientToRemove.size() > 0) {
+        for(auto &i : m_ClientToRemove) {
+            protocol::Message msg = {protocol::MSG_PLAYERLEFT, i, 0, 0, {}, {}, ""};
+            broadcast(msg, 0, false);
+        }
+        m_ClientToRemove.clear();
+
+        // Reset status if all players have left
+        if (m_Clients.empty()) {
+            m_Status.store(WAITING, std::memory_order_release); // whatever the game was
+            m_Leader.store(-1, std::memory_order_release); // Reset leader
+
+            std::cout << "All player have left room " << m_Id << " !" << std::endl;
+        } else if (m_Clients.find(leader()) == m_Clients.end()) {
+            m_Leader.store((int) m_Clients.begin()->second.id, std::memory_order_release); // the first one
+
+            std::cout << "New leader of room " << m_Id << " : " << leader() << std::endl;
+        }
+    }
+
+    // Send start msg to all players
+    if (transition(STARTING, IN_PROGRESS)) {
+        protocol::Message msg = {protocol::MSG_START, 0, 0, 0, {}, {}, ""};
+        broadcast(msg);
+        std::cout << "[" << m_Config->name << "] " << protocol::encode(msg, 0) << std::endl; // server
+
+        // every player starts at the origin (a client sends its position once it moves)
+        const float origin[3] = {0, 0, 0};
+        for (auto &i : m_Clients) {
+            m_PlayerPositions.set(i.second.id, origin);
+            m_Interest.moved(i.second.id);
+            i.second.azimut = 0;
+        }
+    }
+
+    // Send new player msg to all players
+    if (m_NewPlayerHasJoin.size() > 0) {
+        for (auto &i : m_NewPlayerHasJoin) {
+            std::map<unsigned int, Player>::iterator it = m_Clients.find(i);
+            if (it == m_Clients.end()) continue; // already left
+            protocol::Message msg = {protocol::MSG_PLAYER, it->second.id, it->second.nb_objects_found, 0, {}, {}, it->second.name};
+            broadcast(msg, it->second.id, false);
+        }
+        m_NewPlayerHasJoin.clear();
+    }
+
+    // Send moves to the players around
+    replicatePositions();
+    replicateSnapshots();
+
+    // Send player find object msg to all players
+    if (m_PlayerFindObject.size() > 0) {
+        if (status() == IN_PROGRESS) {
+            int nb_object = (int) m_Config->objects.size();
+
+            Player *winner = nullptr;
+            for (auto &i : m_PlayerFindObject) {
+                std::map<unsigned int, Player>::iterator it = m_Clients.find(i.first);
+                if (it == m_Clients.end()) continue; // already left
+                protocol::Message msg = {protocol::MSG_PLAYERFIND, it->second.id, i.second, 0, {}, {}, ""};
+
+                std::cout << "[" << m_Config->name << "] " << protocol::encode(msg, 0) << std::endl;
+                broadcast(msg, 0, false);
+
+                // check if he win
+                if ((int) it->second.nb_objects_found == nb_object) {
+                    winner = &(it->second);
+                    break; // Stop loop (to prevent multi-win)
+                }
+            }
+            m_PlayerFindObject.clear();
+            if (winner != nullptr) {
+                Player w = *winner; // m_Clients is cleared by end()
+                end(w);
+            }
+        } else {
+            m_PlayerFindObject.clear();
+        }
+    }
+
+    // reloaded while players were in the room
+    if (m_Reconfigure && m_Clients.empty()) applyConfig();
+
+    released.insert(released.end(), m_Released.begin(), m_Released.end());
+    m_Released.clear();
+}
@@ -0,0 +1,294 @@
+#ifndef SERV_ROOM_H
+#define SERV_ROOM_H
+
+#include <string>
+#include <map>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <netinet/in.h>
+
+#include "Protocol.h"
+#include "Snapshot.h"
+#include "Reactor.h"
+#include "UdpChannel.h"
+#include "WorldConfig.h"
+#include "SpatialHash.h"
+#include "InterestManager.h"
+
+// Packets kept per session to be sent again on resume (a client which missed more can not resume)
+#define SESSION_HISTORY 64U
+
+/**
+ * Draws the UDP channel and resume tokens of the players : unpredictable when the server runs, read back from the
+ * event log by a replay
+ */
+typedef std::function<uint64_t()> TokenSource;
+
+/**
+ * Packet sent on TCP to a player, with the sequence of its first message (messages counted since the connection)
+ */
+struct SentPacket {
+    uint32_t seq;
+    Packet packet;
+};
+
+// Player structure definition
+struct Player {
+    unsigned int id;
+    std::string name;
+    unsigned int nb_objects_found;
+    bool is_registred; // if not, player can not ask for start, send position or request data
+    uint8_t protocol; // negotiated protocol version (0: text)
+    unsigned int connection; // id of his connection (0: disconnected, his session waits for a resume)
+    int socket;
+    Reactor *reactor; // owner of the connection, every message goes through it
+    float azimut; // facing, in degrees (from his last position)
+
+    // snapshots sent and not older than the last one he acknowledged (protocol >= SNAPSHOT_VERSION) : the frames
+    // are shared with the other players, only what he saw of them is his
+    uint32_t snapshot_seq; // last snapshot sent
+    uint32_t snapshot_acked; // baseline of the next delta (0: none)
+    std::deque<snapshot::View> snapshots;
+
+    // UDP channel (protocol >= UDP_VERSION)
+    uint64_t udp_token; // given in ID (0: no channel)
+    bool udp_bound; // a datagram was received from udp_address
+    sockaddr_in udp_address;
+    uint32_t udp_received; // sequence of the last datagram received, older ones are dropped
+    uint32_t udp_sent; // sequence of the last datagram sent
+
+    // session (protocol >= RESUME_VERSION) : what he was sent on TCP, snapshots excluded, sent again on resume
+    uint64_t session; // resume token given in ID (0: not resumable)
+    uint32_t sent; // messages sent
+    std::deque<SentPacket> history; // last packets sent (SESSION_HISTORY at most)
+    std::chrono::steady_clock::time_point expires; // end of the grace period, once disconnected
+};
+
+// Game status
+enum Status {
+    WAITING, // waiting players (client connection authorized)
+    STARTING, // to send start msg to each player
+    IN_PROGRESS, // game in progress (client can not initialize new connection)
+    COMPLETED, // we have a winner ! (reload all data)
+    _STATUS_COUNT
+};
+
+
+/**
+ * One game : its players, its leader, its objects and its status.
+ * Rooms are independent from each other, they are only used by the game thread.
+ */
+class Room
+{
+private:
+
+    unsigned int m_Id;
+
+    // unreliable channel of the clients (nullptr: TCP only), and where the tokens come from
+    UdpChannel *m_Udp;
+    TokenSource m_Tokens;
+
+    // time of the last tick (the sessions of the players leaving before the next one expire from it)
+    std::chrono::steady_clock::time_point m_Now;
+
+    // room description : name, max_player, objects
+    std::shared_ptr<const RoomConfig> m_Config;
+
+    // description given by a reload, used once the room is empty (nullptr: the room is closed)
+    std::shared_ptr<const RoomConfig> m_NextConfig;
+    bool m_Reconfigure;
+
+    // Clients list
+    std::map<unsigned int, Player> m_Clients;
+    std::vector<unsigned int> m_ClientToRemove; // players who left, to tell the others
+    std::vector<unsigned int> m_NewPlayerHasJoin;
+    std::vector<std::pair<unsigned int, unsigned int> > m_PlayerFindObject;
+
+    // disconnected players waiting for a resume, and the ones removed since (to tell the lobby)
+    unsigned int m_Suspended;
+    std::vector<unsigned int> m_Released;
+
+    // Who sees who, and what to tell them at the next tick
+    InterestManager m_Interest;
+    std::vector<InterestManager::Event> m_InterestEvents;
+
+    // state of every player at the last tick (shared by the snapshots of all the players), and their names
+    snapshot::Frame m_Frame;
+    snapshot::Names m_Names;
+
+    // Latest position of each player, and position of each object (index in m_Config->objects + 1)
+    SpatialHash m_PlayerPositions;
+    SpatialHash m_ObjectPositions;
+
+    // Game status and room leader (only he can start the game, -1: nobody)
+    // changed by the game thread only, read by any thread without lock
+    std::atomic<Status> m_Status;
+    std::atomic<int> m_Leader;
+
+    /**
+     * Move the game to another status, only from the expected one
+     * @param from expected status
+     * @param to new status
+     * @return false if the game was not in the expected status (nothing changed)
+     */
+    bool transition(Status from, Status to);
+
+    /**
+     * Send a message to a player, with the protocol he has negotiated
+     * @param p the player
+     * @param msg the message
+     */
+    void send(Player &p, const protocol::Message &msg);
+
+    /**
+     * Post a packet on the connection of a player (if he is connected), and keep it for a resume
+     * @param p the player
+     * @param packet encoded messages
+     * @param count number of messages in the packet
+     * @param bulk not counted against the slow consumer cap (see Reactor::post)
+     */
+    void deliver(Player &p, const Packet &packet, uint32_t count, bool bulk = false);
+
+    /**
+     * Send a message to every player of the room, encoded once per protocol version
+     * @param msg the message
+     * @param except id of a player who does not receive it (0: nobody)
+     * @param snapshots false if the players receiving snapshots already know it
+     */
+    void broadcast(const protocol::Message &msg, unsigned int except = 0, bool snapshots = true);
+
+    /**
+     * Send a message to a player on his UDP channel if it is bound (and the message small enough), on TCP otherwise
+     * @param p the player
+     * @param msg the message
+     */
+    void sendUnreliable(Player &p, const protocol::Message &msg);
+
+    /** send the moves of the players to the players who see them (without snapshots) */
+    void replicatePositions();
+
+    /** send to each player receiving snapshots what changed since the last one he acknowledged */
+    void replicateSnapshots();
+
+    /** tell each player who won and empty the room */
+    void end(const Player &winner);
+
+    /** remove a player from the room, and tell the others */
+    void remove(std::map<unsigned int, Player>::iterator it);
+
+    /** use m_NextConfig (the room has to be empty) */
+    void applyConfig();
+
+public:
+
+    /**
+     * @param id room number (for the logs)
+     * @param config room description
+     * @param udp unreliable channel of the clients (nullptr: TCP only)
+     * @param tokens source of the tokens of the players
+     */
+    Room(unsigned int id, std::shared_ptr<const RoomConfig> config, UdpChannel *udp, TokenSource tokens);
+
+    /** room number */
+    unsigned int id() const { return m_Id; }
+
+    /** room name */
+    const std::string &name() const { return m_Config->name; }
+
+    /** can a new player join the room ? */
+    bool isOpen() const;
+
+    /** game status (any thread) */
+    Status status() const { return m_Status.load(std::memory_order_acquire); }
+
+    /** room leader, -1 if nobody (any thread) */
+    int leader() const { return m_Leader.load(std::memory_order_acquire); }
+
+    /** no player in the room */
+    bool empty() const { return m_Clients.empty(); }
+
+    /** number of disconnected players waiting for a resume */
+    unsigned int suspended() const { return m_Suspended; }
+
+    /** has a player of the room sent his name ? */
+    bool registered(unsigned int id) const;
+
+    /** closed by a reload, removed once empty */
+    bool closed() const { return m_Reconfigure && !m_NextConfig; }
+
+    /**
+     * Change the description of the room, once the players in it have left
+     *
+     * @param config new description (nullptr: close the room)
+     */
+    void configure(std::shared_ptr<const RoomConfig> config);
+
+    /**
+     * A new player enters the room
+     *
+     * @param id player id (his connection id)
+     * @param socket player connection
+     * @param reactor owner of the connection
+     */
+    void join(unsigned int id, int socket, Reactor *reactor);
+
+    /**
+     * A player resumes his session on a new connection : he is sent again what he missed
+     *
+     * @param id player id
+     * @param session resume token
+     * @param received messages he received on his previous connections
+     * @param connection id of the new connection
+     * @param socket the new connection
+     * @param reactor owner of the connection
+     * @return false if the session is unknown or if the messages he missed are no longer known
+     */
+    bool resume(unsigned int id, uint64_t session, uint32_t received, unsigned int connection, int socket, Reactor *reactor);
+
+    /**
+     * A player of the room sent a message (ignored if he is no longer in the room)
+     *
+     * @param id player id
+     * @param msg the decoded message (MSG_UNKNOWN if malformed)
+     */
+    void message(unsigned int id, const protocol::Message &msg);
+
+    /**
+     * A player of the room sent a datagram (ignored if the token is wrong or if a newer one was already received)
+     *
+     * @param id player id
+     * @param token token of the datagram
+     * @param seq sequence of the datagram
+     * @param from address of the sender
+     * @param msg the decoded message
+     */
+    void datagram(unsigned int id, uint64_t token, uint32_t seq, const sockaddr_in &from, const protocol::Message &msg);
+
+    /**
+     * The connection of a player of the room is closed
+     *
+     * @param id player id
+     * @param connection id of the closed connection
+     * @return true if he is still in the room (his session waits for a resume, or was resumed on another connection)
+     */
+    bool leave(unsigned int id, unsigned int connection);
+
+    /**
+     * Broadcast what happened since the last tick and move the game forward
+     *
+     * @param now time of the tick
+     * @param released ids of the disconnected players removed from the room (grace period over, or end of the game), appended
+     */
+    void tick(std::chrono::steady_clock::time_point now, std::vector<unsigned int> &released);
+
+    /**
+     * Close all clients connections, after the messages already sent
+     */
+    void closeConnections();
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include <math.h>
+#include <algorithm>
+
+#include "SpatialHash.h"
+
+// bits of each cell coordinate in a key (2^21 cells per axis)
+#define CELL_BITS 21
+#define CELL_MASK ((1ULL << CELL_BITS) - 1)
+// cell coordinates are clamped to [-MAX_CELL, MAX_CELL] (far or not finite positions)
+#define MAX_CELL (1LL << 40)
+
+
+/**
+ * Squared distance between two positions
+ */
+static float distance2(const float a[3], const float b[3])
+{
+    float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+
+/**
+ * @param cell_size edge of a cell, close to the usual query radius
+ */
+SpatialHash::SpatialHash(float cell_size):
+    m_CellSize(cell_size > 0 ? cell_size : 1.0f), m_Cells(), m_Index()
+{
+}
+
+
+/**
+ * Cell coordinate of a position (clamped : converting a huge or not finite value would be undefined)
+ */
+int64_t SpatialHash::cell(float v) const
+{
+    double c = floor((double) v / m_CellSize);
+    if (!(c >= (double) -MAX_CELL)) return -MAX_CELL; // NaN included
+    if (c > (double) MAX_CELL) return MAX_CELL;
+    return (int64_t) c;
+}
+
+
+/**
+ * Key of a cell (coordinates wrap every 2^21 cells, neighbours stay distinct)
+ */
+uint64_t SpatialHash::key(int64_t x, int64_t y, int64_t z)
+{
+    return ((uint64_t) x & CELL_MASK) | (((uint64_t) y & CELL_MASK) << CELL_BITS) | (((uint64_t) z & CELL_MASK) << (2 * CELL_BITS));
+}
+
+
+/**
+ * Key of the cell of a position
+ */
+uint64_t SpatialHash::key(const float pos[3]) const
+{
+    return key(cell(pos[0]), cell(pos[1]), cell(pos[2]));
+}
+
+
+/**
+ * Remove a point from its cell (the index is left as is)
+ */
+void SpatialHash::unlink(unsigned int id, uint64_t k)
+{
+    std::unordered_map<uint64_t, std::vector<Item> >::iterator c = m_Cells.find(k);
+    if (c == m_Cells.end()) return;
+
+    std::vector<Item> &items = c->second;
+    for (size_t i = 0 ; i < items.size() ; i++) {
+        if (items[i].id == id) {
+            items[i] = items.back();
+            items.pop_back();
+            break;
+        }
+    }
+    if (items.empty()) m_Cells.erase(c);
+}
+
+
+/**
+ * Call f(item) for every point of the cells around a sphere
+ */
+template <typename F>
+void SpatialHash::forEachAround(const float center[3], float radius, F f) const
+{
+    int64_t min[3], max[3];
+    for (int i = 0 ; i < 3 ; i++) {
+        min[i] = cell(center[i] - radius);
+        max[i] = cell(center[i] + radius);
+    }
+
+    for (int64_t x = min[0] ; x <= max[0] ; x++) {
+        for (int64_t y = min[1] ; y <= max[1] ; y++) {
+            for (int64_t z = min[2] ; z <= max[2] ; z++) {
+                std::unordered_map<uint64_t, std::vector<Item> >::const_iterator c = m_Cells.find(key(x, y, z));
+                if (c == m_Cells.end()) continue;
+                for (const Item &item : c->second) f(item);
+            }
+        }
+    }
+}
+
+
+/**
+ * Add a point, or move it if it already exists
+ *
+ * @param id point id
+ * @param pos its position
+ */
+void SpatialHash::set(unsigned int id, const float pos[3])
+{
+    uint64_t k = key(pos);
+    std::unordered_map<unsigned int, uint64_t>::iterator it = m_Index.find(id);
+
+    if (it != m_Index.end()) {
+        if (it->second == k) {
+            // same cell, only update the position
+            for (Item &item : m_Cells[k]) {
+                if (item.id == id) {
+                    std::copy(pos, pos + 3, item.pos);
+                    return;
+                }
+            }
+        }
+        unlink(id, it->second);
+        it->second = k;
+    } else {
+        m_Index[id] = k;
+    }
+
+    Item item = {id, {pos[0], pos[1], pos[2]}};
+    m_Cells[k].push_back(item);
+}
+
+
+/**
+ * Remove a point (nothing if it does not exist)
+ *
+ * @param id point id
+ */
+void SpatialHash::remove(unsigned int id)
+{
+    std::unordered_map<unsigned int, uint64_t>::iterator it = m_Index.find(id);
+    if (it == m_Index.end()) return;
+
+    unlink(id, it->second);
+    m_Index.erase(it);
+}
+
+
+/**
+ * Remove every point
+ */
+void SpatialHash::clear()
+{
+    m_Cells.clear();
+    m_Index.clear();
+}
+
+
+/**
+ * Position of a point
+ *
+ * @param id point id
+ * @param pos filled with its position
+ * @return false if the point does not exist
+ */
+bool SpatialHash::get(unsigned int id, float pos[3]) const
+{
+    std::unordered_map<unsigned int, uint64_t>::const_iterator it = m_Index.find(id);
+    if (it == m_Index.end()) return false;
+
+    for (const Item &item : m_Cells.at(it->second)) {
+        if (item.id == id) {
+            std::copy(item.pos, item.pos + 3, pos);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Is a point inside a sphere ?
+ *
+ * @param id point id
+ * @param center center of the sphere
+ * @param radius radius of the sphere
+ * @return false if the point is outside or does not exist
+ */
+bool SpatialHash::isWithin(unsigned int id, const float center[3], float radius) const
+{
+    float pos[3];
+    return get(id, pos) && distance2(pos, center) <= radius * radius;
+}
+
+
+/**
+ * Points inside a sphere
+ *
+ * @param center center of the sphere
+ * @param radius radius of the sphere
+ * @param ids filled with the ids of the points (cleared first)
+ */
+void SpatialHash::query(const float center[3], float radius, std::vector<unsigned int> &ids) const
+{
+    float r2 = radius * radius;
+
+    ids.clear();
+    forEachAround(center, radius, [&](const Item &item) {
+        if (distance2(item.pos, center) <= r2) ids.push_back(item.id);
+    });
+}
+
+
+/**
+ * Nearest point of a position, inside a sphere : the cells are searched ring by ring around the one of the
+ * position, until no farther ring can hold a nearer point
+ *
+ * @param center center of the sphere
+ * @param radius radius of the sphere
+ * @param id filled with the id of the nearest point
+ * @return false if there is no point inside the sphere
+ */
+bool SpatialHash::nearest(const float center[3], float radius, unsigned int &id) const
+{
+    if (m_Index.empty() || !(radius >= 0)) return false;
+
+    int64_t c[3] = { cell(center[0]), cell(center[1]), cell(center[2]) };
+    float best = radius * radius;
+    bool found = false;
+
+    auto visit = [&](int64_t x, int64_t y, int64_t z) {
+        std::unordered_map<uint64_t, std::vector<Item> >::const_iterator it = m_Cells.find(key(x, y, z));
+        if (it == m_Cells.end()) return;
+        for (const Item &item : it->second) {
+            float d2 = distance2(item.pos, center);
+            if (d2 <= best) {
+                best = d2;
+                id = item.id;
+                found = true;
+            }
+        }
+    };
+
+    // the points of ring r (cells r away from the center one on some axis) are at least (r - 1) cells away
+    for (int64_t r = 0 ; ; r++) {
+        float gap = (float) (r - 1) * m_CellSize;
+        if (r > 0 && gap * gap > best) break;
+
+        for (int64_t x = c[0] - r ; x <= c[0] + r ; x++) {
+            for (int64_t y = c[1] - r ; y <= c[1] + r ; y++) {
+                if (x == c[0] - r || x == c[0] + r || y == c[1] - r || y == c[1] + r) {
+                    for (int64_t z = c[2] - r ; z <= c[2] + r ; z++) visit(x, y, z);
+                }
+                else {
+                    visit(x, y, c[2] - r);
+                    if (r > 0) visit(x, y, c[2] + r);
+                }
+            }
+        }
+    }
+    return found;
+}
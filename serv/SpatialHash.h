@@ -0,0 +1,115 @@
+#ifndef SERV_SPATIALHASH_H
+#define SERV_SPATIALHASH_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+
+/**
+ * Uniform grid of points, hashed by cell.
+ * Insertion, move, removal, radius and nearest queries cost O(1) on average
+ * when the radius is close to the cell size.
+ */
+class SpatialHash
+{
+private:
+
+    struct Item {
+        unsigned int id;
+        float pos[3];
+    };
+
+    float m_CellSize;
+
+    // points of each non-empty cell
+    std::unordered_map<uint64_t, std::vector<Item> > m_Cells;
+
+    // cell of each point
+    std::unordered_map<unsigned int, uint64_t> m_Index;
+
+    /** cell coordinate of a position */
+    int64_t cell(float v) const;
+
+    /** key of a cell */
+    static uint64_t key(int64_t x, int64_t y, int64_t z);
+
+    /** key of the cell of a position */
+    uint64_t key(const float pos[3]) const;
+
+    /** remove a point from its cell (the index is left as is) */
+    void unlink(unsigned int id, uint64_t k);
+
+    /** call f(item) for every point of the cells around a sphere */
+    template <typename F>
+    void forEachAround(const float center[3], float radius, F f) const;
+
+public:
+
+    /**
+     * @param cell_size edge of a cell, close to the usual query radius
+     */
+    explicit SpatialHash(float cell_size);
+
+    /** number of points */
+    size_t size() const { return m_Index.size(); }
+
+    /**
+     * Add a point, or move it if it already exists
+     *
+     * @param id point id
+     * @param pos its position
+     */
+    void set(unsigned int id, const float pos[3]);
+
+    /**
+     * Remove a point (nothing if it does not exist)
+     *
+     * @param id point id
+     */
+    void remove(unsigned int id);
+
+    /** remove every point */
+    void clear();
+
+    /**
+     * Position of a point
+     *
+     * @param id point id
+     * @param pos filled with its position
+     * @return false if the point does not exist
+     */
+    bool get(unsigned int id, float pos[3]) const;
+
+    /**
+     * Is a point inside a sphere ?
+     *
+     * @param id point id
+     * @param center center of the sphere
+     * @param radius radius of the sphere
+     * @return false if the point is outside or does not exist
+     */
+    bool isWithin(unsigned int id, const float center[3], float radius) const;
+
+    /**
+     * Points inside a sphere
+     *
+     * @param center center of the sphere
+     * @param radius radius of the sphere
+     * @param ids filled with the ids of the points (cleared first)
+     */
+    void query(const float center[3], float radius, std::vector<unsigned int> &ids) const;
+
+    /**
+     * Nearest point of a position, inside a sphere : the cells are searched ring by ring around the one of the
+     * position, until no farther ring can hold a nearer point
+     *
+     * @param center center of the sphere
+     * @param radius radius of the sphere
+     * @param id filled with the id of the nearest point
+     * @return false if there is no point inside the sphere
+     */
+    bool nearest(const float center[3], float radius, unsigned int &id) const;
+};
+
+#endif
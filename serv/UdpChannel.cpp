@@ -0,0 +1,219 @@
+#include <iostream>
+#include <cstdlib>
+#include <cerrno>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+
+#include "UdpChannel.h"
+
+// a client datagram is only a small frame, anything larger is truncated and dropped
+#define DATAGRAM_BUFFER_SIZE 2048
+
+
+/**
+ * Create the UDP socket and the epoll/eventfd descriptors
+ *
+ * @param port UDP port (the TCP port of the server)
+ * @param on_datagram called for each valid datagram
+ */
+UdpChannel::UdpChannel(uint16_t port, DatagramCallback on_datagram):
+    m_OnDatagram(on_datagram), m_Message(), m_Outbox(), m_Notified(false), m_Stopping(false)
+{
+    struct sockaddr_in address;
+
+    // Creating socket file descriptor (IPv4 protocol, UDP : unreliable, no head-of-line blocking), non-blocking
+    if ( (m_Socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ) {
+        std::cerr << "Socket failed " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    address.sin_family = AF_INET; // IPv4 protocol
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons( port );
+
+    // Binds the socket to the address and port number
+    if (bind(m_Socket, (struct sockaddr *)&address, sizeof(address))) {
+        std::cerr << "Bind failed " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // eventfd written by stop() and by the threads posting datagrams
+    if ( (m_EventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 ) {
+        std::cerr << "eventfd " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if ( (m_EpollFd = epoll_create1(EPOLL_CLOEXEC)) < 0 ) {
+        std::cerr << "epoll_create1 " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = m_Socket;
+    epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_Socket, &ev);
+    ev.data.fd = m_EventFd;
+    epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_EventFd, &ev);
+}
+
+
+/**
+ * Event loop, returns only after stop()
+ */
+void UdpChannel::run()
+{
+    struct epoll_event events[2];
+
+    while (true) {
+        int n = epoll_wait(m_EpollFd, events, 2, -1); // PASSIVE WAIT
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait " << __FILE__ << " " << __LINE__ << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0 ; i < n ; i++) {
+            if (events[i].data.fd == m_EventFd) {
+                uint64_t count;
+                ssize_t r = read(m_EventFd, &count, sizeof(count));
+                (void) r;
+                if (m_Stopping.load()) return; // stop() was called
+                drainOutbox();
+            } else {
+                receiveAll();
+            }
+        }
+    }
+}
+
+
+/**
+ * Ask the event loop to stop (async-signal-safe)
+ */
+void UdpChannel::stop()
+{
+    m_Stopping.store(true);
+    uint64_t one = 1;
+    ssize_t r = write(m_EventFd, &one, sizeof(one));
+    (void) r;
+}
+
+
+/**
+ * Queue a datagram (any thread), dropped if the socket buffer is full
+ *
+ * @param to client address
+ * @param packet encoded datagram
+ */
+void UdpChannel::post(const sockaddr_in &to, Packet packet)
+{
+    m_Outbox.push(Outgoing{to, std::move(packet)});
+    if (m_Notified.exchange(true)) return; // once until the outbox is drained
+    uint64_t one = 1;
+    ssize_t r = write(m_EventFd, &one, sizeof(one));
+    (void) r;
+}
+
+
+/**
+ * Receive every pending datagram, UDP_BATCH per call
+ * (malformed ones are dropped silently, anybody can send anything to this port)
+ */
+void UdpChannel::receiveAll()
+{
+    static char buffers[UDP_BATCH][DATAGRAM_BUFFER_SIZE]; // only used by the event loop thread
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    struct sockaddr_in from[UDP_BATCH];
+    uint64_t token;
+    uint32_t seq;
+
+    while (true) {
+        memset(msgs, 0, sizeof(msgs));
+        for (unsigned int i = 0 ; i < UDP_BATCH ; i++) {
+            iov[i].iov_base = buffers[i];
+            iov[i].iov_len = DATAGRAM_BUFFER_SIZE;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        }
+
+        int n = recvmmsg(m_Socket, msgs, UDP_BATCH, 0, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "recvmmsg " << __FILE__ << " " << __LINE__ << std::endl;
+            }
+            return;
+        }
+
+        for (int i = 0 ; i < n ; i++) {
+            TrafficStats::add(m_Stats.bytes_in, msgs[i].msg_len);
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) continue;
+            if (protocol::decodeDatagram(buffers[i], msgs[i].msg_len, token, seq, m_Message)) {
+                TrafficStats::add(m_Stats.messages[m_Message.type], 1);
+                m_OnDatagram(token, seq, from[i], m_Message, std::string_view(buffers[i], msgs[i].msg_len));
+            }
+        }
+        if (n < UDP_BATCH) return; // nothing left
+    }
+}
+
+
+/**
+ * Send the posted datagrams, UDP_BATCH per call
+ * (a datagram the socket buffer can not take is lost, the snapshots are acknowledged anyway)
+ */
+void UdpChannel::drainOutbox()
+{
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    Outgoing batch[UDP_BATCH];
+    unsigned int count;
+
+    m_Notified.store(false); // datagrams posted from now on wake the loop again
+    do {
+        count = 0;
+        while (count < UDP_BATCH && m_Outbox.pop(batch[count])) count++;
+
+        memset(msgs, 0, sizeof(msgs));
+        for (unsigned int i = 0 ; i < count ; i++) {
+            iov[i].iov_base = const_cast<char *>(batch[i].packet->data());
+            iov[i].iov_len = batch[i].packet->size();
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &batch[i].to;
+            msgs[i].msg_hdr.msg_namelen = sizeof(batch[i].to);
+        }
+
+        unsigned int sent = 0;
+        while (sent < count) {
+            int n = sendmmsg(m_Socket, msgs + sent, count - sent, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                sent++; // skip the datagram the socket refused (buffer full, unreachable client...)
+                continue;
+            }
+            for (int i = 0 ; i < n ; i++) TrafficStats::add(m_Stats.bytes_out, msgs[sent + (unsigned int) i].msg_len);
+            sent += (unsigned int) n;
+        }
+
+        for (unsigned int i = 0 ; i < count ; i++) batch[i].packet.reset();
+    } while (count == UDP_BATCH);
+}
+
+
+/**
+ * Close every descriptor
+ */
+UdpChannel::~UdpChannel()
+{
+    close(m_Socket);
+    close(m_EventFd);
+    close(m_EpollFd);
+}
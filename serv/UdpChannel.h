@@ -0,0 +1,101 @@
+#ifndef SERV_UDPCHANNEL_H
+#define SERV_UDPCHANNEL_H
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <netinet/in.h>
+
+#include "Protocol.h"
+#include "Reactor.h"
+#include "MpscQueue.h"
+#include "Metrics.h"
+
+// Datagrams received or sent with one system call
+#define UDP_BATCH 64
+
+
+/**
+ * Unreliable channel of the clients, next to their TCP connection (see Protocol.h).
+ * One socket and one event loop thread : it only decodes what it receives and sends what is posted,
+ * the game thread checks the token and the sequence of each datagram.
+ */
+class UdpChannel
+{
+public:
+
+    /** called for each datagram holding a valid frame, with the datagram as received */
+    typedef std::function<void(uint64_t token, uint32_t seq, const sockaddr_in &from, const protocol::Message&, std::string_view datagram)> DatagramCallback;
+
+private:
+
+    // datagram posted by another thread
+    struct Outgoing {
+        sockaddr_in to;
+        Packet packet;
+    };
+
+    int m_Socket;
+    int m_EpollFd;
+    int m_EventFd;
+
+    DatagramCallback m_OnDatagram;
+
+    // reused for every decoded datagram
+    protocol::Message m_Message;
+
+    // posted by the other threads, m_Notified avoids a write on the eventfd per datagram
+    MpscQueue<Outgoing> m_Outbox;
+    std::atomic<bool> m_Notified;
+    std::atomic<bool> m_Stopping;
+
+    // written by the event loop thread only
+    TrafficStats m_Stats;
+
+    /** receive every pending datagram, UDP_BATCH per call */
+    void receiveAll();
+
+    /** send the posted datagrams, UDP_BATCH per call */
+    void drainOutbox();
+
+public:
+
+    /**
+     * Create the UDP socket and the epoll/eventfd descriptors
+     *
+     * @param port UDP port (the TCP port of the server)
+     * @param on_datagram called for each valid datagram
+     */
+    UdpChannel(uint16_t port, DatagramCallback on_datagram);
+
+    /** Close every descriptor */
+    ~UdpChannel();
+
+    /**
+     * Event loop, returns only after stop()
+     */
+    void run();
+
+    /**
+     * Ask the event loop to stop (async-signal-safe)
+     */
+    void stop();
+
+    /**
+     * Queue a datagram (any thread), dropped if the socket buffer is full
+     *
+     * @param to client address
+     * @param packet encoded datagram
+     */
+    void post(const sockaddr_in &to, Packet packet);
+
+    /**
+     * Traffic of the channel (any thread)
+     */
+    const TrafficStats& stats() const { return m_Stats; }
+};
+
+#endif
@@ -0,0 +1,464 @@
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#include "WorldConfig.h"
+#include "WorldFile.h"
+#include "JsonReader.h"
+
+
+/**
+ * Table owning its arrays
+ *
+ * @param types type of each object
+ * @param positions 3 floats per object
+ * @param directions 3 floats per object
+ */
+ObjectTable ObjectTable::build(std::vector<uint8_t> &&types, std::vector<float> &&positions, std::vector<float> &&directions)
+{
+    struct Arrays {
+        std::vector<uint8_t> types;
+        std::vector<float> positions;
+        std::vector<float> directions;
+    };
+    std::shared_ptr<Arrays> arrays = std::make_shared<Arrays>(Arrays{std::move(types), std::move(positions), std::move(directions)});
+    return ObjectTable(arrays, arrays->types.size(), arrays->types.data(), arrays->positions.data(), arrays->directions.data());
+}
+
+
+/**
+ * Every OBJECT message of the room, sent to each player who joins
+ * (encoded by the first call for this version : a large world is not encoded at load for every protocol)
+ *
+ * @param version protocol version of the player
+ */
+const Packet &RoomConfig::objectsPacket(uint8_t version) const
+{
+    Packet &packet = objects_packets[version];
+    if (!packet) {
+        std::string encoded;
+        for (size_t i = 0 ; i < objects.size() ; i++) {
+            protocol::Message msg = {protocol::MSG_OBJECT, (uint32_t) i+1, 0, objects.type(i), {}, {}, ""};
+            std::copy(objects.position(i), objects.position(i) + 3, msg.pos);
+            std::copy(objects.direction(i), objects.direction(i) + 3, msg.dir);
+            encoded += protocol::encode(msg, version);
+        }
+        packet = std::make_shared<const std::string>(std::move(encoded));
+    }
+    return packet;
+}
+
+
+/*******************************
+ * JSON, read as a stream
+*******************************/
+
+/**
+ * Read a number value (the key was just read)
+ *
+ * @param json the reader
+ * @param key the key (for the errors)
+ * @param value the number
+ * @param errors why it is not a number
+ * @return false if it is not a number
+ */
+static bool read_number(JsonReader &json, const std::string &key, double &value, std::string &errors)
+{
+    JsonReader::Token token = json.next();
+    if (token == JsonReader::NUMBER) {
+        value = json.number();
+        return true;
+    }
+    if (token != JsonReader::ERROR) errors += json.where() + ": a number is expected for '" + key + "'\n";
+    return false;
+}
+
+static bool read_float(JsonReader &json, const std::string &key, float &value, std::string &errors)
+{
+    double number;
+    if (!read_number(json, key, number, errors)) return false;
+    value = (float) number;
+    return true;
+}
+
+static bool read_unsigned(JsonReader &json, const std::string &key, uint64_t &value, std::string &errors)
+{
+    double number;
+    if (!read_number(json, key, number, errors)) return false;
+    if (!(number >= 0 && number <= (double) UINT32_MAX)) {
+        errors += json.where() + ": '" + key + "' is out of range\n";
+        return false;
+    }
+    value = (uint64_t) number;
+    return true;
+}
+
+static bool read_string(JsonReader &json, const std::string &key, std::string &value, std::string &errors)
+{
+    JsonReader::Token token = json.next();
+    if (token == JsonReader::STRING) {
+        value = json.text();
+        return true;
+    }
+    if (token != JsonReader::ERROR) errors += json.where() + ": a string is expected for '" + key + "'\n";
+    return false;
+}
+
+static bool read_bool(JsonReader &json, const std::string &key, bool &value, std::string &errors)
+{
+    JsonReader::Token token = json.next();
+    if (token == JsonReader::BOOLEAN) {
+        value = json.boolean();
+        return true;
+    }
+    if (token != JsonReader::ERROR) errors += json.where() + ": true or false is expected for '" + key + "'\n";
+    return false;
+}
+
+/**
+ * Read a vector {"x":..., "y":..., "z":...} (a missing coordinate is 0)
+ */
+static bool read_vector(JsonReader &json, const std::string &key, float *xyz, std::string &errors)
+{
+    xyz[0] = xyz[1] = xyz[2] = 0;
+    JsonReader::Token token = json.next();
+    if (token != JsonReader::BEGIN_OBJECT) {
+        if (token != JsonReader::ERROR) errors += json.where() + ": an object is expected for '" + key + "'\n";
+        return false;
+    }
+    while ((token = json.next()) == JsonReader::KEY) {
+        std::string axis = json.text();
+        if (axis == "x" || axis == "y" || axis == "z") {
+            if (!read_float(json, axis, xyz[axis[0] - 'x'], errors)) return false;
+        } else if (!json.skip(json.next())) {
+            return false;
+        }
+    }
+    return token == JsonReader::END_OBJECT;
+}
+
+/**
+ * Read the objects of a room, straight into its arrays (the key was just read)
+ */
+static bool read_objects(JsonReader &json, std::vector<uint8_t> &types, std::vector<float> &positions, std::vector<float> &directions, std::string &errors)
+{
+    JsonReader::Token token = json.next();
+    if (token != JsonReader::BEGIN_ARRAY) {
+        if (token != JsonReader::ERROR) errors += json.where() + ": an array is expected for 'objects'\n";
+        return false;
+    }
+
+    while ((token = json.next()) == JsonReader::BEGIN_OBJECT) {
+        uint8_t type = protocol::NB_OBJECT_TYPES;
+        float position[3] = {0, 0, 0};
+        float direction[3] = {0, 0, 0};
+
+        while ((token = json.next()) == JsonReader::KEY) {
+            std::string key = json.text();
+            if (key == "type") {
+                std::string name;
+                if (!read_string(json, key, name, errors)) return false;
+                type = protocol::objectTypeCode(name);
+                if (type >= protocol::NB_OBJECT_TYPES) {
+                    errors += json.where() + ": unknown object type '" + name + "'\n";
+                    return false;
+                }
+            } else if (key == "position") {
+                if (!read_vector(json, key, position, errors)) return false;
+            } else if (key == "direction") {
+                if (!read_vector(json, key, direction, errors)) return false;
+            } else if (!json.skip(json.next())) {
+                return false;
+            }
+        }
+        if (token != JsonReader::END_OBJECT) return false;
+        if (type >= protocol::NB_OBJECT_TYPES) {
+            errors += json.where() + ": object " + std::to_string(types.size() + 1) + " has no type\n";
+            return false;
+        }
+
+        types.push_back(type);
+        positions.insert(positions.end(), position, position + 3);
+        directions.insert(directions.end(), direction, direction + 3);
+    }
+    if (token != JsonReader::END_ARRAY) {
+        if (token != JsonReader::ERROR) errors += json.where() + ": an object is expected in 'objects'\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * A room being read : its keys can come in any order
+ */
+struct RoomReader {
+    std::shared_ptr<RoomConfig> room = std::make_shared<RoomConfig>();
+    uint64_t max_player = 0;
+    float found_radius = DEFAULT_FOUND_RADIUS;
+    float found_tolerance = DEFAULT_FOUND_TOLERANCE;
+    float interest_radius = DEFAULT_INTEREST_RADIUS;
+    float resume_grace = DEFAULT_RESUME_GRACE;
+    std::vector<uint8_t> types;
+    std::vector<float> positions;
+    std::vector<float> directions;
+
+    /**
+     * Read the value of a key of a room
+     *
+     * @param json the reader (the key was just read)
+     * @param key the key
+     * @param handled false if it is not a key of a room (its value is not read)
+     * @param errors why the value can not be used
+     * @return false on error
+     */
+    bool read(JsonReader &json, const std::string &key, bool &handled, std::string &errors) {
+        handled = true;
+        if (key == "name") return read_string(json, key, room->name, errors);
+        if (key == "max_player") return read_unsigned(json, key, max_player, errors);
+        if (key == "found_radius") return read_float(json, key, found_radius, errors);
+        if (key == "found_tolerance") return read_float(json, key, found_tolerance, errors);
+        if (key == "interest_radius") return read_float(json, key, interest_radius, errors);
+        if (key == "resume_grace") return read_float(json, key, resume_grace, errors);
+        if (key == "objects") return read_objects(json, types, positions, directions, errors);
+        handled = false;
+        return true;
+    }
+
+    /** the room, once every key was read */
+    std::shared_ptr<RoomConfig> finish() {
+        room->max_player = (unsigned int) max_player;
+        room->found_radius = found_radius + found_tolerance;
+        room->found_tolerance = found_tolerance;
+        room->interest_radius = interest_radius;
+        room->resume_grace = std::max(resume_grace, 0.0f);
+        room->objects = ObjectTable::build(std::move(types), std::move(positions), std::move(directions));
+        return room;
+    }
+};
+
+/**
+ * Read a room description (its opening brace was just read)
+ *
+ * @param json the reader
+ * @param errors why the room can not be used
+ * @return the room, nullptr if it can not be used
+ */
+static std::shared_ptr<RoomConfig> read_room(JsonReader &json, std::string &errors)
+{
+    RoomReader room;
+    JsonReader::Token token;
+    bool handled;
+
+    while ((token = json.next()) == JsonReader::KEY) {
+        std::string key = json.text();
+        if (!room.read(json, key, handled, errors)) return nullptr;
+        if (!handled && !json.skip(json.next())) return nullptr;
+    }
+    if (token != JsonReader::END_OBJECT) return nullptr;
+    return room.finish();
+}
+
+/**
+ * Read a JSON config file as a stream : the objects go straight to the arrays of their room
+ *
+ * @param json reader of the config file
+ * @param errors why the file can not be used (the errors of the reader itself excluded)
+ * @return the config, nullptr if the file can not be used
+ */
+static std::shared_ptr<const WorldConfig> read_world(JsonReader &json, std::string &errors)
+{
+    std::shared_ptr<WorldConfig> world = std::make_shared<WorldConfig>();
+    RoomReader top; // the file itself describes the room if it has no "rooms"
+    uint64_t value;
+
+    world->reactors = 0;
+    world->io_uring = false;
+    world->tick_rate = DEFAULT_TICK_RATE;
+    world->max_output_bytes = DEFAULT_MAX_OUTPUT_BYTES;
+    world->metrics_port = 0;
+
+    JsonReader::Token token = json.next();
+    if (token != JsonReader::BEGIN_OBJECT) {
+        if (token != JsonReader::ERROR) errors += json.where() + ": the config is not an object\n";
+        return nullptr;
+    }
+
+    bool ok = true;
+    bool handled;
+    while (ok && (token = json.next()) == JsonReader::KEY) {
+        std::string key = json.text();
+        if (key == "rooms") {
+            token = json.next();
+            if (token != JsonReader::BEGIN_ARRAY) {
+                if (token != JsonReader::ERROR) errors += json.where() + ": an array is expected for 'rooms'\n";
+                ok = false;
+                break;
+            }
+            while ((token = json.next()) == JsonReader::BEGIN_OBJECT) {
+                std::shared_ptr<RoomConfig> room = read_room(json, errors);
+                if (!room) return nullptr;
+                world->rooms.push_back(room);
+            }
+            ok = token == JsonReader::END_ARRAY;
+            continue;
+        }
+        if (!top.read(json, key, handled, errors)) return nullptr;
+        if (key == "name") world->name = top.room->name;
+        if (handled) continue;
+
+        if (key == "reactors") {
+            ok = read_unsigned(json, key, value, errors);
+            world->reactors = (unsigned int) value;
+        } else if (key == "io_uring") {
+            ok = read_bool(json, key, world->io_uring, errors);
+        } else if (key == "tick_rate") {
+            ok = read_unsigned(json, key, value, errors);
+            world->tick_rate = std::min(std::max((unsigned int) value, MIN_TICK_RATE), MAX_TICK_RATE);
+        } else if (key == "max_output_bytes") {
+            ok = read_unsigned(json, key, value, errors);
+            world->max_output_bytes = (size_t) value;
+        } else if (key == "metrics_port") {
+            ok = read_unsigned(json, key, value, errors);
+            world->metrics_port = (uint16_t) value;
+        } else if (key == "event_log") {
+            ok = read_string(json, key, world->event_log, errors);
+        } else {
+            ok = json.skip(json.next());
+        }
+    }
+    if (ok && token == JsonReader::END_OBJECT) token = json.next();
+    if (!ok || token != JsonReader::END) return nullptr;
+
+    if (world->rooms.empty()) world->rooms.push_back(top.finish());
+    return world;
+}
+
+
+/**
+ * Load a config file : a world file (see WorldFile.h), or JSON with one room per item of "rooms",
+ * or only one described by the file itself
+ *
+ * @param path config file
+ * @param errors why the file can not be used
+ * @return the config, nullptr if the file can not be used
+ */
+std::shared_ptr<const WorldConfig> WorldConfig::load(const std::string &path, std::string &errors)
+{
+    if (worldfile::isWorldFile(path)) return worldfile::load(path, errors);
+
+    std::ifstream file(path);
+    if (!file) {
+        errors = "Unable to open the file\n";
+        return nullptr;
+    }
+    JsonReader json(file);
+    std::shared_ptr<const WorldConfig> world = read_world(json, errors);
+    if (!world) errors += json.error();
+    return world;
+}
+
+
+/*******************************
+ * JSON, written
+*******************************/
+
+static void write_string(std::ostream &out, const std::string &s)
+{
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char) c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int) c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+static void write_float(std::ostream &out, float value)
+{
+    char number[32];
+    snprintf(number, sizeof(number), "%.9g", std::isfinite(value) ? (double) value : 0.0); // read back exactly
+    out << number;
+}
+
+static void write_vector(std::ostream &out, const float *xyz)
+{
+    out << "{\"x\":";
+    write_float(out, xyz[0]);
+    out << ",\"y\":";
+    write_float(out, xyz[1]);
+    out << ",\"z\":";
+    write_float(out, xyz[2]);
+    out << '}';
+}
+
+
+/**
+ * Write the config : a world file if the path ends with WORLD_FILE_EXTENSION, JSON otherwise
+ * (JSON always lists the rooms in "rooms", one object per line)
+ *
+ * @param path file to create (or replace)
+ * @param errors why the file can not be written
+ * @return false if the file can not be written
+ */
+bool WorldConfig::save(const std::string &path, std::string &errors) const
+{
+    std::string extension = WORLD_FILE_EXTENSION;
+    if (path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0) {
+        return worldfile::save(*this, path, errors);
+    }
+
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        errors = "Unable to create '" + path + "': " + strerror(errno) + "\n";
+        return false;
+    }
+    out << "{\n    \"name\": ";
+    write_string(out, name);
+    out << ",\n    \"reactors\": " << reactors << ",\n    \"io_uring\": " << (io_uring ? "true" : "false");
+    out << ",\n    \"tick_rate\": " << tick_rate << ",\n    \"max_output_bytes\": " << max_output_bytes;
+    out << ",\n    \"metrics_port\": " << metrics_port;
+    if (!event_log.empty()) {
+        out << ",\n    \"event_log\": ";
+        write_string(out, event_log);
+    }
+    out << ",\n    \"rooms\":\n    [";
+    for (size_t r = 0 ; r < rooms.size() ; r++) {
+        const RoomConfig &room = *rooms[r];
+        out << (r > 0 ? "," : "") << "\n        {\"name\": ";
+        write_string(out, room.name);
+        out << ", \"max_player\": " << room.max_player << ", \"found_radius\": ";
+        write_float(out, room.found_radius - room.found_tolerance);
+        out << ", \"found_tolerance\": ";
+        write_float(out, room.found_tolerance);
+        out << ", \"interest_radius\": ";
+        write_float(out, room.interest_radius);
+        out << ", \"resume_grace\": ";
+        write_float(out, room.resume_grace);
+        out << ", \"objects\":\n        [";
+        for (size_t i = 0 ; i < room.objects.size() ; i++) {
+            out << (i > 0 ? "," : "") << "\n            {\"type\":\"" << protocol::OBJECT_TYPE_NAMES[room.objects.type(i)] << "\", \"position\":";
+            write_vector(out, room.objects.position(i));
+            out << ", \"direction\":";
+            write_vector(out, room.objects.direction(i));
+            out << '}';
+        }
+        out << "\n        ]}";
+    }
+    out << "\n    ]\n}\n";
+
+    out.close();
+    if (!out) {
+        errors = "Unable to write '" + path + "': " + strerror(errno) + "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,138 @@
+#ifndef SERV_WORLDCONFIG_H
+#define SERV_WORLDCONFIG_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Protocol.h"
+#include "Reactor.h"
+
+// Game tick frequency (Hz), "tick_rate" in the config file
+#define DEFAULT_TICK_RATE 30U
+#define MIN_TICK_RATE 1U
+#define MAX_TICK_RATE 1000U
+
+// Pending output bytes above which a client is disconnected, "max_output_bytes" in the config file
+#define DEFAULT_MAX_OUTPUT_BYTES 262144U
+
+// A player finds an object closer than this (same value as the client), "found_radius" in the room config
+#define DEFAULT_FOUND_RADIUS 5.0f
+// Distance allowed above found_radius (rounding, moves between two positions), "found_tolerance" in the room config
+#define DEFAULT_FOUND_TOLERANCE 0.5f
+// Players closer than this receive the moves of each other, "interest_radius" in the room config
+#define DEFAULT_INTEREST_RADIUS 20.0f
+// Seconds a disconnected player keeps his seat, waiting for him to resume his session, "resume_grace" in the room config
+#define DEFAULT_RESUME_GRACE 10.0f
+
+
+/**
+ * Objects to find in a room (the id of an object is its index + 1), one array per field :
+ * read from JSON, the table owns its arrays; read from a world file, they are the mapped file itself.
+ */
+class ObjectTable
+{
+private:
+
+    // what keeps the arrays alive (vectors, or the file mapping)
+    std::shared_ptr<const void> m_Storage;
+
+    size_t m_Size;
+    const uint8_t *m_Types; // index in protocol::OBJECT_TYPE_NAMES
+    const float *m_Positions; // x, y, z of each object
+    const float *m_Directions; // degrees around x, y, z of each object
+
+public:
+
+    /** no object */
+    ObjectTable(): m_Storage(), m_Size(0), m_Types(nullptr), m_Positions(nullptr), m_Directions(nullptr) {}
+
+    /**
+     * @param storage what keeps the arrays alive
+     * @param size number of objects
+     * @param types type of each object
+     * @param positions 3 floats per object
+     * @param directions 3 floats per object
+     */
+    ObjectTable(std::shared_ptr<const void> storage, size_t size, const uint8_t *types, const float *positions, const float *directions):
+        m_Storage(storage), m_Size(size), m_Types(types), m_Positions(positions), m_Directions(directions) {}
+
+    /**
+     * Table owning its arrays
+     *
+     * @param types type of each object
+     * @param positions 3 floats per object
+     * @param directions 3 floats per object
+     */
+    static ObjectTable build(std::vector<uint8_t> &&types, std::vector<float> &&positions, std::vector<float> &&directions);
+
+    size_t size() const { return m_Size; }
+    uint8_t type(size_t i) const { return m_Types[i]; }
+    const float *position(size_t i) const { return m_Positions + 3 * i; }
+    const float *direction(size_t i) const { return m_Directions + 3 * i; }
+
+    /** whole arrays (to write them) */
+    const uint8_t *types() const { return m_Types; }
+    const float *positions() const { return m_Positions; }
+    const float *directions() const { return m_Directions; }
+};
+
+/**
+ * Description of a room, never changed once loaded
+ */
+struct RoomConfig {
+    std::string name;
+    unsigned int max_player;
+    float found_radius; // found_radius + found_tolerance
+    float found_tolerance; // only kept to write the config again
+    float interest_radius;
+    float resume_grace; // seconds (0: no resumable session)
+    ObjectTable objects;
+
+    // every OBJECT message of the room, encoded once per protocol version by objectsPacket()
+    mutable Packet objects_packets[protocol::VERSION + 1];
+
+    /**
+     * Every OBJECT message of the room, sent to each player who joins
+     * (encoded by the first call for this version, the game thread only calls it)
+     *
+     * @param version protocol version of the player
+     */
+    const Packet &objectsPacket(uint8_t version) const;
+};
+
+/**
+ * Server config file, parsed and checked once : a new one is loaded to change it (see load()).
+ */
+struct WorldConfig {
+    std::string name;
+    unsigned int reactors; // 0: one per core
+    bool io_uring; // reactors on io_uring when the kernel supports it (epoll otherwise)
+    unsigned int tick_rate;
+    size_t max_output_bytes;
+    uint16_t metrics_port; // Prometheus endpoint on the loopback (0: none)
+    std::string event_log; // events of the game thread recorded in this file, for a replay ("": none)
+    std::vector<std::shared_ptr<const RoomConfig> > rooms;
+
+    /**
+     * Load a config file : a world file (see WorldFile.h), or JSON with one room per item of "rooms",
+     * or only one described by the file itself
+     *
+     * @param path config file
+     * @param errors why the file can not be used
+     * @return the config, nullptr if the file can not be used
+     */
+    static std::shared_ptr<const WorldConfig> load(const std::string &path, std::string &errors);
+
+    /**
+     * Write the config : a world file if the path ends with WORLD_FILE_EXTENSION, JSON otherwise
+     *
+     * @param path file to create (or replace)
+     * @param errors why the file can not be written
+     * @return false if the file can not be written
+     */
+    bool save(const std::string &path, std::string &errors) const;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "WorldFile.h"
+
+namespace worldfile {
+
+/**
+ * A file mapped in memory, unmapped with the last room using it
+ */
+struct Mapping {
+    const char *data;
+    size_t size;
+
+    Mapping(const char *data, size_t size): data(data), size(size) {}
+    ~Mapping() { munmap((void *) data, size); }
+};
+
+// arrays are aligned on this
+static const uint64_t ALIGNMENT = 8;
+
+static uint64_t aligned(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+/**
+ * Is [offset, offset + size[ in the file ?
+ */
+static bool inside(uint64_t offset, uint64_t size, size_t file_size) {
+    return offset <= file_size && size <= file_size - offset;
+}
+
+
+/**
+ * Does the file start like a world file ?
+ *
+ * @param path file to check
+ */
+bool isWorldFile(const std::string &path)
+{
+    char magic[WORLD_FILE_MAGIC_SIZE];
+    std::ifstream file(path, std::ios::binary);
+    return file.read(magic, WORLD_FILE_MAGIC_SIZE) && memcmp(magic, WORLD_FILE_MAGIC, WORLD_FILE_MAGIC_SIZE) == 0;
+}
+
+
+/**
+ * Map a world file, the objects of its rooms are read from the mapping
+ * (only the header, the rooms and the types are checked : positions and directions are used as they are)
+ *
+ * @param path world file
+ * @param errors why the file can not be used
+ * @return the config, nullptr if the file can not be used
+ */
+std::shared_ptr<const WorldConfig> load(const std::string &path, std::string &errors)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        errors = std::string("Unable to open the file: ") + strerror(errno) + "\n";
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(Header)) {
+        close(fd);
+        errors = "Truncated world file\n";
+        return nullptr;
+    }
+    size_t size = (size_t) st.st_size;
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        errors = std::string("Unable to map the file: ") + strerror(errno) + "\n";
+        return nullptr;
+    }
+    std::shared_ptr<const Mapping> mapping = std::make_shared<const Mapping>((const char *) data, size);
+    const char *base = mapping->data;
+
+    const Header *header = (const Header *) base;
+    if (memcmp(header->magic, WORLD_FILE_MAGIC, WORLD_FILE_MAGIC_SIZE) != 0 || header->version != WORLD_FILE_VERSION) {
+        errors = "Not a world file of version " + std::to_string(WORLD_FILE_VERSION) + "\n";
+        return nullptr;
+    }
+    if (header->byte_order != WORLD_FILE_BYTE_ORDER) {
+        errors = "World file written on a machine of another byte order (convert it to JSON there)\n";
+        return nullptr;
+    }
+    if (!inside(header->name, header->name_size, size) || !inside(header->event_log, header->event_log_size, size) ||
+        header->nb_rooms == 0 || header->nb_rooms > size / sizeof(Room) || !inside(sizeof(Header), header->nb_rooms * sizeof(Room), size)) {
+        errors = "Corrupted world file header\n";
+        return nullptr;
+    }
+
+    std::shared_ptr<WorldConfig> world = std::make_shared<WorldConfig>();
+    world->name.assign(base + header->name, header->name_size);
+    world->reactors = header->reactors;
+    world->io_uring = header->io_uring != 0;
+    world->tick_rate = std::min(std::max(header->tick_rate, MIN_TICK_RATE), MAX_TICK_RATE);
+    world->max_output_bytes = header->max_output_bytes;
+    world->metrics_port = (uint16_t) header->metrics_port;
+    world->event_log.assign(base + header->event_log, header->event_log_size);
+
+    const Room *rooms = (const Room *) (base + sizeof(Header));
+    for (uint64_t r = 0 ; r < header->nb_rooms ; r++) {
+        const Room &in = rooms[r];
+        uint64_t n = in.nb_objects;
+        if (!inside(in.name, in.name_size, size) || n > size ||
+            !inside(in.types, n, size) || !inside(in.positions, n * 3 * sizeof(float), size) || !inside(in.directions, n * 3 * sizeof(float), size) ||
+            in.positions % alignof(float) != 0 || in.directions % alignof(float) != 0) {
+            errors = "Corrupted room " + std::to_string(r + 1) + " in the world file\n";
+            return nullptr;
+        }
+
+        std::shared_ptr<RoomConfig> room = std::make_shared<RoomConfig>();
+        room->name.assign(base + in.name, in.name_size);
+        room->max_player = in.max_player;
+        room->found_radius = in.found_radius;
+        room->found_tolerance = in.found_tolerance;
+        room->interest_radius = in.interest_radius;
+        room->resume_grace = std::max(in.resume_grace, 0.0f);
+
+        const uint8_t *types = (const uint8_t *) (base + in.types);
+        for (uint64_t i = 0 ; i < n ; i++) {
+            if (types[i] >= protocol::NB_OBJECT_TYPES) {
+                errors = "Room '" + room->name + "': unknown object type " + std::to_string(types[i]) + "\n";
+                return nullptr;
+            }
+        }
+        room->objects = ObjectTable(mapping, (size_t) n, types, (const float *) (base + in.positions), (const float *) (base + in.directions));
+        world->rooms.push_back(room);
+    }
+
+    return world;
+}
+
+
+/**
+ * Write a config as a world file
+ * (written next to it, then renamed : a server mapping the previous file keeps reading it)
+ *
+ * @param world the config
+ * @param path file to create (or replace)
+ * @param errors why the file can not be written
+ * @return false if the file can not be written
+ */
+bool save(const WorldConfig &world, const std::string &path, std::string &errors)
+{
+    std::string strings;
+    std::vector<Room> rooms(world.rooms.size());
+    uint64_t strings_start = sizeof(Header) + rooms.size() * sizeof(Room);
+
+    // strings first, then the arrays of each room
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WORLD_FILE_MAGIC, WORLD_FILE_MAGIC_SIZE);
+    header.version = WORLD_FILE_VERSION;
+    header.byte_order = WORLD_FILE_BYTE_ORDER;
+    header.name = strings_start + strings.size();
+    header.name_size = world.name.size();
+    strings += world.name;
+    header.event_log = strings_start + strings.size();
+    header.event_log_size = world.event_log.size();
+    strings += world.event_log;
+    header.max_output_bytes = world.max_output_bytes;
+    header.reactors = world.reactors;
+    header.tick_rate = world.tick_rate;
+    header.metrics_port = world.metrics_port;
+    header.io_uring = world.io_uring ? 1 : 0;
+    header.nb_rooms = rooms.size();
+
+    for (size_t r = 0 ; r < rooms.size() ; r++) {
+        const RoomConfig &room = *world.rooms[r];
+        memset(&rooms[r], 0, sizeof(Room));
+        rooms[r].name = strings_start + strings.size();
+        rooms[r].name_size = room.name.size();
+        strings += room.name;
+        rooms[r].max_player = room.max_player;
+        rooms[r].found_radius = room.found_radius;
+        rooms[r].found_tolerance = room.found_tolerance;
+        rooms[r].interest_radius = room.interest_radius;
+        rooms[r].resume_grace = room.resume_grace;
+        rooms[r].nb_objects = room.objects.size();
+    }
+    uint64_t offset = strings_start + strings.size();
+    for (size_t r = 0 ; r < rooms.size() ; r++) {
+        uint64_t n = rooms[r].nb_objects;
+        rooms[r].types = offset = aligned(offset);
+        rooms[r].positions = offset = aligned(offset + n);
+        rooms[r].directions = offset = aligned(offset + n * 3 * sizeof(float));
+        offset += n * 3 * sizeof(float);
+    }
+
+    std::string tmp = path + ".tmp";
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        errors = "Unable to create '" + tmp + "': " + strerror(errno) + "\n";
+        return false;
+    }
+    static const char zeros[ALIGNMENT] = {};
+    uint64_t written = 0;
+    auto write = [&](uint64_t at, const void *data, uint64_t size) {
+        file.write(zeros, (std::streamsize) (at - written)); // padding up to the aligned offset
+        file.write((const char *) data, (std::streamsize) size);
+        written = at + size;
+    };
+    write(0, &header, sizeof(header));
+    write(written, rooms.data(), rooms.size() * sizeof(Room));
+    write(written, strings.data(), strings.size());
+    for (size_t r = 0 ; r < rooms.size() ; r++) {
+        const ObjectTable &objects = world.rooms[r]->objects;
+        write(rooms[r].types, objects.types(), objects.size());
+        write(rooms[r].positions, objects.positions(), objects.size() * 3 * sizeof(float));
+        write(rooms[r].directions, objects.directions(), objects.size() * 3 * sizeof(float));
+    }
+    file.close();
+
+    if (!file || rename(tmp.c_str(), path.c_str()) < 0) {
+        errors = "Unable to write '" + path + "': " + strerror(errno) + "\n";
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+}
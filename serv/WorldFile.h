@@ -0,0 +1,80 @@
+#ifndef SERV_WORLDFILE_H
+#define SERV_WORLDFILE_H
+
+// Binary world file (.wtdworld) : a server config whose objects are mapped in memory and used in place
+//
+// Header | Room[nb_rooms] | strings | for each room : types (u8 per object), positions, directions (3 f32 per object)
+// Every offset is from the start of the file, the arrays are 8-byte aligned. Numbers are in the byte order of the
+// machine which wrote the file (checked with byte_order) : convert it to JSON to move it to another one.
+
+#include <stdint.h>
+#include <string>
+#include <memory>
+
+#include "WorldConfig.h"
+
+#define WORLD_FILE_MAGIC "WTDWORLD"
+#define WORLD_FILE_MAGIC_SIZE 8
+#define WORLD_FILE_VERSION 1U
+#define WORLD_FILE_BYTE_ORDER 0x01020304U
+#define WORLD_FILE_EXTENSION ".wtdworld"
+
+namespace worldfile {
+
+struct Header {
+    char magic[WORLD_FILE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t name, name_size; // server name
+    uint64_t event_log, event_log_size;
+    uint64_t max_output_bytes;
+    uint32_t reactors;
+    uint32_t tick_rate;
+    uint32_t metrics_port;
+    uint32_t io_uring;
+    uint64_t nb_rooms;
+};
+
+struct Room {
+    uint64_t name, name_size;
+    uint32_t max_player;
+    float found_radius; // found_tolerance included
+    float found_tolerance;
+    float interest_radius;
+    float resume_grace;
+    uint32_t padding;
+    uint64_t nb_objects;
+    uint64_t types, positions, directions;
+};
+
+static_assert(sizeof(Header) == 80 && sizeof(Room) == 72, "no padding between the fields of a world file");
+
+/**
+ * Does the file start like a world file ?
+ *
+ * @param path file to check
+ */
+bool isWorldFile(const std::string &path);
+
+/**
+ * Map a world file, the objects of its rooms are read from the mapping
+ *
+ * @param path world file
+ * @param errors why the file can not be used
+ * @return the config, nullptr if the file can not be used
+ */
+std::shared_ptr<const WorldConfig> load(const std::string &path, std::string &errors);
+
+/**
+ * Write a config as a world file
+ *
+ * @param world the config
+ * @param path file to create (or replace)
+ * @param errors why the file can not be written
+ * @return false if the file can not be written
+ */
+bool save(const WorldConfig &world, const std::string &path, std::string &errors);
+
+}
+
+#endif
@@ -2,148 +2,118 @@
 #include <iostream>
 #include <cstdlib>
 #include <string>
-#include <fstream>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <jsoncpp/json/json.h>
 #include <thread>
-#include <mutex>
-#include <regex>
 #include <future>
-
-#define N_CHAR 1024UL
-// To delimite each socket msgs
-const std::string MSG_DELIMITER = "$";
-
-// Player structure definition
-struct Player {
-    unsigned int id;
-    std::string name;
-    unsigned int nb_objects_found;
-};
-
-// Game status
-enum Status {
-    WAITING, // waiting players (client connection authorized)
-    STARTING, // to send start msg to each player
-    IN_PROGRESS, // game in progress (client can not initialize new connection)
-    COMPLETED // we have a winner ! (reload all data)
+#include <algorithm>
+#include <sys/random.h>
+
+#include "Protocol.h"
+#include "Reactor.h"
+#include "UdpChannel.h"
+#include "MpscQueue.h"
+#include "WorldConfig.h"
+#include "Lobby.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "EventLog.h"
+
+// Event sent by a reactor (or the UDP channel) to the game thread
+struct GameEvent {
+    enum Type {
+        CONNECTED = LoggedEvent::CONNECTED,
+        MESSAGE = LoggedEvent::MESSAGE, // msg received from the player
+        DISCONNECTED = LoggedEvent::DISCONNECTED,
+        DATAGRAM = LoggedEvent::DATAGRAM // msg received on the UDP channel, not checked yet
+    };
+    Type type;
+    unsigned int player; // connection id (the player id, unless his session was resumed on it)
+    int socket;
+    Reactor *reactor;
+    protocol::Message msg;
+    // DATAGRAM only
+    uint64_t token = 0;
+    uint32_t seq = 0;
+    sockaddr_in from = {};
+    // MESSAGE, DATAGRAM : bytes as received, only kept when the events are recorded
+    std::string data = std::string();
+    // when it was pushed (time waited in the queue)
+    std::chrono::steady_clock::time_point queued = std::chrono::steady_clock::now();
 };
 
 // function definition
 void stop_server();
-void close_sockets();
-void end(Player *winner);
-void deal_with_socket(u_int16_t port, std::future<void> exit_signal);
-void deal_with_client(int socket, unsigned int id, std::future<void> exit_signal);
+bool on_client_accept(Connection &conn);
+void on_client_message(Connection &conn, const protocol::Message &msg, std::string_view data);
+void on_client_close(Connection &conn);
+void on_client_datagram(uint64_t token, uint32_t seq, const sockaddr_in &from, const protocol::Message &msg, std::string_view data);
+void apply_event(Lobby &lobby, const GameEvent &event);
+uint64_t draw_token();
 void deal_with_game(std::future<void> exit_signal);
+int replay(const std::string &log_path);
+int convert(const std::string &from, const std::string &to);
+void reload_config();
+std::string render_metrics();
 
 
 /*******************************
  * Global variables definitions
 *******************************/
-std::mutex mtx_main; // to allow passive lock for main
-std::thread connection_dealer;
+std::vector<Reactor*> reactors; // each one owns a listening socket and its client sockets
+std::vector<std::thread> connection_dealers; // one thread per reactor
+UdpChannel *udp_channel = nullptr; // position traffic, next to the TCP connections
+std::thread datagram_dealer;
 std::thread game_dealer;
-std::promise<void> connection_dealer_exit_signal;
 std::promise<void> game_dealer_exit_signal;
 
-// Clients list
-std::map<unsigned int, std::tuple<std::thread, Player, std::promise<void> > > clients;
-std::vector<unsigned int> client_to_remove; // thread can not remove itself
-std::vector<unsigned int> new_player_has_join;
-std::vector<std::pair<unsigned int, unsigned int> > player_find_object;
-std::mutex mtx_clients;
+// Events from the reactors, applied by the game thread (and its lobby) at each tick
+MpscQueue<GameEvent> game_events;
 
-// Game status
-Status current_status = COMPLETED;
-std::mutex mtx_status;
+// Config file, replaced as a whole on SIGHUP (std::atomic_load / std::atomic_store only)
+std::string config_path;
+std::shared_ptr<const WorldConfig> world_config;
 
-// Who is the room leader (only he can start the game)
-int leader = -1;
-std::mutex mtx_leader;
+// Counters and histograms, served in Prometheus text format if "metrics_port" is set
+Metrics metrics;
+MetricsServer *metrics_server = nullptr;
+std::thread metrics_dealer;
 
-// Config file
-Json::Value config;
-std::mutex mtx_config;
+// Events applied by the game thread, and the tokens drawn, if "event_log" is set (see replay())
+EventLogWriter *event_log = nullptr;
 
 
 
-/**
- * Catch kill signal
- *
- * @param s signal
- */
-void exit_handler(int s) {
-    std::cout << "Caught signal " << s << std::endl;
-    stop_server();
-    std::cout << "Shutdown server..." << std::endl;
-    exit(EXIT_SUCCESS);
-}
-
 /**
  * Stop the server and terminate threads
  */
 void stop_server() {
-    connection_dealer_exit_signal.set_value();
-    game_dealer_exit_signal.set_value();
-    connection_dealer.detach();
-    game_dealer.join();
-    close_sockets();
-}
-
-/**
- * Close all clients connections
- */
-void close_sockets() {
-    mtx_clients.lock();
-    for (auto &i : clients) {
-        std::get<2>(i.second).set_value(); // send exit
-        close(std::get<1>(i.second).id); // stop socket (from id)
+    for (auto &r : reactors) {
+        r->stop();
     }
-    for (auto &i : clients) {
-        std::get<0>(i.second).join(); // stop thread
+    udp_channel->stop();
+    if (metrics_server) metrics_server->stop();
+    game_dealer_exit_signal.set_value();
+    for (auto &t : connection_dealers) {
+        t.join();
     }
-    clients.clear(); // clear player list
-    client_to_remove.clear();
-    mtx_clients.unlock();
-}
+    datagram_dealer.join();
+    if (metrics_dealer.joinable()) metrics_dealer.join();
+    game_dealer.join();
 
-/**
- * Tell to each client that a player win, and reload data
- *
- * @param winner the winner
- */
-void end(Player *winner) {
-    mtx_status.lock();
-    current_status = COMPLETED;
-    mtx_status.unlock();
-
-    // Announce
-    std::string msg = "WIN=";
-    msg += std::to_string(winner->id);
-    msg += MSG_DELIMITER;
-
-    // Server
-    std::cout << msg << std::endl;
-
-    // for each player
-    mtx_clients.lock();
-    for (auto &i : clients) {
-        send((int) std::get<1>(i.second).id, msg.c_str(), msg.length(), 0);
+    // close every socket
+    for (auto &r : reactors) {
+        delete r;
     }
-    mtx_clients.unlock();
-
-    close_sockets();
-
-    mtx_leader.lock();
-    leader = -1;
-    mtx_leader.unlock();
-
-    mtx_status.lock();
-    current_status = WAITING;
-    mtx_status.unlock();
+    reactors.clear();
+    delete udp_channel;
+    udp_channel = nullptr;
+    delete metrics_server;
+    metrics_server = nullptr;
+    delete event_log;
+    event_log = nullptr;
 }
 
 /**
@@ -153,448 +123,413 @@ void end(Player *winner) {
  * @param argv pointer to the first element of an array (arguments list)
  */
 int main(int argc, char* argv[]) {
-    // create handler
-    signal(SIGTERM, exit_handler);
-    signal(SIGINT, exit_handler);
-
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << "<port> <json_config_file>" << std::endl;
+    bool replaying = argc == 4 && std::string(argv[1]) == "--replay";
+    bool converting = argc == 4 && std::string(argv[1]) == "--convert";
+    if (argc != 3 && !replaying && !converting) {
+        std::cerr << "Usage: " << argv[0] << " <port> <config_file>" << std::endl;
+        std::cerr << "       " << argv[0] << " --replay <event_log> <config_file>" << std::endl;
+        std::cerr << "       " << argv[0] << " --convert <config_file> <new_config_file (.wtdworld: binary, JSON otherwise)>" << std::endl;
         return EXIT_FAILURE;
     }
+    if (converting) return convert(argv[2], argv[3]);
 
-    uint16_t port = (u_int16_t) atoi(argv[1]);
-    std::ifstream config_file(argv[2]);
-
-    Json::CharReaderBuilder rbuilder;
-    std::string errs;
+    uint16_t port = replaying ? 0 : (u_int16_t) atoi(argv[1]);
+    config_path = argv[argc - 1];
 
     // Read config file
-    mtx_config.lock();
-    bool result = Json::parseFromStream(rbuilder, config_file, &config, &errs);
-    mtx_config.unlock();
-
-    if (!result) {
-        std::cerr << "Failed to load configuration '" << argv[2] << "'\n" << errs;
+    std::string errs;
+    std::shared_ptr<const WorldConfig> world = WorldConfig::load(config_path, errs);
+    if (!world) {
+        std::cerr << "Failed to load configuration '" << config_path << "'\n" << errs;
         return EXIT_FAILURE;
     }
+    std::atomic_store(&world_config, world);
 
     // Display Server name
-    mtx_config.lock();
-    std::cout << "Server: [" << config["name"].asString() << "] loaded..." << std::endl;
-    mtx_config.unlock();
+    std::cout << "Server: [" << world->name << "] loaded..." << std::endl;
 
-    // Start the connection catch thread
-    connection_dealer = std::thread(deal_with_socket, port, std::move(connection_dealer_exit_signal.get_future()));
+    if (replaying) return replay(argv[2]);
 
-    // Start the game dealer
-    game_dealer = std::thread(deal_with_game, std::move(game_dealer_exit_signal.get_future()));
-
-    // infinite loop, the server will shutdown on kill (or Ctrl-C)
-    while (true) {
-        mtx_main.lock(); // PASSIVE LOCK
+    // Record the events from the start (the reactors push them with their bytes from now on)
+    if (!world->event_log.empty()) {
+        std::unique_ptr<EventLogWriter> log = EventLogWriter::create(world->event_log, errs);
+        if (!log) {
+            std::cerr << "Failed to create the event log: " << errs << std::endl;
+            return EXIT_FAILURE;
+        }
+        event_log = log.release();
+        std::cout << "Events recorded in '" << world->event_log << "'" << std::endl;
     }
-}
 
-/**
- * Thread that will wait forever for new connections
- *
- * @param port for socket
- */
-void deal_with_socket(uint16_t port, std::future<void> exit_signal) {
-    int server_fd;
-    struct sockaddr_in address;
-    int opt = 1;
-    int addrlen = sizeof(address);
-
-    // Creating socket file descriptor  (IPv4 protocol, TCP : reliable &  connection oriented)
-    if ( (server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0 ) {
-        std::cerr << "Socket failed " << __FILE__ << " " << __LINE__ << std::endl;
-        exit(EXIT_FAILURE);
+    // The signals are only received by the main thread, with sigwait (every thread inherits this mask)
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    // Number of event loops, one per core by default
+    unsigned int nb_cores = std::max(1U, std::thread::hardware_concurrency());
+    unsigned int nb_reactors = world->reactors;
+    size_t max_output = world->max_output_bytes;
+    if (nb_reactors == 0) nb_reactors = nb_cores;
+
+    // Start the event loops (each one has its own listening socket on <port>)
+    for (unsigned int i = 0 ; i < nb_reactors ; i++) {
+        reactors.push_back(new Reactor(port, (int) (i % nb_cores), max_output, world->io_uring, on_client_accept, on_client_message, on_client_close));
     }
-
-    // Forcefully attaching socket to the port <port>
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
-        std::cerr << "setsockopt" << __FILE__ << " " << __LINE__ << std::endl;
-        exit(EXIT_FAILURE);
+    for (auto &r : reactors) {
+        connection_dealers.push_back(std::thread(&Reactor::run, r));
     }
-    address.sin_family = AF_INET; // IPv4 protocol
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons( port );
+    std::cout << nb_reactors << " reactor(s) listening on port " << port << (world->io_uring ? " (io_uring)" : "") << std::endl;
 
-    // Binds the socket to the address and port number
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address))) {
-        std::cerr << "Bind failed " << __FILE__ << " " << __LINE__ << std::endl;
-        exit(EXIT_FAILURE);
-    }
+    // Start the UDP channel, on the same port
+    udp_channel = new UdpChannel(port, on_client_datagram);
+    datagram_dealer = std::thread(&UdpChannel::run, udp_channel);
 
-    // Puts the server socket in a passive mode (it waits for the client to approach the server to make a connection)
-    if (listen(server_fd, 3) < 0) {
-        std::cerr << "Listen " << __FILE__ << " " << __LINE__ << std::endl;
-        exit(EXIT_FAILURE);
+    // Serve the metrics on the loopback
+    if (world->metrics_port != 0) {
+        metrics_server = new MetricsServer(world->metrics_port, render_metrics);
+        metrics_dealer = std::thread(&MetricsServer::run, metrics_server);
+        std::cout << "Metrics on http://127.0.0.1:" << world->metrics_port << "/metrics" << std::endl;
     }
 
-    // Get max_player from config
-    mtx_config.lock();
-    unsigned int max_player = config["max_player"].asUInt();
-    mtx_config.unlock();
+    // Start the game dealer
+    game_dealer = std::thread(deal_with_game, std::move(game_dealer_exit_signal.get_future()));
 
-    unsigned int next_id;
+    // the server will shutdown on kill (or Ctrl-C), and reload its config on SIGHUP
+    int sig;
+    while (sigwait(&signals, &sig) == 0) { // PASSIVE WAIT
+        if (sig == SIGHUP) {
+            reload_config();
+            continue;
+        }
+        std::cout << "Caught signal " << sig << std::endl;
+        break;
+    }
 
-    // Let's change current status
-    mtx_status.lock();
-    current_status = WAITING;
-    mtx_status.unlock();
+    stop_server();
+    std::cout << "Shutdown server..." << std::endl;
+    return EXIT_SUCCESS;
+}
 
-    while(exit_signal.wait_for(std::chrono::nanoseconds(1)) == std::future_status::timeout) {
-        int new_socket;
+/**
+ * Called by the reactor for each new connection
+ * (the game thread decides whether the player can join)
+ *
+ * @param conn the new connection
+ * @return false to refuse it
+ */
+bool on_client_accept(Connection &conn) {
+    game_events.push(GameEvent{GameEvent::CONNECTED, conn.id, conn.socket, conn.reactor, {}});
+    return true;
+}
 
-        // A new client connection... PASSIVE WAIT
-        if ( (new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen)) < 0) {
-            std::cerr << "Accept " << __FILE__ << " " << __LINE__ << std::endl;
-            exit(EXIT_FAILURE);
-        }
+/**
+ * Called by the reactor for each message of a client
+ *
+ * @param conn client connection (conn.id = player id)
+ * @param msg the decoded message (MSG_UNKNOWN if malformed)
+ * @param data the message as received (text without delimiter, or binary frame)
+ */
+void on_client_message(Connection &conn, const protocol::Message &msg, std::string_view data) {
+    GameEvent event{GameEvent::MESSAGE, conn.id, conn.socket, conn.reactor, msg};
+    if (event_log) event.data = data;
+    game_events.push(std::move(event));
+}
 
-        if (clients.size() < max_player && current_status == Status::WAITING) {
-            next_id = (unsigned int) new_socket;
-            mtx_clients.lock();
-            if (clients.empty()) {
-                mtx_clients.unlock();
+/**
+ * Called by the reactor when a client connection is closed
+ *
+ * @param conn client connection (conn.id = player id)
+ */
+void on_client_close(Connection &conn) {
+    std::cout << "Connection ended with "<< conn.id <<std::endl;
 
-                // set leader
-                mtx_leader.lock();
-                leader = new_socket;
-                mtx_leader.unlock();
+    game_events.push(GameEvent{GameEvent::DISCONNECTED, conn.id, conn.socket, conn.reactor, {}});
+}
 
-                mtx_clients.lock();
-            }
+/**
+ * Called by the UDP channel for each valid datagram
+ * (the player id is the low part of the token, the game thread checks the whole token)
+ *
+ * @param token token of the datagram
+ * @param seq sequence of the datagram
+ * @param from address of the sender
+ * @param msg the decoded message
+ * @param data the datagram as received
+ */
+void on_client_datagram(uint64_t token, uint32_t seq, const sockaddr_in &from, const protocol::Message &msg, std::string_view data) {
+    GameEvent event{GameEvent::DATAGRAM, (unsigned int) token, -1, nullptr, msg, token, seq, from};
+    if (event_log) event.data = data;
+    game_events.push(std::move(event));
+}
 
-            std::cout << "Client " << next_id << " connected"<<std::endl;
-
-            Player p = {next_id, "", 0};
-            std::promise<void> exitSignal;
-            clients[next_id] = std::make_tuple(
-                std::thread(deal_with_client, new_socket, next_id, std::move(exitSignal.get_future())),
-                p,
-                std::move(exitSignal)
-            );
-            mtx_clients.unlock();
-        } else {
-            std::cout << "out" << std::endl;
-            close(new_socket);
-            // Maximum number of players already reached
-            // Or game already in progress
+/**
+ * Apply an event to the lobby (game thread, or replay)
+ *
+ * @param lobby the rooms
+ * @param event event of a reactor or of the UDP channel
+ */
+void apply_event(Lobby &lobby, const GameEvent &event) {
+    switch (event.type) {
+    case GameEvent::CONNECTED:
+        if (!lobby.connect(event.player, event.socket, event.reactor)) {
+            metrics.connections_rejected.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+    case GameEvent::MESSAGE:
+        if (!lobby.message(event.player, event.msg)) {
+            // refused by its first message : a session to resume, or a new player
+            if (event.msg.type == protocol::MSG_RESUME) metrics.resume_failed.fetch_add(1, std::memory_order_relaxed);
+            else metrics.connections_rejected.fetch_add(1, std::memory_order_relaxed);
         }
+        break;
+    case GameEvent::DISCONNECTED:
+        lobby.disconnect(event.player);
+        break;
+    case GameEvent::DATAGRAM:
+        lobby.datagram(event.player, event.token, event.seq, event.from, event.msg);
+        break;
+    }
+}
 
-        mtx_main.unlock(); // tells main about a new connection...
+/**
+ * Draw a token of a player from the kernel random generator (game thread) : a player can not guess the tokens of
+ * the others from his own ones. It is recorded in the event log, for the replay.
+ *
+ * @return the token
+ */
+uint64_t draw_token() {
+    uint64_t token;
+    size_t got = 0;
+    while (got < sizeof(token)) {
+        ssize_t n = getrandom((char *) &token + got, sizeof(token) - got, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "getrandom " << __FILE__ << " " << __LINE__ << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        got += (size_t) n;
     }
+    if (event_log) event_log->recordToken(token, std::chrono::steady_clock::now());
+    return token;
 }
 
 /**
  * Thread that will manage the game (new player, send data to all clients...)
+ * It owns the rooms: every change comes from the events of the reactors, applied at a fixed rate.
  */
 void deal_with_game(std::future<void> exit_signal) {
-    while (exit_signal.wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout) {
-        // remove lost clients
-        if (client_to_remove.size() > 0) {
-            mtx_clients.lock();
-            for(auto &i : client_to_remove) {
-                std::map<unsigned int, std::tuple<std::thread, Player, std::promise<void>> >::iterator it = clients.find(i);
-                std::get<2>(it->second).set_value();
-                std::get<0>(it->second).join(); // stop thread
-                clients.erase( it );
-            }
-            // Tell to other player
-            for(auto &i : client_to_remove) {
-                std::string msg = "PLAYERLEFT=";
-                msg += std::to_string(i);
-                msg += MSG_DELIMITER;
-                for (auto &c : clients) {
-                    send((int) std::get<1>(c.second).id, msg.c_str(), msg.length(), 0);
-                }
-            }
-            client_to_remove.clear();
-
-            // Reset status if all players have left
-            if (clients.empty()) {
-                mtx_clients.unlock();
-                mtx_status.lock();
-                current_status = WAITING;
-                mtx_status.unlock();
-
-                // Reset leader
-                mtx_leader.lock();
-                leader = -1;
-                mtx_leader.unlock();
-
-                std::cout << "All player have left !" << std::endl;
-            } else {
-                std::map<unsigned int, std::tuple<std::thread, Player, std::promise<void>> >::iterator it_leader = clients.find(leader);
-
-                if (it_leader != clients.end()) {
-                    mtx_clients.unlock();
-                } else {
-                    unsigned int _id = std::get<1>(clients.begin()->second).id;
-                    mtx_clients.unlock();
-
-                    mtx_leader.lock();
-                    leader = (int) _id; // the first one
-                    mtx_leader.unlock();
-
-                    std::cout << "New leader : "<<leader<<std::endl;
-                }
-            }
+    Lobby lobby(std::atomic_load(&world_config), udp_channel, draw_token);
+    std::cout << lobby.size() << " room(s) opened" << std::endl;
+
+    std::chrono::nanoseconds period(1000000000LL / lobby.world()->tick_rate);
+    std::chrono::steady_clock::time_point next_tick = std::chrono::steady_clock::now() + period;
+    GameEvent event;
+
+    while (exit_signal.wait_until(next_tick) == std::future_status::timeout) {
+        // fixed timestep, without trying to catch up after a long stall
+        next_tick += period;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (next_tick < now) next_tick = now + period;
+
+        // apply what happened since the last tick
+        std::chrono::steady_clock::time_point tick_start = std::chrono::steady_clock::now();
+        uint64_t nb_events = 0;
+        while (game_events.pop(event)) {
+            metrics.event_wait.observe(std::chrono::duration<double>(tick_start - event.queued).count());
+            nb_events++;
+            if (event_log) event_log->record((LoggedEvent::Type) event.type, event.player, event.queued, event.data, &event.from);
+            apply_event(lobby, event);
         }
 
-        // Send start msg to all players
-        if (current_status == STARTING) {
-            std::string msg = "START";
-            msg += MSG_DELIMITER;
-            mtx_clients.lock();
-            for (auto &i : clients) {
-                send((int) std::get<1>(i.second).id, msg.c_str(), msg.length(), 0);
-            }
-            mtx_clients.unlock();
-            std::cout << msg << std::endl; // server
-
-            mtx_status.lock();
-            current_status = IN_PROGRESS;
-            mtx_status.unlock();
+        // a new config was loaded : the tick rate changes now, the rooms once empty
+        std::shared_ptr<const WorldConfig> world = std::atomic_load(&world_config);
+        if (world != lobby.world()) {
+            lobby.configure(world);
+            period = std::chrono::nanoseconds(1000000000LL / world->tick_rate);
         }
 
-        // Send new player msg to all players
-        if (new_player_has_join.size() > 0) {
-            std::string msg;
-            mtx_clients.lock();
-            for (auto &i : new_player_has_join) {
-                std::map<unsigned int, std::tuple<std::thread, Player, std::promise<void>> >::iterator it = clients.find(i);
-                msg = "PLAYER=";
-                msg += std::to_string( std::get<1>(it->second).id ) + ":";
-                msg += std::get<1>(it->second).name + ":";
-                msg += std::to_string( std::get<1>(it->second).nb_objects_found );
-                msg += MSG_DELIMITER;
-
-                for (auto &i : clients) {
-                    if (std::get<1>(i.second).id != std::get<1>(it->second).id)
-                        send((int) std::get<1>(i.second).id, msg.c_str(), msg.length(), 0);
-                }
-            }
-            new_player_has_join.clear();
-            mtx_clients.unlock();
+        std::chrono::steady_clock::time_point fanout_start = std::chrono::steady_clock::now();
+        if (event_log) event_log->record(LoggedEvent::TICK, 0, fanout_start);
+        lobby.tick(fanout_start);
+
+        std::chrono::steady_clock::time_point tick_end = std::chrono::steady_clock::now();
+        metrics.fanout_duration.observe(std::chrono::duration<double>(tick_end - fanout_start).count());
+        metrics.tick_duration.observe(std::chrono::duration<double>(tick_end - tick_start).count());
+        metrics.events.fetch_add(nb_events, std::memory_order_relaxed);
+        static_assert(NB_ROOM_STATUS == _STATUS_COUNT, "one rooms gauge per status");
+        metrics.players.store(lobby.players(), std::memory_order_relaxed);
+        for (unsigned int status = 0 ; status < NB_ROOM_STATUS ; status++) {
+            metrics.rooms[status].store(lobby.count((Status) status), std::memory_order_relaxed);
         }
+    }
+}
 
-        // Send player find object msg to all players
-        if (player_find_object.size() > 0) {
-            if (current_status == Status::IN_PROGRESS) {
-                mtx_config.lock();
-                int nb_object = config["objects"].size();
-                mtx_config.unlock();
-
-                std::string msg;
-                mtx_clients.lock();
-                for (auto &i : player_find_object) {
-                    std::map<unsigned int, std::tuple<std::thread, Player, std::promise<void> > >::iterator it = clients.find(i.first);
-                    msg = "PLAYERFIND=";
-                    msg += std::to_string( std::get<1>(it->second).id) + ":";
-                    msg += std::to_string(i.second);
-                    msg += MSG_DELIMITER;
-
-                    std::cout << msg << std::endl;
-
-                    for (auto &i : clients) {
-                        send((int) std::get<1>(i.second).id, msg.c_str(), msg.length(), 0);
-                    }
-
-                    // check if he win
-                    if ((int) std::get<1>(it->second).nb_objects_found == nb_object) {
-                        mtx_clients.unlock();
-                        end(&(std::get<1>(it->second)));
-                        mtx_clients.lock();
-                        break; // Stop loop (to prevent multi-win)
-                    }
-                }
-                player_find_object.clear();
-                mtx_clients.unlock();
+/**
+ * Replay an event log through the game logic, as fast as possible, and print how long it took.
+ * The messages are decoded again from their bytes, the tokens drawn are read back from the log and each tick
+ * gets its recorded time (shifted to now) : the same packets are built and posted, to nobody.
+ * A reactor and a UDP channel on a free port take them : the reactor knows no connection and drops them,
+ * the datagrams are sent to a local socket never read. The config reloads of the session are not replayed.
+ *
+ * @param log_path event log
+ * @return exit status of the server
+ */
+int replay(const std::string &log_path) {
+    std::string errs;
+    std::unique_ptr<EventLogReader> log = EventLogReader::open(log_path, errs);
+    if (!log) {
+        std::cerr << "Failed to read the event log: " << errs << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::shared_ptr<const WorldConfig> world = std::atomic_load(&world_config);
+
+    // sinks of the packets
+    int blackhole = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in blackhole_addr = {};
+    socklen_t addr_len = sizeof(blackhole_addr);
+    blackhole_addr.sin_family = AF_INET;
+    blackhole_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (blackhole < 0 || bind(blackhole, (struct sockaddr *) &blackhole_addr, sizeof(blackhole_addr)) < 0 ||
+        getsockname(blackhole, (struct sockaddr *) &blackhole_addr, &addr_len) < 0) {
+        std::cerr << "blackhole socket " << __FILE__ << " " << __LINE__ << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    reactors.push_back(new Reactor(0, -1, world->max_output_bytes, false, [](Connection&) { return false; },
+                                   [](Connection&, const protocol::Message&, std::string_view) {}, [](Connection&) {}));
+    connection_dealers.push_back(std::thread(&Reactor::run, reactors[0]));
+    udp_channel = new UdpChannel(0, [](uint64_t, uint32_t, const sockaddr_in&, const protocol::Message&, std::string_view) {});
+    datagram_dealer = std::thread(&UdpChannel::run, udp_channel);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // a token is recorded right after the event which drew it
+    EventLogReader *tokens = log.get();
+    Lobby lobby(world, udp_channel, [tokens]() {
+        LoggedEvent drawn;
+        if (!tokens->next(drawn) || drawn.type != LoggedEvent::TOKEN) {
+            std::cerr << "Event log: token expected, the replay no longer follows the recorded session" << std::endl;
+            return (uint64_t) 0;
+        }
+        return drawn.token;
+    });
+    LoggedEvent record;
+    GameEvent event;
+    uint64_t nb_events = 0, nb_ticks = 0;
+    std::chrono::nanoseconds recorded(0), ticks(0), longest_tick(0);
+
+    while (log->next(record)) {
+        recorded = record.time;
+        if (record.type == LoggedEvent::TICK) {
+            std::chrono::steady_clock::time_point tick_start = std::chrono::steady_clock::now();
+            lobby.tick(start + record.time);
+            std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - tick_start;
+            ticks += duration;
+            longest_tick = std::max(longest_tick, duration);
+            nb_ticks++;
+            continue;
+        }
+        if (record.type == LoggedEvent::TOKEN) continue; // read by the rooms which draw it
+
+        event.type = (GameEvent::Type) record.type;
+        event.player = record.connection;
+        event.socket = (int) record.connection; // no connection has it in the reactor
+        event.reactor = reactors[0];
+        event.msg.type = protocol::MSG_UNKNOWN;
+        if (record.type == LoggedEvent::MESSAGE) {
+            if (protocol::isBinary(record.data.data())) {
+                protocol::decodeBinary(record.data.data(), record.data.size(), event.msg);
             } else {
-                mtx_clients.lock();
-                player_find_object.clear();
-                mtx_clients.unlock();
+                protocol::decodeText(record.data, event.msg);
             }
+        } else if (record.type == LoggedEvent::DATAGRAM) {
+            if (!protocol::decodeDatagram(record.data.data(), record.data.size(), event.token, event.seq, event.msg)) continue;
+            event.player = (unsigned int) event.token;
+            event.from = blackhole_addr;
         }
+        apply_event(lobby, event);
+        nb_events++;
     }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (!log->done()) std::cerr << "Event log truncated or corrupted, replay stopped after " << nb_events << " events" << std::endl;
+
+    std::cout << "Replayed " << nb_events << " events and " << nb_ticks << " ticks in " << elapsed.count() << " s"
+              << " (recorded: " << std::chrono::duration<double>(recorded).count() << " s)" << std::endl;
+    if (elapsed.count() > 0) std::cout << (double) nb_events / elapsed.count() << " events/s";
+    if (nb_ticks > 0) {
+        std::cout << ", tick mean " << std::chrono::duration<double, std::micro>(ticks).count() / (double) nb_ticks << " us"
+                  << ", max " << std::chrono::duration<double, std::micro>(longest_tick).count() << " us";
+    }
+    std::cout << std::endl;
+
+    reactors[0]->stop();
+    udp_channel->stop();
+    connection_dealers[0].join();
+    datagram_dealer.join();
+    delete reactors[0];
+    reactors.clear();
+    delete udp_channel;
+    udp_channel = nullptr;
+    close(blackhole);
+    return EXIT_SUCCESS;
 }
 
 /**
- * Thread that will get message from his client
+ * Convert a config file : JSON to world file or back (or JSON to JSON, to check it)
  *
- * @param socket
- * @param id client id (= player id)
+ * @param from config file
+ * @param to new config file (.wtdworld: world file, JSON otherwise)
+ * @return exit status of the server
  */
-void deal_with_client(int socket, unsigned int id, std::future<void> exit_signal) {
-    char buffer[N_CHAR];
-    size_t valread;
-
-    bool is_registred = false; // if not, player can not ask for start, send position or request data
-    bool is_an_exist_from_client = false;
-
-    // Get objects list (from config file)
-    mtx_config.lock();
-    const Json::Value &objs = config["objects"]; // array of objects
-    mtx_config.unlock();
-
-    // define commands regex
-    std::regex username("USERNAME=[A-Za-z0-9]+");
-    std::regex position("POSITION=(-)?[0-9.]+:(-)?[0-9.]+:(-)?[0-9.]+");
-    std::regex askstart("ASKSTART");
-    std::regex objectfound("FOUND=[0-9]+");
-
-    std::string messages;
-
-    //
-    while(exit_signal.wait_for(std::chrono::nanoseconds(1)) == std::future_status::timeout) {
-        valread = read(socket , buffer, N_CHAR); // PASSIVE WAIT
-        buffer[valread] = '\0';
-
-        if (valread == 0) {
-            is_an_exist_from_client = true;
-            break;
-        }
-        if (exit_signal.wait_for(std::chrono::nanoseconds(1)) != std::future_status::timeout) break;
-
-        messages += buffer;
-
-        // Split buffer in real messages
-        size_t pos = 0;
-        std::string current_msg;
-        while ( (pos = messages.find(MSG_DELIMITER)) != std::string::npos ) {
-            current_msg = messages.substr(0, pos);
-            messages.erase(0, pos + MSG_DELIMITER.length());
-
-            // match regex
-            if (regex_match(current_msg, username) && !is_registred) {
-                std::cout << "Received username: " << current_msg << std::endl;
-
-                mtx_clients.lock();
-                std::map<unsigned int, std::tuple<std::thread, Player, std::promise<void>> >::iterator it = clients.find(id);
-
-                // overwrite
-                std::get<1>(it->second).name = current_msg.substr(9); // 9 is size of "USERNAME="
-
-                mtx_clients.unlock();
-
-                is_registred = true;
-
-                /* Send data */
-                std::string msg = "ID=" + std::to_string(id);
-                msg += MSG_DELIMITER;
-
-                // Send client id
-                send(socket, msg.c_str(), msg.length(), 0);
-
-                // Send every objects
-                for (unsigned int i = 0 ; i < objs.size() ; i++) {
-                    mtx_config.lock();
-                    msg = "OBJECT=";
-                    msg += std::to_string( i+1 ) + ":";
-                    msg += objs[i]["type"].asString() + ":";
-                    msg += objs[i]["position"]["x"].asString() + ":";
-                    msg += objs[i]["position"]["y"].asString() + ":";
-                    msg += objs[i]["position"]["z"].asString() +":";
-                    msg += objs[i]["direction"]["x"].asString() + ":";
-                    msg += objs[i]["direction"]["y"].asString() + ":";
-                    msg += objs[i]["direction"]["z"].asString();
-                    mtx_config.unlock();
-                    msg += MSG_DELIMITER;
-
-                    send(socket, msg.c_str(), msg.length(), 0);
-                }
-
-                // Send player list
-                mtx_clients.lock();
-                for (std::map<unsigned int, std::tuple<std::thread, Player, std::promise<void>>>::iterator it=clients.begin() ; it != clients.end() ; ++it) {
-                    msg = "PLAYER=";
-                    msg += std::to_string( std::get<1>(it->second).id) + ":";
-                    msg += std::get<1>(it->second).name + ":";
-                    msg += std::to_string( std::get<1>(it->second).nb_objects_found );
-                    mtx_clients.unlock();
-                    msg += MSG_DELIMITER;
-
-                    send(socket, msg.c_str(), msg.length(), 0);
-                    mtx_clients.lock();
-                }
-
-                new_player_has_join.push_back(id); // add to queue
-                mtx_clients.unlock();
-            }
-            else if (regex_match(current_msg, position) && is_registred && current_status == IN_PROGRESS) {
-                std::string _pos = current_msg.substr(9);
-                std::tuple<double, double, double> coor;
-                double x, y, z;
-                size_t p = 0;
-
-                // X
-                p = _pos.find(":");
-                x = stod( _pos.substr(0, p) );
-                _pos.erase(0, p+1); // 1 for sizeof ":"
-                // Y
-                p = _pos.find(":");
-                y = stod( _pos.substr(0, p) );
-                _pos.erase(0, p+1); // 1 for sizeof ":"
-                // Z
-                z = stod(_pos);
-
-                coor = std::make_tuple(x, y, z);
-                // TODO do something with coor
-                // std::cout << "position " << std::get<0>(coor) << ":" << std::get<1>(coor) << ":" << std::get<2>(coor) << std::endl;
-            }
-            else if (regex_match(current_msg, askstart) && is_registred && current_status == WAITING) {
-                if ((int) id == leader) {
-                    std::cout << "Leader asks to start" << std::endl;
-                    mtx_status.lock();
-                    current_status = STARTING;
-                    mtx_status.unlock();
-                } else {
-                    std::string msg = "Vous n'êtes pas le leader, vous ne pouvez pas lancer la partie.";
-                    msg += MSG_DELIMITER;
-                    send(socket, msg.c_str(), msg.length(), 0);
-                }
-            }
-            else if (regex_match(current_msg, objectfound) && is_registred && current_status == IN_PROGRESS) {
-                unsigned int object_id = stoi(current_msg.substr(6));
-                object_id--; // start at 0 in list !
-
-                // check object exist
-                mtx_config.lock();
-                if (objs[object_id].isObject()) {
-                    mtx_config.unlock();
-
-                    mtx_clients.lock();
-                    std::map<unsigned int, std::tuple<std::thread, Player, std::promise<void>> >::iterator it = clients.find(id);
-                    // overwrite
-                    std::get<1>(it->second).nb_objects_found++;
-
-                    player_find_object.push_back( std::make_pair(id, object_id)); // add to queue
-                    mtx_clients.unlock();
-                } else {
-                    mtx_config.unlock();
-                }
-            }
-            else {
-                // default
-                std::cout << "Client (id: " << id << ") sent an unknown message" << std::endl;
-                std::string msg = "Commande inconnu...";
-                msg += MSG_DELIMITER;
-                send(socket, msg.c_str(), msg.length(), 0);
-            }
-        }
+int convert(const std::string &from, const std::string &to) {
+    std::string errs;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::shared_ptr<const WorldConfig> world = WorldConfig::load(from, errs);
+    if (!world) {
+        std::cerr << "Failed to load configuration '" << from << "'\n" << errs;
+        return EXIT_FAILURE;
+    }
+    std::chrono::duration<double> loaded = std::chrono::steady_clock::now() - start;
+    if (!world->save(to, errs)) {
+        std::cerr << "Failed to write configuration '" << to << "'\n" << errs;
+        return EXIT_FAILURE;
+    }
 
+    size_t nb_objects = 0;
+    for (auto &room : world->rooms) {
+        nb_objects += room->objects.size();
     }
+    std::cout << "[" << world->name << "] " << world->rooms.size() << " room(s), " << nb_objects << " object(s) loaded in "
+              << loaded.count() << " s, written to '" << to << "'" << std::endl;
+    return EXIT_SUCCESS;
+}
 
-    std::cout << "Connection ended with "<< id <<std::endl;
+/**
+ * Body of /metrics, called by the metrics server thread
+ * (the counters are atomics owned by each thread, nothing is locked)
+ */
+std::string render_metrics() {
+    std::vector<const TrafficStats*> tcp;
+    for (Reactor *r : reactors) {
+        tcp.push_back(&r->stats());
+    }
+    return metrics.render(tcp, &udp_channel->stats());
+}
 
-    if (is_an_exist_from_client && current_status != Status::COMPLETED) {
-        // remove myself
-        mtx_clients.lock();
-        client_to_remove.push_back(id);
-        mtx_clients.unlock();
+/**
+ * Reload the config file (main thread, on SIGHUP)
+ * The new config is published as a whole, the game thread uses it from its next tick.
+ * (reactors, io_uring, max_output_bytes, metrics_port, event_log and the UDP channel are only read at start)
+ */
+void reload_config() {
+    std::string errs;
+    std::shared_ptr<const WorldConfig> world = WorldConfig::load(config_path, errs);
+    if (!world) {
+        std::cerr << "Failed to reload configuration '" << config_path << "', the previous one is kept\n" << errs;
+        return;
     }
-}
\ No newline at end of file
+    std::atomic_store(&world_config, world);
+    std::cout << "Configuration reloaded: [" << world->name << "], " << world->rooms.size() << " room(s)" << std::endl;
+}